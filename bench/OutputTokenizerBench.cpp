@@ -0,0 +1,163 @@
+// Throughput of OutputTokenizer on recorded minipro transcripts, next to the
+// QString + regex line handling it replaced.
+//
+//   OutputTokenizerBench [transcript-dir-or-files...] [--mib N]
+//
+// Each transcript is fed in 4 KiB reads, like QProcess hands them out,
+// until N MiB (default 16) have gone through.
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QStringList>
+
+#include <cstdio>
+#include <utility>
+
+#include "OutputTokenizer.h"
+
+namespace {
+
+constexpr qsizetype kReadSize = 4096;
+
+// The previous per-line path: split decoded text, then regexes per line
+struct LegacyParser {
+    QString fragment;
+    qint64  lines{};
+    qint64  flagged{};
+
+    void line(QString ln) {
+        static const QRegularExpression ansiRe(R"(\x1B\[[0-9;]*[A-Za-z])");
+        static const QRegularExpression okTail(
+            R"((?:ms|sec)?\s*ok\s*$|verification\s*ok\s*$)",
+            QRegularExpression::CaseInsensitiveOption);
+        static const QRegularExpression pctRe(R"((\d{1,3})\s*%)");
+        static const QRegularExpression rd(R"(\bReading\s*Code\.\.\.)",
+            QRegularExpression::CaseInsensitiveOption);
+        static const QRegularExpression wr(R"(\bWriting\s*Code\.\.\.)",
+            QRegularExpression::CaseInsensitiveOption);
+
+        if (ln.isEmpty()) return;
+        ln = ln.remove(ansiRe).trimmed();
+        if (ln.isEmpty()) return;
+        ++lines;
+        if (ln.contains("error", Qt::CaseInsensitive)
+            || ln.contains("warning", Qt::CaseInsensitive)
+            || ln.contains("invalid", Qt::CaseInsensitive)
+            || ln.contains("incorrect", Qt::CaseInsensitive)
+            || ln.contains("failed", Qt::CaseInsensitive)
+            || ln.contains("can't", Qt::CaseInsensitive)
+            || ln.contains("is blank", Qt::CaseInsensitive)
+            || ln.contains("success", Qt::CaseInsensitive)
+            || ln.endsWith(" ok", Qt::CaseInsensitive))
+            ++flagged;
+        if (!okTail.match(ln).hasMatch()) pctRe.match(ln);
+        rd.match(ln);
+        wr.match(ln);
+    }
+
+    void feed(const QByteArray &raw) {
+        QString chunk = QString::fromLocal8Bit(raw);
+        chunk.replace("\r\n", "\n");
+        chunk.replace('\r', '\n');
+        fragment.append(chunk);
+        int nl = -1;
+        while ((nl = fragment.indexOf('\n')) != -1) {
+            QString ln = fragment.left(nl);
+            fragment.remove(0, nl + 1);
+            line(ln);
+        }
+    }
+};
+
+struct Result {
+    double seconds{};
+    qint64 lines{};
+};
+
+template <typename FeedFn>
+Result run(const QByteArray &data, qint64 budget, FeedFn &&feed) {
+    QElapsedTimer timer;
+    timer.start();
+    qint64 done = 0;
+    while (done < budget) {
+        for (qsizetype pos = 0; pos < data.size(); pos += kReadSize)
+            feed(data.mid(pos, kReadSize));
+        done += data.size();
+    }
+    return { timer.nsecsElapsed() / 1e9, 0 };
+}
+
+void report(const char *name, const Result &r, qint64 bytes) {
+    const double mib = bytes / (1024.0 * 1024.0);
+    std::printf("  %-10s %8.1f MiB/s %12.0f lines/s\n", name,
+                mib / r.seconds, r.lines / r.seconds);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    QCoreApplication app(argc, argv);
+
+    qint64 budget = 16ll * 1024 * 1024;
+    QStringList inputs;
+    const QStringList args = app.arguments().mid(1);
+    for (int i = 0; i < args.size(); ++i) {
+        if (args[i] == "--mib" && i + 1 < args.size()) budget = args[++i].toLongLong() * 1024 * 1024;
+        else inputs << args[i];
+    }
+    if (inputs.isEmpty()) inputs << QStringLiteral(FIREMINIPRO_TRANSCRIPT_DIR);
+
+    QStringList files;
+    for (const QString &in : std::as_const(inputs)) {
+        const QFileInfo fi(in);
+        if (fi.isDir()) {
+            for (const QFileInfo &f : QDir(in).entryInfoList({ "*.txt" }, QDir::Files, QDir::Name))
+                files << f.filePath();
+        } else {
+            files << in;
+        }
+    }
+    if (files.isEmpty()) {
+        std::fprintf(stderr, "no transcripts found\n");
+        return 1;
+    }
+
+    for (const QString &path : std::as_const(files)) {
+        QFile f(path);
+        if (!f.open(QIODevice::ReadOnly)) {
+            std::fprintf(stderr, "cannot open %s\n", qPrintable(path));
+            return 1;
+        }
+        const QByteArray data = f.readAll();
+        if (data.isEmpty()) continue;
+        const qint64 bytes = ((budget + data.size() - 1) / data.size()) * data.size();
+
+        std::printf("%s (%lld bytes)\n", qPrintable(QFileInfo(path).fileName()),
+                    static_cast<long long>(data.size()));
+
+        OutputTokenizer tok;
+        qint64 lines = 0;
+        qint64 percentSum = 0;  // keeps the results live
+        const OutputTokenizer::LineFn onLine = [&](const OutputTokenizer::Line &l) {
+            ++lines;
+            percentSum += l.percent + int(l.kind);
+        };
+        Result r = run(data, budget, [&](const QByteArray &chunk) { tok.feed(chunk, onLine); });
+        tok.finish(onLine);
+        r.lines = lines;
+        report("tokenizer", r, bytes);
+
+        LegacyParser legacy;
+        Result l = run(data, budget, [&](const QByteArray &chunk) { legacy.feed(chunk); });
+        l.lines = legacy.lines;
+        report("regex", l, bytes);
+
+        std::printf("  speedup    %8.1fx  (checksum %lld/%lld)\n", l.seconds / r.seconds,
+                    static_cast<long long>(percentSum), static_cast<long long>(legacy.flagged));
+    }
+    return 0;
+}
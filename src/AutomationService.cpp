@@ -0,0 +1,248 @@
+#include "AutomationService.h"
+
+#include "BufferDocument.h"
+#include "Checksum.h"
+#include "ProgramPipeline.h"
+
+#include <QDBusConnection>
+#include <QDBusError>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace {
+const char *kService = "io.github.jartza.FireMinipro";
+const char *kPath    = "/FireMinipro";
+} // namespace
+
+AutomationService::AutomationService(BufferDocument *buffer, ProcessHandling *proc, QObject *parent)
+    : QObject(parent), buffer_(buffer), proc_(proc)
+{
+    // The window shares proc_; only signals carrying our job's id are ours.
+    // Chip operations run one at a time, so any other one started is the
+    // window's and keeps us busy until it finishes.
+    connect(proc_, &ProcessHandling::started, this, [this](quint64 job) {
+        if (job != job_) foreignJob_ = job;
+    });
+    connect(proc_, &ProcessHandling::finished, this,
+            [this](quint64 job, int exitCode, QProcess::ExitStatus status) {
+        if (job == foreignJob_) foreignJob_ = 0;
+        if (job_ && job == job_) done(exitCode, status);
+    });
+    connect(proc_, &ProcessHandling::output, this,
+            [this](quint64 job, const QList<ProcessHandling::OutputLine> &lines) {
+        if (!job_ || job != job_) return;
+        for (const auto &line : lines)
+            if (line.kind == ProcessHandling::OutputLine::Error) errors_ << line.text;
+    });
+    connect(proc_, &ProcessHandling::progress, this, [this](quint64 job, int percent, const QString &) {
+        if (job_ && job == job_) emit operationProgress(current_, percent);
+    });
+    connect(proc_, &ProcessHandling::readChunk, this, [this](quint64 job, const QByteArray &data) {
+        if (job_ && job == job_ && readFile_) readFile_->write(data);
+    });
+    connect(proc_, &ProcessHandling::readStreamFinished, this, [this](quint64 job, bool ok, qint64) {
+        if (job_ && job == job_) readOk_ = ok;
+    });
+}
+
+AutomationService::~AutomationService() {
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (bus.isConnected() && bus.objectRegisteredAt(kPath) == this) {
+        bus.unregisterObject(kPath);
+        bus.unregisterService(kService);
+    }
+}
+
+bool AutomationService::registerOnSessionBus(QString *error) {
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected()) {
+        *error = bus.lastError().isValid() ? bus.lastError().message() : tr("no session bus");
+        return false;
+    }
+    if (!bus.registerService(kService)) {
+        *error = bus.lastError().message();
+        return false;
+    }
+    if (!bus.registerObject(kPath, this, QDBusConnection::ExportScriptableSlots
+                                         | QDBusConnection::ExportScriptableSignals)) {
+        *error = bus.lastError().message();
+        bus.unregisterService(kService);
+        return false;
+    }
+    return true;
+}
+
+void AutomationService::fail(const QString &message) {
+    if (calledFromDBus()) sendErrorReply(QDBusError::Failed, message);
+}
+
+qlonglong AutomationService::size() const {
+    return buffer_->size();
+}
+
+void AutomationService::setBufferLocked(bool locked) {
+    bufferLocked_ = locked;
+}
+
+void AutomationService::setDeviceLocked(bool locked) {
+    deviceLocked_ = locked;
+}
+
+bool AutomationService::refuseWhileLocked() {
+    if (!bufferLocked_) return false;
+    fail(tr("a chip read is filling the buffer"));
+    return true;
+}
+
+qlonglong AutomationService::loadFile(const QString &path, qlonglong offset, qlonglong length, int padByte) {
+    if (refuseWhileLocked()) return -1;
+    if (padByte < 0 || padByte > 0xFF) {
+        fail(tr("pad byte out of range"));
+        return -1;
+    }
+    QString error;
+    const BufferSource file = BufferSource::mapFile(path, &error);
+    if (!error.isEmpty()) {
+        fail(error);
+        return -1;
+    }
+
+    if (offset < 0) offset = buffer_->size();
+    if (length <= 0) length = file.size();
+    if (length <= 0) {
+        fail(tr("%1 is empty").arg(path));
+        return -1;
+    }
+
+    buffer_->place(offset, file, length, char(padByte));
+    emit bufferLoaded(offset, length, QFileInfo(path).fileName());
+    return buffer_->size();
+}
+
+void AutomationService::fill(qlonglong offset, qlonglong length, int value) {
+    if (refuseWhileLocked()) return;
+    if (value < 0 || value > 0xFF) {
+        fail(tr("fill value out of range"));
+        return;
+    }
+    if (offset < 0 || length <= 0 || offset + length > buffer_->size()) {
+        fail(tr("range outside the buffer"));
+        return;
+    }
+    buffer_->fill(offset, length, char(value));
+}
+
+void AutomationService::clear() {
+    if (refuseWhileLocked()) return;
+    buffer_->clear();
+    emit bufferCleared();
+}
+
+void AutomationService::save(const QString &path) {
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly) || !buffer_->writeTo(&f) || !f.commit())
+        fail(tr("%1: %2").arg(path, f.errorString()));
+}
+
+uint AutomationService::checksum(qlonglong offset, qlonglong length) {
+    if (length < 0) length = buffer_->size() - offset;
+    if (offset < 0 || length < 0 || offset + length > buffer_->size()) {
+        fail(tr("range outside the buffer"));
+        return 0;
+    }
+    return Checksum::crc32(buffer_->engine(), offset, length);
+}
+
+uint AutomationService::begin(const QString &device, bool needsBuffer) {
+    if (current_ || foreignJob_) {
+        fail(tr("the programmer is busy"));
+        return 0;
+    }
+    if (deviceLocked_) {
+        fail(tr("a batch or gang run has the programmer"));
+        return 0;
+    }
+    if (device.trimmed().isEmpty()) {
+        fail(tr("no device given"));
+        return 0;
+    }
+    if (needsBuffer && buffer_->isEmpty()) {
+        fail(tr("the buffer is empty"));
+        return 0;
+    }
+    current_ = nextId_++;
+    if (nextId_ == 0) nextId_ = 1;
+    errors_.clear();
+    return current_;
+}
+
+void AutomationService::done(int exitCode, QProcess::ExitStatus status) {
+    bool ok = status == QProcess::NormalExit && exitCode == 0;
+    if (readFile_) {
+        if (ok && readOk_) {
+            ok = readFile_->commit();
+        } else {
+            readFile_->cancelWriting();
+            ok = false;
+        }
+        readFile_.reset();
+    }
+    const uint id = current_;
+    current_ = 0;
+    job_ = 0;
+    emit operationFinished(id, ok, exitCode, errors_.join('\n'));
+}
+
+uint AutomationService::read(const QString &device, const QString &path, const QStringList &flags) {
+    const uint id = begin(device, false);
+    if (!id) return 0;
+    readFile_ = std::make_unique<QSaveFile>(path);
+    readOk_ = false;
+    if (!readFile_->open(QIODevice::WriteOnly)) {
+        const QString error = readFile_->errorString();
+        readFile_.reset();
+        current_ = 0;
+        fail(tr("%1: %2").arg(path, error));
+        return 0;
+    }
+    job_ = proc_->readChipImageStreamed(QString(), device.trimmed(), flags);
+    return id;
+}
+
+uint AutomationService::write(const QString &device, const QStringList &flags) {
+    const uint id = begin(device, true);
+    if (id) job_ = proc_->writeChipImageStreamed(QString(), device.trimmed(), buffer_->engine(), flags);
+    return id;
+}
+
+uint AutomationService::verify(const QString &device, const QStringList &flags) {
+    const uint id = begin(device, true);
+    if (!id) return 0;
+    ProgramPipeline pipeline;
+    pipeline.stages << ProgramPipeline::Stage::Verify;
+    job_ = proc_->runPipeline(QString(), device.trimmed(), pipeline, buffer_->engine(), flags);
+    return id;
+}
+
+uint AutomationService::erase(const QString &device, const QStringList &flags) {
+    const uint id = begin(device, false);
+    if (id) job_ = proc_->eraseChip(QString(), device.trimmed(), flags);
+    return id;
+}
+
+uint AutomationService::blankCheck(const QString &device, const QStringList &flags) {
+    const uint id = begin(device, false);
+    if (id) job_ = proc_->checkIfBlank(QString(), device.trimmed(), flags);
+    return id;
+}
+
+uint AutomationService::program(const QString &device, const QStringList &flags) {
+    const uint id = begin(device, true);
+    if (id) job_ = proc_->runPipeline(QString(), device.trimmed(), ProgramPipeline::standard(), buffer_->engine(), flags);
+    return id;
+}
+
+void AutomationService::cancel() {
+    // Only ours: the window's queued jobs go on
+    if (current_) proc_->cancelJob(job_);
+}
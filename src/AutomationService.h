@@ -0,0 +1,92 @@
+#pragma once
+
+#include <QDBusContext>
+#include <QObject>
+#include <QProcess>
+#include <QStringList>
+
+#include <memory>
+
+#include "ProcessHandling.h"
+
+class BufferDocument;
+class QSaveFile;
+
+// D-Bus interface of a running FireMinipro, for scripts that drive one
+// long-lived instance instead of starting a new one per job.
+//
+// Buffer operations act on the main window's buffer and return at once;
+// those that change it fail while the window streams a chip read into it.
+// Device operations go to the main window's ProcessHandling, so they show
+// in its log and progress bar like the buttons do; each returns an id and
+// ends with operationFinished(). One device operation runs at a time, a
+// call while the programmer is busy fails with a D-Bus error, as does one
+// while a batch or gang window drives the programmer. cancel() stops only
+// the operation started over D-Bus.
+//
+// Registered as io.github.jartza.FireMinipro at /FireMinipro on the session
+// bus; `dbus-run-session` gives a private bus for testing.
+class AutomationService : public QObject, protected QDBusContext {
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "io.github.jartza.FireMinipro")
+public:
+    AutomationService(BufferDocument *buffer, ProcessHandling *proc, QObject *parent = nullptr);
+    ~AutomationService() override;
+
+    // False with a reason if there is no session bus or the name is taken
+    bool registerOnSessionBus(QString *error);
+    // Set by the window while a streamed read appends to the buffer
+    void setBufferLocked(bool locked);
+    // Set by the window while a batch or gang window has the programmer
+    void setDeviceLocked(bool locked);
+
+public slots:
+    // Buffer. Offsets and lengths are in bytes; a negative offset appends,
+    // a length of 0 (load) or below 0 (checksum) means "to the end".
+    Q_SCRIPTABLE qlonglong size() const;
+    Q_SCRIPTABLE qlonglong loadFile(const QString &path, qlonglong offset, qlonglong length, int padByte);
+    Q_SCRIPTABLE void      fill(qlonglong offset, qlonglong length, int value);
+    Q_SCRIPTABLE void      clear();
+    Q_SCRIPTABLE void      save(const QString &path);
+    Q_SCRIPTABLE uint      checksum(qlonglong offset, qlonglong length);   // CRC-32
+
+    // Device. flags are extra minipro arguments, e.g. ["-y"].
+    Q_SCRIPTABLE uint read(const QString &device, const QString &path, const QStringList &flags);
+    Q_SCRIPTABLE uint write(const QString &device, const QStringList &flags);
+    Q_SCRIPTABLE uint verify(const QString &device, const QStringList &flags);
+    Q_SCRIPTABLE uint erase(const QString &device, const QStringList &flags);
+    Q_SCRIPTABLE uint blankCheck(const QString &device, const QStringList &flags);
+    // Erase, blank check, write and verify
+    Q_SCRIPTABLE uint program(const QString &device, const QStringList &flags);
+    Q_SCRIPTABLE void cancel();
+
+signals:
+    Q_SCRIPTABLE void operationProgress(uint id, int percent);
+    // errors: minipro's error lines, one per line
+    Q_SCRIPTABLE void operationFinished(uint id, bool ok, int exitCode, const QString &errors);
+
+    // For the main window, not on the bus: keep the segment legend in step
+    void bufferLoaded(qint64 offset, qint64 length, const QString &label);
+    void bufferCleared();
+
+private:
+    // Zero and a D-Bus error reply if an operation can't start now
+    uint begin(const QString &device, bool needsBuffer);
+    void done(int exitCode, QProcess::ExitStatus status);
+    void fail(const QString &message);
+    // True, with a D-Bus error reply, while the buffer is locked
+    bool refuseWhileLocked();
+
+    BufferDocument  *buffer_{};
+    ProcessHandling *proc_{};
+
+    uint        nextId_{1};
+    uint        current_{0};         // our running operation, if any
+    quint64     job_{0};             // its ProcessHandling job
+    quint64     foreignJob_{0};      // one started from the window
+    bool        bufferLocked_{false};
+    bool        deviceLocked_{false};
+    QStringList errors_;
+    std::unique_ptr<QSaveFile> readFile_;
+    bool        readOk_{false};
+};
@@ -0,0 +1,119 @@
+#include "BatchStats.h"
+
+#include <QIODevice>
+#include <QRegularExpression>
+#include <QStringList>
+
+#include <algorithm>
+
+namespace {
+
+const ProgramPipeline::Stage kStages[] = {
+    ProgramPipeline::Stage::Erase,
+    ProgramPipeline::Stage::BlankCheck,
+    ProgramPipeline::Stage::Write,
+    ProgramPipeline::Stage::Verify,
+};
+
+qint64 mean(const QList<qint64> &v) {
+    if (v.isEmpty()) return 0;
+    qint64 sum = 0;
+    for (qint64 x : v) sum += x;
+    return sum / v.size();
+}
+
+// Nearest-rank percentile
+qint64 p95(QList<qint64> v) {
+    if (v.isEmpty()) return 0;
+    std::sort(v.begin(), v.end());
+    const qsizetype rank = (v.size() * 95 + 99) / 100;
+    return v.at(std::max<qsizetype>(rank, 1) - 1);
+}
+
+QString csvField(const QString &s) {
+    if (!s.contains(',') && !s.contains('"') && !s.contains('\n')) return s;
+    QString q = s;
+    q.replace('"', QStringLiteral("\"\""));
+    return '"' + q + '"';
+}
+
+} // namespace
+
+int BatchStats::passed() const {
+    return int(std::count_if(units_.cbegin(), units_.cend(), [](const Unit &u) { return u.ok; }));
+}
+
+double BatchStats::unitsPerHour(const QDateTime &now) const {
+    if (units_.isEmpty()) return 0.0;
+    const qint64 ms = units_.first().started.msecsTo(now);
+    if (ms <= 0) return 0.0;
+    return units_.size() * 3600000.0 / ms;
+}
+
+QList<qint64> BatchStats::stageTimes(ProgramPipeline::Stage stage) const {
+    QList<qint64> out;
+    for (const Unit &u : units_)
+        for (const auto &r : u.stages)
+            if (r.stage == stage && !r.skipped) out << r.elapsedMs;
+    return out;
+}
+
+qint64 BatchStats::meanMs(ProgramPipeline::Stage stage) const { return mean(stageTimes(stage)); }
+qint64 BatchStats::p95Ms(ProgramPipeline::Stage stage) const  { return p95(stageTimes(stage)); }
+
+qint64 BatchStats::meanCycleMs() const {
+    QList<qint64> v;
+    for (const Unit &u : units_) v << u.cycleMs;
+    return mean(v);
+}
+
+qint64 BatchStats::p95CycleMs() const {
+    QList<qint64> v;
+    for (const Unit &u : units_) v << u.cycleMs;
+    return p95(v);
+}
+
+QMap<QString, int> BatchStats::failureReasons() const {
+    QMap<QString, int> out;
+    for (const Unit &u : units_)
+        if (!u.ok) ++out[u.reason];
+    return out;
+}
+
+QString BatchStats::reasonFromError(const QString &line) {
+    static const QRegularExpression reNumber(QStringLiteral("\\b(0x[0-9a-fA-F]+|[0-9]+)\\b"));
+    QString r = line.trimmed();
+    r.replace(reNumber, QStringLiteral("#"));
+    return r;
+}
+
+bool BatchStats::writeCsv(QIODevice *out) const {
+    QStringList header{ "unit", "started", "ok", "cycle_ms", "idle_ms" };
+    for (const auto stage : kStages)
+        header << ProgramPipeline::stageName(stage).toLower().replace(' ', '_') + "_ms";
+    header << "failed_stage" << "reason" << "data";
+
+    QByteArray text = header.join(',').toUtf8() + '\n';
+    for (const Unit &u : units_) {
+        QStringList row{
+            QString::number(u.number),
+            u.started.toString(Qt::ISODateWithMs),
+            u.ok ? "1" : "0",
+            QString::number(u.cycleMs),
+            QString::number(u.idleMs),
+        };
+        QString failedStage;
+        for (const auto stage : kStages) {
+            QString cell;
+            for (const auto &r : u.stages) {
+                if (r.stage != stage) continue;
+                if (!r.skipped) cell = QString::number(r.elapsedMs);
+                if (!r.ok) failedStage = ProgramPipeline::stageName(stage);
+            }
+            row << cell;
+        }
+        row << csvField(failedStage) << csvField(u.reason) << csvField(u.data);
+        text += row.join(',').toUtf8() + '\n';
+    }
+    return out->write(text) == text.size();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QDateTime>
+#include <QList>
+#include <QMap>
+#include <QString>
+
+#include "ProgramPipeline.h"
+
+class QIODevice;
+
+// Per-unit results of a production batch and the figures derived from them:
+// throughput, cycle time per stage (mean and 95th percentile) and how often
+// each failure reason came up.
+class BatchStats {
+public:
+    struct Unit {
+        int       number{0};
+        QDateTime started;
+        qint64    cycleMs{0};   // pipeline start to end
+        qint64    idleMs{0};    // since the previous unit ended (chip swap)
+        bool      ok{false};
+        QList<ProgramPipeline::StageResult> stages;
+        QString   reason;       // empty when ok
+        QString   data;         // per-unit values written, if any
+    };
+
+    void clear() { units_.clear(); }
+    void add(const Unit &unit) { units_ << unit; }
+
+    const QList<Unit> &units() const { return units_; }
+    int count() const { return int(units_.size()); }
+    int passed() const;
+    int failed() const { return count() - passed(); }
+
+    // Units finished per hour, chip swaps included, up to `now`
+    double unitsPerHour(const QDateTime &now) const;
+
+    // Over units that ran the stage; 0 if none did
+    qint64 meanMs(ProgramPipeline::Stage stage) const;
+    qint64 p95Ms(ProgramPipeline::Stage stage) const;
+    qint64 meanCycleMs() const;
+    qint64 p95CycleMs() const;
+
+    QMap<QString, int> failureReasons() const;
+
+    // A failure reason from an error line: numbers and addresses are
+    // blanked so that the same failure on different units counts once
+    static QString reasonFromError(const QString &line);
+
+    // One row per unit, with the per-unit values last
+    bool writeCsv(QIODevice *out) const;
+
+private:
+    QList<qint64> stageTimes(ProgramPipeline::Stage stage) const;
+
+    QList<Unit> units_;
+};
@@ -0,0 +1,483 @@
+#include "BatchWindow.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QFileDialog>
+#include <QGridLayout>
+#include <QGroupBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLocale>
+#include <QMessageBox>
+#include <QPlainTextEdit>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QSaveFile>
+#include <QSpinBox>
+#include <QStyleFactory>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace {
+
+const ProgramPipeline::Stage kStatStages[] = {
+    ProgramPipeline::Stage::Erase,
+    ProgramPipeline::Stage::BlankCheck,
+    ProgramPipeline::Stage::Write,
+    ProgramPipeline::Stage::Verify,
+};
+
+QString seconds(qint64 ms) {
+    return QString::number(ms / 1000.0, 'f', 2) + " s";
+}
+
+// Per-unit data table
+enum OverlayColumn { ColOffset, ColLength, ColGenerator, ColStart, ColStep, ColPattern, ColCount };
+
+// Generator choices, in combo box order
+struct GeneratorChoice {
+    const char *label;
+    UnitOverlay::Generator generator;
+    bool bigEndian;
+};
+const GeneratorChoice kGenerators[] = {
+    { QT_TRANSLATE_NOOP("BatchWindow", "Counter, little endian"), UnitOverlay::Generator::Counter, false },
+    { QT_TRANSLATE_NOOP("BatchWindow", "Counter, big endian"),    UnitOverlay::Generator::Counter, true },
+    { QT_TRANSLATE_NOOP("BatchWindow", "Hex text"),               UnitOverlay::Generator::HexText, false },
+    { QT_TRANSLATE_NOOP("BatchWindow", "CRC-32, little endian"),  UnitOverlay::Generator::Crc32,   false },
+    { QT_TRANSLATE_NOOP("BatchWindow", "CRC-32, big endian"),     UnitOverlay::Generator::Crc32,   true },
+};
+
+// "0x" prefix for hex, decimal otherwise
+bool parseNumber(const QString &text, quint64 *value) {
+    const QString s = text.trimmed();
+    bool ok = false;
+    *value = s.startsWith("0x", Qt::CaseInsensitive) ? s.mid(2).toULongLong(&ok, 16)
+                                                     : s.toULongLong(&ok, 10);
+    return ok;
+}
+
+} // namespace
+
+BatchWindow::BatchWindow(const QString &programmer,
+                         const QString &device,
+                         const BufferEngine &image,
+                         const QStringList &extraFlags,
+                         bool verify,
+                         QWidget *parent)
+    : QDialog(parent), programmer_(programmer), device_(device), image_(image),
+      extraFlags_(extraFlags), verify_(verify)
+{
+    setWindowTitle(tr("Batch programming - %1").arg(device));
+    setMinimumSize(640, 760);
+    auto *layout = new QVBoxLayout(this);
+
+    layout->addWidget(new QLabel(tr("Programs the buffer (%1 bytes) into one %2 after another.")
+                                 .arg(QLocale().toString(image_.size())).arg(device), this));
+
+    // Settings
+    auto *settings = new QGridLayout;
+    chkPipeline_ = new QCheckBox(tr("Erase and blank check before writing"), this);
+    chkPipeline_->setChecked(true);
+    comboNext_ = new QComboBox(this);
+    comboNext_->addItems({ tr("Wait for Next after each chip"),
+                           tr("Continue automatically after") });
+    spinDelay_ = new QSpinBox(this);
+    spinDelay_->setRange(1, 600);
+    spinDelay_->setValue(5);
+    spinDelay_->setSuffix(tr(" s"));
+    spinDelay_->setEnabled(false);
+    settings->addWidget(chkPipeline_, 0, 0, 1, 2);
+    settings->addWidget(comboNext_,   1, 0);
+    settings->addWidget(spinDelay_,   1, 1);
+    layout->addLayout(settings);
+
+    // Values that differ per chip, written over the buffer for each unit
+    auto *overlayBox = new QGroupBox(tr("Per-unit data"), this);
+    auto *overlayLayout = new QVBoxLayout(overlayBox);
+    overlayTable_ = new QTableWidget(0, ColCount, overlayBox);
+    overlayTable_->setHorizontalHeaderLabels({ tr("Offset"), tr("Length"), tr("Generator"),
+                                               tr("Start"), tr("Step"), tr("Pattern / CRC range") });
+    overlayTable_->horizontalHeaderItem(ColLength)->setToolTip(
+        tr("Bytes written. Empty: 4, or the pattern length for hex text."));
+    overlayTable_->horizontalHeaderItem(ColPattern)->setToolTip(
+        tr("Hex text: e.g. SN-XXXXXXXX, each X takes one hex digit of the counter.\n"
+           "CRC-32: first-last byte checksummed, e.g. 0x0-0x7FFB."));
+    overlayTable_->horizontalHeader()->setStretchLastSection(true);
+    overlayTable_->verticalHeader()->setVisible(false);
+    overlayTable_->setSelectionBehavior(QAbstractItemView::SelectRows);
+    overlayTable_->setMaximumHeight(120);
+    overlayLayout->addWidget(overlayTable_);
+    auto *overlayButtons = new QHBoxLayout;
+    btnAddField_    = new QPushButton(tr("Add field"), overlayBox);
+    btnRemoveField_ = new QPushButton(tr("Remove field"), overlayBox);
+    overlayButtons->addWidget(btnAddField_);
+    overlayButtons->addWidget(btnRemoveField_);
+    overlayButtons->addStretch(1);
+    overlayLayout->addLayout(overlayButtons);
+    layout->addWidget(overlayBox);
+
+    auto *buttons = new QHBoxLayout;
+    btnStart_  = new QPushButton(tr("Start batch"), this);
+    btnNext_   = new QPushButton(tr("Next chip"), this);
+    btnStop_   = new QPushButton(tr("Stop"), this);
+    btnExport_ = new QPushButton(tr("Export CSV…"), this);
+    btnNext_->setDefault(true);
+    buttons->addWidget(btnStart_);
+    buttons->addWidget(btnNext_);
+    buttons->addWidget(btnStop_);
+    buttons->addStretch(1);
+    buttons->addWidget(btnExport_);
+    layout->addLayout(buttons);
+
+    status_ = new QLabel(this);
+    QFont big = status_->font();
+    big.setPointSizeF(big.pointSizeF() * 1.4);
+    big.setBold(true);
+    status_->setFont(big);
+    layout->addWidget(status_);
+
+    bar_ = new QProgressBar(this);
+    bar_->setRange(0, 100);
+    bar_->setValue(0);
+    bar_->setStyle(QStyleFactory::create("Fusion"));
+    layout->addWidget(bar_);
+
+    counters_ = new QLabel(this);
+    counters_->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    layout->addWidget(counters_);
+
+    // Cycle time per stage
+    stageTable_ = new QTableWidget(int(std::size(kStatStages)) + 1, 2, this);
+    stageTable_->setHorizontalHeaderLabels({ tr("Mean"), tr("95th percentile") });
+    QStringList rows;
+    for (const auto stage : kStatStages) rows << ProgramPipeline::stageName(stage);
+    rows << tr("Whole cycle");
+    stageTable_->setVerticalHeaderLabels(rows);
+    stageTable_->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    stageTable_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    stageTable_->setMaximumHeight(stageTable_->verticalHeader()->length()
+                                  + stageTable_->horizontalHeader()->height() + 4);
+    layout->addWidget(stageTable_);
+
+    reasonTable_ = new QTableWidget(0, 2, this);
+    reasonTable_->setHorizontalHeaderLabels({ tr("Failure reason"), tr("Units") });
+    reasonTable_->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    reasonTable_->verticalHeader()->setVisible(false);
+    reasonTable_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    layout->addWidget(reasonTable_);
+
+    log_ = new QPlainTextEdit(this);
+    log_->setReadOnly(true);
+    log_->setMaximumBlockCount(5000);
+    layout->addWidget(log_, 1);
+
+    // Own minipro instance; the window is modal so the main one stays idle
+    proc_ = new ProcessHandling;
+    proc_->moveToThread(&procThread_);
+    connect(&procThread_, &QThread::finished, proc_, &QObject::deleteLater);
+    procThread_.start();
+
+    connect(proc_, &ProcessHandling::output, this,
+            [this](quint64, const QList<ProcessHandling::OutputLine> &lines) {
+        for (const auto &line : lines) {
+            if (line.kind == ProcessHandling::OutputLine::Error) {
+                unitErrors_ << line.text;
+                log_->appendHtml(QString("<span style=\"color:#d33\">%1</span>")
+                                 .arg(line.text.toHtmlEscaped()));
+            } else {
+                log_->appendPlainText(line.text);
+            }
+        }
+    });
+    connect(proc_, &ProcessHandling::progress, this, [this](quint64, int pct, const QString &label) {
+        bar_->setValue(pct);
+        if (!label.isEmpty()) bar_->setFormat(label + " %p%");
+    });
+    connect(proc_, &ProcessHandling::pipelineDone, this, &BatchWindow::unitDone);
+    // A unit that ended without a pipeline result (failed start)
+    connect(proc_, &ProcessHandling::finished, this, [this](quint64, int, QProcess::ExitStatus) {
+        if (state_ == State::Running) unitDone(false, {});
+    });
+
+    connect(comboNext_, qOverload<int>(&QComboBox::currentIndexChanged), this, [this](int i) {
+        spinDelay_->setEnabled(i == 1);
+    });
+    connect(btnAddField_, &QPushButton::clicked, this, &BatchWindow::addOverlayRow);
+    connect(btnRemoveField_, &QPushButton::clicked, this, [this]{
+        const int row = overlayTable_->currentRow();
+        if (row >= 0) overlayTable_->removeRow(row);
+    });
+    connect(btnStart_,  &QPushButton::clicked, this, &BatchWindow::startBatch);
+    connect(btnNext_,   &QPushButton::clicked, this, &BatchWindow::runUnit);
+    connect(btnStop_,   &QPushButton::clicked, this, &BatchWindow::stopBatch);
+    connect(btnExport_, &QPushButton::clicked, this, &BatchWindow::exportCsv);
+
+    nextTimer_.setSingleShot(true);
+    connect(&nextTimer_, &QTimer::timeout, this, &BatchWindow::runUnit);
+    clock_.setInterval(1000);
+    connect(&clock_, &QTimer::timeout, this, &BatchWindow::refreshStats);
+
+    setState(State::Idle);
+    refreshStats();
+}
+
+BatchWindow::~BatchWindow() {
+    disconnect(proc_, nullptr, this, nullptr);
+    procThread_.quit();
+    procThread_.wait();
+}
+
+void BatchWindow::reject() {
+    if (state_ == State::Running
+        && QMessageBox::question(this, tr("Batch programming"),
+               tr("A chip is being programmed. Stop it and close?")) != QMessageBox::Yes)
+        return;
+    QDialog::reject();
+}
+
+void BatchWindow::startBatch() {
+    QString error;
+    UnitOverlay overlay;
+    if (!readOverlay(&overlay, &error) || !(error = overlay.validate(image_.size())).isEmpty()) {
+        QMessageBox::warning(this, tr("Per-unit data"), error);
+        return;
+    }
+    overlay_ = overlay;
+
+    stats_.clear();
+    unitNumber_ = 0;
+    lastEnded_ = {};
+    stopRequested_ = false;
+    log_->clear();
+    refreshStats();
+    clock_.start();
+    // Automatic mode starts with the chip already in the socket
+    if (comboNext_->currentIndex() == 1) runUnit();
+    else setState(State::WaitingForChip);
+}
+
+// Waiting: stop now. Running: stop after this unit, never halfway a write.
+void BatchWindow::stopBatch() {
+    nextTimer_.stop();
+    if (state_ == State::Running) {
+        stopRequested_ = true;
+        status_->setText(tr("Stopping after unit %1…").arg(unitNumber_));
+        return;
+    }
+    clock_.stop();
+    setState(State::Idle);
+}
+
+void BatchWindow::runUnit() {
+    if (state_ == State::Running) return;
+    nextTimer_.stop();
+
+    ++unitNumber_;
+    unitStarted_ = QDateTime::currentDateTime();
+    unitErrors_.clear();
+    unitData_.clear();
+    log_->appendPlainText(tr("---- Unit %1 ----").arg(unitNumber_));
+    bar_->setValue(0);
+
+    // A failed chip is thrown away, so only passed units use up a value
+    BufferEngine image = image_;
+    if (!overlay_.isEmpty()) {
+        unitData_ = UnitOverlay::describe(overlay_.apply(image, quint64(stats_.passed())));
+        log_->appendPlainText(tr("[Data] %1").arg(unitData_));
+    }
+
+    ProgramPipeline pipeline;
+    if (chkPipeline_->isChecked()) pipeline = ProgramPipeline::standard(verify_);
+    else pipeline.stages << ProgramPipeline::Stage::Write;  // minipro erases and verifies itself
+
+    setState(State::Running);
+    proc_->runPipeline(programmer_, device_, pipeline, image, extraFlags_);
+}
+
+void BatchWindow::unitDone(bool ok, const QList<ProgramPipeline::StageResult> &results) {
+    const QDateTime now = QDateTime::currentDateTime();
+
+    BatchStats::Unit unit;
+    unit.number  = unitNumber_;
+    unit.started = unitStarted_;
+    unit.cycleMs = unitStarted_.msecsTo(now);
+    unit.idleMs  = lastEnded_.isValid() ? lastEnded_.msecsTo(unitStarted_) : 0;
+    unit.ok      = ok;
+    unit.stages  = results;
+    unit.data    = unitData_;
+    if (!ok) {
+        // minipro's own error line, not the summaries ProcessHandling adds
+        const QString stage = results.isEmpty()
+            ? tr("Start") : ProgramPipeline::stageName(results.last().stage);
+        QString line;
+        for (const QString &e : std::as_const(unitErrors_))
+            if (!e.startsWith('[')) { line = e; break; }
+        unit.reason = line.isEmpty()
+            ? tr("%1 failed (exit %2)").arg(stage).arg(results.isEmpty() ? -1 : results.last().exitCode)
+            : stage + ": " + BatchStats::reasonFromError(line);
+    }
+    stats_.add(unit);
+    lastEnded_ = now;
+    refreshStats();
+
+    status_->setText(ok ? tr("Unit %1 PASS").arg(unitNumber_)
+                        : tr("Unit %1 FAIL - %2").arg(unitNumber_).arg(unit.reason));
+    status_->setStyleSheet(ok ? "color:#2a2" : "color:#d33");
+
+    if (stopRequested_) {
+        stopRequested_ = false;
+        clock_.stop();
+        setState(State::Idle);
+        return;
+    }
+    setState(State::WaitingForChip);
+    if (comboNext_->currentIndex() == 1) nextTimer_.start(spinDelay_->value() * 1000);
+}
+
+void BatchWindow::setState(State state) {
+    state_ = state;
+    const bool active = state != State::Idle;
+    chkPipeline_->setEnabled(!active);
+    overlayTable_->setEnabled(!active);
+    btnAddField_->setEnabled(!active);
+    btnRemoveField_->setEnabled(!active);
+    btnStart_->setEnabled(!active);
+    btnNext_->setEnabled(state == State::WaitingForChip);
+    btnStop_->setEnabled(active);
+    btnExport_->setEnabled(state != State::Running && stats_.count() > 0);
+
+    if (state == State::WaitingForChip) {
+        const QString next = comboNext_->currentIndex() == 1
+            ? tr("Next chip in %1 s").arg(spinDelay_->value())
+            : tr("Insert chip %1 and press Next").arg(unitNumber_ + 1);
+        // Keep the verdict of the previous unit in view
+        if (unitNumber_ > 0) {
+            status_->setText(status_->text() + " - " + next);
+        } else {
+            status_->setText(next);
+            status_->setStyleSheet({});
+        }
+        btnNext_->setFocus();
+    } else if (state == State::Running) {
+        status_->setText(tr("Programming unit %1…").arg(unitNumber_));
+        status_->setStyleSheet({});
+    } else if (stats_.count() == 0) {
+        status_->setText(tr("Press Start batch"));
+        status_->setStyleSheet({});
+    }
+}
+
+void BatchWindow::refreshStats() {
+    const int n = stats_.count();
+    const double yield = n > 0 ? 100.0 * stats_.passed() / n : 0.0;
+    counters_->setText(tr("Units: %1   Passed: %2   Failed: %3   Yield: %4%   Units/hour: %5")
+                       .arg(n).arg(stats_.passed()).arg(stats_.failed())
+                       .arg(yield, 0, 'f', 1)
+                       .arg(stats_.unitsPerHour(QDateTime::currentDateTime()), 0, 'f', 1));
+
+    int row = 0;
+    auto setRow = [this, &row](qint64 meanMs, qint64 p95Ms) {
+        stageTable_->setItem(row, 0, new QTableWidgetItem(meanMs ? seconds(meanMs) : "-"));
+        stageTable_->setItem(row, 1, new QTableWidgetItem(p95Ms ? seconds(p95Ms) : "-"));
+        ++row;
+    };
+    for (const auto stage : kStatStages) setRow(stats_.meanMs(stage), stats_.p95Ms(stage));
+    setRow(stats_.meanCycleMs(), stats_.p95CycleMs());
+
+    // Most frequent first
+    const QMap<QString, int> reasons = stats_.failureReasons();
+    QList<QPair<int, QString>> sorted;
+    for (auto it = reasons.cbegin(); it != reasons.cend(); ++it) sorted << qMakePair(it.value(), it.key());
+    std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+    reasonTable_->setRowCount(int(sorted.size()));
+    for (int i = 0; i < sorted.size(); ++i) {
+        reasonTable_->setItem(i, 0, new QTableWidgetItem(sorted.at(i).second));
+        reasonTable_->setItem(i, 1, new QTableWidgetItem(QString::number(sorted.at(i).first)));
+    }
+}
+
+void BatchWindow::exportCsv() {
+    const QString path = QFileDialog::getSaveFileName(this, tr("Export batch statistics"),
+        QString("batch-%1-%2.csv").arg(device_.split('@').first())
+                                  .arg(QDateTime::currentDateTime().toString("yyMMdd-hhmmss")),
+        tr("CSV (*.csv);;All files (*)"));
+    if (path.isEmpty()) return;
+
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly) || !stats_.writeCsv(&f) || !f.commit()) {
+        QMessageBox::warning(this, tr("Export batch statistics"),
+                             tr("Could not write %1: %2").arg(path, f.errorString()));
+        return;
+    }
+    log_->appendPlainText(tr("[Saved] %1 units to %2").arg(stats_.count()).arg(path));
+}
+
+void BatchWindow::addOverlayRow() {
+    const int row = overlayTable_->rowCount();
+    overlayTable_->insertRow(row);
+    overlayTable_->setItem(row, ColOffset,  new QTableWidgetItem("0x0"));
+    overlayTable_->setItem(row, ColLength,  new QTableWidgetItem(QString()));
+    overlayTable_->setItem(row, ColStart,   new QTableWidgetItem("1"));
+    overlayTable_->setItem(row, ColStep,    new QTableWidgetItem("1"));
+    overlayTable_->setItem(row, ColPattern, new QTableWidgetItem(QString()));
+    auto *combo = new QComboBox(overlayTable_);
+    for (const auto &choice : kGenerators) combo->addItem(tr(choice.label));
+    overlayTable_->setCellWidget(row, ColGenerator, combo);
+    overlayTable_->setCurrentCell(row, ColOffset);
+}
+
+bool BatchWindow::readOverlay(UnitOverlay *overlay, QString *error) const {
+    overlay->fields.clear();
+    for (int row = 0; row < overlayTable_->rowCount(); ++row) {
+        const auto text = [&](int col) {
+            const QTableWidgetItem *item = overlayTable_->item(row, col);
+            return item ? item->text().trimmed() : QString();
+        };
+        const auto number = [&](int col, quint64 *value) {
+            if (parseNumber(text(col), value)) return true;
+            *error = tr("Field %1: \"%2\" is not a number.").arg(row + 1).arg(text(col));
+            return false;
+        };
+
+        const auto *combo = qobject_cast<QComboBox *>(overlayTable_->cellWidget(row, ColGenerator));
+        const GeneratorChoice &choice = kGenerators[combo ? combo->currentIndex() : 0];
+
+        UnitOverlay::Field f;
+        f.generator = choice.generator;
+        f.bigEndian = choice.bigEndian;
+        quint64 offset = 0, length = 0;
+        if (!number(ColOffset, &offset)) return false;
+        f.offset = qint64(offset);
+
+        if (f.generator == UnitOverlay::Generator::Crc32) {
+            // first-last, inclusive
+            const QStringList range = text(ColPattern).split('-');
+            quint64 first = 0, last = 0;
+            if (range.size() != 2 || !parseNumber(range.at(0), &first)
+                || !parseNumber(range.at(1), &last) || last < first) {
+                *error = tr("Field %1: the CRC range should read first-last, e.g. 0x0-0x7FFB.").arg(row + 1);
+                return false;
+            }
+            f.rangeFrom   = qint64(first);
+            f.rangeLength = qint64(last - first + 1);
+        } else {
+            if (!number(ColStart, &f.start) || !number(ColStep, &f.step)) return false;
+            f.pattern = text(ColPattern);
+        }
+
+        if (text(ColLength).isEmpty()) {
+            length = f.generator == UnitOverlay::Generator::HexText ? quint64(f.pattern.size()) : 4;
+        } else if (!number(ColLength, &length)) {
+            return false;
+        }
+        f.length = int(qMin<quint64>(length, std::numeric_limits<int>::max()));
+        overlay->fields << f;
+    }
+    return true;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <QDateTime>
+#include <QDialog>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+
+#include "BatchStats.h"
+#include "BufferEngine.h"
+#include "ProcessHandling.h"
+#include "UnitOverlay.h"
+
+class QCheckBox;
+class QComboBox;
+class QLabel;
+class QPlainTextEdit;
+class QProgressBar;
+class QPushButton;
+class QSpinBox;
+class QTableWidget;
+
+// Production batch: the same image programmed into chip after chip.
+//
+// The image and chip settings are taken once when the window opens; each
+// unit is one pipeline run fed from that snapshot, so nothing is exported
+// or looked up again between chips. After a unit the window either waits
+// for the operator to press Next or carries on by itself after a delay.
+// Counters, stage times and failure reasons update as units finish and can
+// be exported as CSV. Per-unit data (serials, checksums) is laid over the
+// snapshot for each unit, which leaves the snapshot itself untouched.
+class BatchWindow : public QDialog {
+    Q_OBJECT
+public:
+    BatchWindow(const QString &programmer,
+                const QString &device,
+                const BufferEngine &image,
+                const QStringList &extraFlags,
+                bool verify,
+                QWidget *parent = nullptr);
+    ~BatchWindow() override;
+
+    // Asks first while a unit is being programmed
+    void reject() override;
+
+private:
+    enum class State { Idle, WaitingForChip, Running };
+
+    void startBatch();
+    void stopBatch();
+    void runUnit();
+    void unitDone(bool ok, const QList<ProgramPipeline::StageResult> &results);
+    void setState(State state);
+    void refreshStats();
+    void exportCsv();
+    void addOverlayRow();
+    bool readOverlay(UnitOverlay *overlay, QString *error) const;
+
+    QString      programmer_;
+    QString      device_;
+    BufferEngine image_;
+    QStringList  extraFlags_;
+    bool         verify_{true};
+
+    QThread          procThread_;
+    ProcessHandling *proc_{};
+
+    State       state_{State::Idle};
+    bool        stopRequested_{false};
+    int         unitNumber_{0};
+    QDateTime   unitStarted_;
+    QDateTime   lastEnded_;
+    QStringList unitErrors_;    // error lines of the running unit
+    QString     unitData_;      // per-unit values of the running unit
+    UnitOverlay overlay_;
+    BatchStats  stats_;
+    QTimer      nextTimer_;     // automatic continue
+    QTimer      clock_;         // keeps units/hour current
+
+    QCheckBox      *chkPipeline_{};
+    QTableWidget   *overlayTable_{};
+    QPushButton    *btnAddField_{};
+    QPushButton    *btnRemoveField_{};
+    QComboBox      *comboNext_{};
+    QSpinBox       *spinDelay_{};
+    QPushButton    *btnStart_{};
+    QPushButton    *btnNext_{};
+    QPushButton    *btnStop_{};
+    QPushButton    *btnExport_{};
+    QLabel         *status_{};
+    QProgressBar   *bar_{};
+    QLabel         *counters_{};
+    QTableWidget   *stageTable_{};
+    QTableWidget   *reasonTable_{};
+    QPlainTextEdit *log_{};
+};
@@ -0,0 +1,300 @@
+#include "BinaryDiff.h"
+
+#include <QThread>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Hunk = BinaryDiff::Hunk;
+
+constexpr qint64 kWindow = 64;            // bytes an anchor hash covers
+constexpr int    kAnchorBits = 8;         // about one anchor per 256 bytes
+constexpr qint64 kMyersMax = 16 << 10;    // longest gap side Myers runs on
+constexpr int    kMaxEdits = 512;         // Myers gives up past this
+constexpr qint64 kJoin = 8;               // equal runs up to this long join hunks
+
+// Random 64-bit value per byte (splitmix64) for the gear hash
+const std::array<quint64, 256> &gearTable() {
+    static const std::array<quint64, 256> table = [] {
+        std::array<quint64, 256> t{};
+        quint64 x = 0x9E3779B97F4A7C15ull;
+        for (auto &v : t) {
+            quint64 z = (x += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            v = z ^ (z >> 31);
+        }
+        return t;
+    }();
+    return table;
+}
+
+struct Anchor {
+    quint64 key{0};
+    qint64  pos{0};                       // first byte of the window
+};
+
+// Anchors of data, at least kWindow apart. Each byte shifts the hash one
+// bit left, so after 64 bytes it only depends on the last 64.
+std::vector<Anchor> findAnchors(const uchar *data, qint64 size) {
+    const auto &gear = gearTable();
+    std::vector<Anchor> out;
+    out.reserve(size_t(size >> kAnchorBits) + 1);
+    quint64 h = 0;
+    qint64 next = kWindow - 1;
+    for (qint64 i = 0; i < size; ++i) {
+        h = (h << 1) + gear[data[i]];
+        if (i >= next && (h >> (64 - kAnchorBits)) == 0) {
+            out.push_back({ h, i - kWindow + 1 });
+            next = i + kWindow;
+        }
+    }
+    return out;
+}
+
+// Keeps the anchors whose key appears once, sorted by key
+void keepUnique(std::vector<Anchor> &anchors) {
+    std::sort(anchors.begin(), anchors.end(), [](const Anchor &x, const Anchor &y) {
+        return x.key < y.key;
+    });
+    size_t kept = 0;
+    for (size_t i = 0; i < anchors.size();) {
+        size_t j = i + 1;
+        while (j < anchors.size() && anchors[j].key == anchors[i].key) ++j;
+        if (j == i + 1) anchors[kept++] = anchors[i];
+        i = j;
+    }
+    anchors.resize(kept);
+}
+
+struct Pair {
+    qint64 a{0};
+    qint64 b{0};
+};
+
+// Longest chain of pairs ascending in both a and b; pairs sorted by a
+std::vector<Pair> longestChain(const std::vector<Pair> &pairs) {
+    std::vector<int> tails;               // index of the last pair per chain length
+    std::vector<int> prev(pairs.size(), -1);
+    for (int i = 0; i < int(pairs.size()); ++i) {
+        const auto it = std::lower_bound(tails.begin(), tails.end(), pairs[size_t(i)].b,
+                                         [&](int t, qint64 b) { return pairs[size_t(t)].b < b; });
+        if (it != tails.begin()) prev[size_t(i)] = *(it - 1);
+        if (it == tails.end()) tails.push_back(i);
+        else *it = i;
+    }
+    std::vector<Pair> chain(tails.size());
+    for (int i = tails.empty() ? -1 : tails.back(), n = int(tails.size()); i >= 0; i = prev[size_t(i)])
+        chain[size_t(--n)] = pairs[size_t(i)];
+    return chain;
+}
+
+// Joins h to the last hunk when at most 'join' equal bytes lie between
+void push(std::vector<Hunk> &out, const Hunk &h, qint64 join = 0) {
+    if (h.aLength == 0 && h.bLength == 0) return;
+    if (!out.empty()) {
+        Hunk &last = out.back();
+        const qint64 equal = h.aPos - (last.aPos + last.aLength);
+        if (equal <= join && h.bPos - (last.bPos + last.bLength) == equal) {
+            last.aLength = h.aPos + h.aLength - last.aPos;
+            last.bLength = h.bPos + h.bLength - last.bPos;
+            return;
+        }
+    }
+    out.push_back(h);
+}
+
+// Length of the common prefix, 64 bytes per memcmp while it lasts
+qint64 commonPrefix(const uchar *a, const uchar *b, qint64 n) {
+    qint64 i = 0;
+    while (i + kWindow <= n && std::memcmp(a + i, b + i, size_t(kWindow)) == 0) i += kWindow;
+    while (i < n && a[i] == b[i]) ++i;
+    return i;
+}
+
+qint64 commonSuffix(const uchar *a, qint64 na, const uchar *b, qint64 nb) {
+    const qint64 n = std::min(na, nb);
+    qint64 i = 0;
+    while (i < n && a[na - 1 - i] == b[nb - 1 - i]) ++i;
+    return i;
+}
+
+// Shortest edit script between a[0, n) and b[0, m) as hunks; false when it
+// needs more than kMaxEdits insertions and deletions
+bool myers(const uchar *a, int n, const uchar *b, int m, qint64 aBase, qint64 bBase,
+           std::vector<Hunk> &out) {
+    const int maxD = std::min(n + m, kMaxEdits);
+    const int off = maxD + 1;
+    std::vector<int> v(size_t(2 * maxD + 3), 0);    // furthest x per diagonal k = x - y
+    std::vector<std::vector<int>> trace;             // v before each step
+
+    int finalD = -1;
+    for (int d = 0; d <= maxD && finalD < 0; ++d) {
+        trace.push_back(v);
+        for (int k = -d; k <= d; k += 2) {
+            int x = (k == -d || (k != d && v[size_t(off + k - 1)] < v[size_t(off + k + 1)]))
+                        ? v[size_t(off + k + 1)]     // down: insert b[y]
+                        : v[size_t(off + k - 1)] + 1; // right: delete a[x]
+            int y = x - k;
+            while (x < n && y < m && a[x] == b[y]) { ++x; ++y; }
+            v[size_t(off + k)] = x;
+            if (x >= n && y >= m) { finalD = d; break; }
+        }
+    }
+    if (finalD < 0) return false;
+
+    // Walk back to (0, 0), one edit per step; (x, y) is where the edit starts
+    struct Edit { int x; int y; bool insert; };
+    std::vector<Edit> edits;
+    int x = n, y = m;
+    for (int d = finalD; d > 0; --d) {
+        const std::vector<int> &pv = trace[size_t(d)];
+        const int k = x - y;
+        const bool down = k == -d || (k != d && pv[size_t(off + k - 1)] < pv[size_t(off + k + 1)]);
+        const int prevK = down ? k + 1 : k - 1;
+        x = pv[size_t(off + prevK)];
+        y = x - prevK;
+        edits.push_back({ x, y, down });
+    }
+    for (auto it = edits.rbegin(); it != edits.rend(); ++it) {
+        const qint64 ax = aBase + it->x;
+        const qint64 by = bBase + it->y;
+        push(out, it->insert ? Hunk{ ax, 0, by, 1 } : Hunk{ ax, 1, by, 0 });
+    }
+    return true;
+}
+
+// Runs of differing bytes between two equally long ranges
+void positional(const uchar *a, const uchar *b, qint64 n, qint64 aBase, qint64 bBase,
+                std::vector<Hunk> &out) {
+    qint64 i = 0;
+    while (i < n) {
+        i += commonPrefix(a + i, b + i, n - i);
+        if (i == n) break;
+        const qint64 start = i;
+        while (i < n && a[i] != b[i]) ++i;
+        push(out, { aBase + start, i - start, bBase + start, i - start });
+    }
+}
+
+struct Gap {
+    qint64 aPos{0};
+    qint64 aLength{0};
+    qint64 bPos{0};
+    qint64 bLength{0};
+};
+
+void diffGap(const uchar *a, const uchar *b, Gap g, std::vector<Hunk> &out) {
+    const qint64 prefix = commonPrefix(a + g.aPos, b + g.bPos, std::min(g.aLength, g.bLength));
+    g.aPos += prefix; g.aLength -= prefix;
+    g.bPos += prefix; g.bLength -= prefix;
+    const qint64 suffix = commonSuffix(a + g.aPos, g.aLength, b + g.bPos, g.bLength);
+    g.aLength -= suffix;
+    g.bLength -= suffix;
+
+    if (g.aLength == 0 || g.bLength == 0) {
+        push(out, { g.aPos, g.aLength, g.bPos, g.bLength });
+        return;
+    }
+    if (g.aLength <= kMyersMax && g.bLength <= kMyersMax
+        && myers(a + g.aPos, int(g.aLength), b + g.bPos, int(g.bLength), g.aPos, g.bPos, out))
+        return;
+    if (g.aLength == g.bLength)
+        positional(a + g.aPos, b + g.bPos, g.aLength, g.aPos, g.bPos, out);
+    else
+        push(out, { g.aPos, g.aLength, g.bPos, g.bLength });
+}
+
+qint64 map(const QList<Hunk> &hunks, qint64 off, bool fromA) {
+    const auto start = [fromA](const Hunk &h) { return fromA ? h.aPos : h.bPos; };
+    const auto it = std::upper_bound(hunks.cbegin(), hunks.cend(), off,
+                                     [&](qint64 o, const Hunk &h) { return o < start(h); });
+    if (it == hunks.cbegin()) return off;
+    const Hunk &h = *(it - 1);
+    const qint64 s = start(h);
+    const qint64 l = fromA ? h.aLength : h.bLength;
+    const qint64 t = fromA ? h.bPos : h.aPos;
+    const qint64 tl = fromA ? h.bLength : h.aLength;
+    if (off < s + l) return t + std::min(off - s, std::max<qint64>(0, tl - 1));
+    return t + tl + (off - s - l);
+}
+
+} // namespace
+
+QList<BinaryDiff::Hunk> BinaryDiff::diff(const uchar *a, qint64 aSize, const uchar *b, qint64 bSize,
+                                         const std::atomic<bool> *cancel) {
+    const auto cancelled = [cancel] { return cancel && cancel->load(std::memory_order_relaxed); };
+    QList<Hunk> result;
+    if (aSize == bSize && std::memcmp(a, b, size_t(aSize)) == 0) return result;
+
+    // Anchors of both sides at once
+    std::vector<Anchor> anchorsA;
+    std::thread hashA([&]{ anchorsA = findAnchors(a, aSize); keepUnique(anchorsA); });
+    std::vector<Anchor> anchorsB = findAnchors(b, bSize);
+    keepUnique(anchorsB);
+    hashA.join();
+    if (cancelled()) return result;
+
+    // Keys unique on both sides whose bytes really match
+    std::vector<Pair> pairs;
+    for (size_t i = 0, j = 0; i < anchorsA.size() && j < anchorsB.size();) {
+        if (anchorsA[i].key < anchorsB[j].key) ++i;
+        else if (anchorsB[j].key < anchorsA[i].key) ++j;
+        else {
+            const Anchor &x = anchorsA[i++];
+            const Anchor &y = anchorsB[j++];
+            if (std::memcmp(a + x.pos, b + y.pos, size_t(kWindow)) == 0) pairs.push_back({ x.pos, y.pos });
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const Pair &x, const Pair &y) { return x.a < y.a; });
+    const std::vector<Pair> chain = longestChain(pairs);
+
+    // Each anchor's match runs on as far as the bytes agree; what lies
+    // between the runs is left for the gap diff
+    std::vector<Gap> gaps;
+    qint64 ca = 0, cb = 0;
+    for (const Pair &p : chain) {
+        if (p.a < ca || p.b < cb) continue;   // inside the previous run
+        if (p.a > ca || p.b > cb) gaps.push_back({ ca, p.a - ca, cb, p.b - cb });
+        const qint64 run = commonPrefix(a + p.a, b + p.b, std::min(aSize - p.a, bSize - p.b));
+        ca = p.a + run;
+        cb = p.b + run;
+    }
+    if (ca < aSize || cb < bSize) gaps.push_back({ ca, aSize - ca, cb, bSize - cb });
+
+    std::vector<std::vector<Hunk>> found(gaps.size());
+    std::atomic<int> next{0};
+    const int count = int(gaps.size());
+    const auto run = [&]{
+        for (int i; !cancelled() && (i = next.fetch_add(1)) < count;)
+            diffGap(a, b, gaps[size_t(i)], found[size_t(i)]);
+    };
+    const int threads = std::min(count, std::max(1, QThread::idealThreadCount()));
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) workers.emplace_back(run);
+    run();
+    for (auto &w : workers) w.join();
+    if (cancelled()) return result;
+
+    // A few equal bytes inside a rewritten range would only split it up
+    std::vector<Hunk> joined;
+    for (const auto &hunks : found)
+        for (const Hunk &h : hunks) push(joined, h, kJoin);
+    result.reserve(qsizetype(joined.size()));
+    for (const Hunk &h : joined) result << h;
+    return result;
+}
+
+qint64 BinaryDiff::mapAtoB(const QList<Hunk> &hunks, qint64 off) {
+    return map(hunks, off, true);
+}
+
+qint64 BinaryDiff::mapBtoA(const QList<Hunk> &hunks, qint64 off) {
+    return map(hunks, off, false);
+}
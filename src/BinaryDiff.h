@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QList>
+#include <QtGlobal>
+
+#include <atomic>
+
+// Alignment of two byte images that tolerates inserted and deleted bytes.
+//
+// Both images are cut at content-defined anchors: a rolling hash over the
+// last 64 bytes picks about one position in 256, so the same bytes give the
+// same anchors wherever they moved to. Anchors that occur exactly once in
+// each image are paired up and the longest run of pairs that keeps its
+// order in both becomes the alignment. Between two anchors a bounded Myers
+// diff finds the exact insertions and deletions; gaps too large or too
+// different for it are compared byte for byte, or reported as one change.
+// Hashing and the gaps run on all cores, so images of hundreds of
+// megabytes align in seconds.
+class BinaryDiff {
+public:
+    // [aPos, aPos+aLength) in a became [bPos, bPos+bLength) in b; one of
+    // the lengths is 0 for a pure insertion or deletion
+    struct Hunk {
+        qint64 aPos{0};
+        qint64 aLength{0};
+        qint64 bPos{0};
+        qint64 bLength{0};
+    };
+
+    // Differences in ascending order; bytes between hunks are equal. Once
+    // *cancel is set the work stops early and the result is meaningless.
+    static QList<Hunk> diff(const uchar *a, qint64 aSize, const uchar *b, qint64 bSize,
+                            const std::atomic<bool> *cancel = nullptr);
+
+    // Offset of the byte on the other side that lines up with off; bytes
+    // inside a hunk map into the hunk on the other side
+    static qint64 mapAtoB(const QList<Hunk> &hunks, qint64 off);
+    static qint64 mapBtoA(const QList<Hunk> &hunks, qint64 off);
+};
@@ -0,0 +1,68 @@
+#include "BufferCompare.h"
+
+#include "BufferEngine.h"
+
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr qint64 kBlock = 4 << 20;     // per task
+constexpr qint64 kStride = 64;         // bytes per memcmp
+
+using Ranges = std::vector<std::pair<qint64, qint64>>;
+
+// Differing runs of pa/pb as [start, end), offset by base
+void diffBlock(const uchar *pa, const uchar *pb, qint64 n, qint64 base, Ranges &out) {
+    qint64 i = 0;
+    while (i < n) {
+        while (i + kStride <= n && std::memcmp(pa + i, pb + i, size_t(kStride)) == 0) i += kStride;
+        const qint64 stop = std::min(n, i + kStride);
+        while (i < stop && pa[i] == pb[i]) ++i;
+        if (i == stop) continue;
+        const qint64 start = i;
+        while (i < n && pa[i] != pb[i]) ++i;
+        out.emplace_back(base + start, base + i);
+    }
+}
+
+} // namespace
+
+BufferCompare::Result BufferCompare::compare(const BufferEngine &a, const BufferEngine &b) {
+    Result result;
+    result.sizeA = a.size();
+    result.sizeB = b.size();
+    const qint64 common = std::min(result.sizeA, result.sizeB);
+
+    const int blocks = int((common + kBlock - 1) / kBlock);
+    std::vector<Ranges> found(size_t(blocks));
+    std::atomic<int> next{0};
+    const auto run = [&]{
+        std::vector<uchar> bufA(size_t(std::min(kBlock, common)));
+        std::vector<uchar> bufB(bufA.size());
+        for (int i; (i = next.fetch_add(1)) < blocks;) {
+            const qint64 pos = qint64(i) * kBlock;
+            const qint64 n = std::min(kBlock, common - pos);
+            a.read(pos, reinterpret_cast<char *>(bufA.data()), n);
+            b.read(pos, reinterpret_cast<char *>(bufB.data()), n);
+            diffBlock(bufA.data(), bufB.data(), n, pos, found[size_t(i)]);
+        }
+    };
+    const int threads = std::min(blocks, std::max(1, QThread::idealThreadCount()));
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) workers.emplace_back(run);
+    run();
+    for (auto &w : workers) w.join();
+
+    // In order, so runs across a block boundary merge into one
+    for (const Ranges &ranges : found)
+        for (const auto &r : ranges) result.mismatches.add(r.first, r.second - r.first);
+    if (result.sizeA > common) result.mismatches.add(common, result.sizeA - common);
+    return result;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include "DirtyRanges.h"
+
+class BufferEngine;
+
+// Byte-for-byte comparison of two images, as the ranges where they differ.
+//
+// The common length is cut into blocks that are compared on all cores.
+// Equal stretches are skipped 64 bytes per memcmp, which the C library
+// does with vector instructions; only blocks that differ are looked at a
+// byte at a time. The differing ranges go into a DirtyRanges, which keeps
+// touching ranges merged and answers next/previous queries in O(log n).
+class BufferCompare {
+public:
+    struct Result {
+        DirtyRanges mismatches;     // offsets into a; a's bytes past b's end count too
+        qint64      sizeA{0};
+        qint64      sizeB{0};
+    };
+
+    static Result compare(const BufferEngine &a, const BufferEngine &b);
+};
@@ -0,0 +1,74 @@
+#include "BufferDocument.h"
+
+#include <algorithm>
+
+BufferDocument::BufferDocument(QObject *parent) : QObject(parent) {}
+
+void BufferDocument::clear() {
+    engine_.clear();
+    emit reset();
+}
+
+void BufferDocument::insert(qint64 pos, const BufferSource &data) {
+    if (data.isEmpty()) return;
+    pos = std::clamp<qint64>(pos, 0, size());
+    engine_.insert(pos, data);
+    emit bytesInserted(pos, data.size());
+}
+
+void BufferDocument::insertFill(qint64 pos, qint64 length, char value) {
+    if (length <= 0) return;
+    pos = std::clamp<qint64>(pos, 0, size());
+    engine_.insertFill(pos, length, value);
+    emit bytesInserted(pos, length);
+}
+
+void BufferDocument::remove(qint64 pos, qint64 length) {
+    const qint64 total = size();
+    if (pos < 0 || pos >= total || length <= 0) return;
+    length = std::min(length, total - pos);
+    engine_.remove(pos, length);
+    emit bytesRemoved(pos, length);
+}
+
+void BufferDocument::move(qint64 from, qint64 length, qint64 to) {
+    const qint64 total = size();
+    if (from < 0 || from >= total || length <= 0) return;
+    length = std::min(length, total - from);
+    to = std::clamp<qint64>(to, 0, total - length);
+    engine_.move(from, length, to);
+    if (to != from) emit bytesMoved(from, length, to);
+}
+
+void BufferDocument::overwrite(qint64 pos, const BufferSource &data) {
+    const qint64 total = size();
+    if (data.isEmpty() || pos < 0 || pos > total) return;
+    engine_.overwrite(pos, data);
+    // Part of it may have landed past the old end
+    const qint64 changed = std::min(data.size(), total - pos);
+    if (changed > 0) emit bytesChanged(pos, changed);
+    if (data.size() > changed) emit bytesInserted(total, data.size() - changed);
+}
+
+void BufferDocument::fill(qint64 pos, qint64 length, char value) {
+    const qint64 total = size();
+    if (pos < 0 || pos >= total || length <= 0) return;
+    length = std::min(length, total - pos);
+    engine_.fill(pos, length, value);
+    emit bytesChanged(pos, length);
+}
+
+bool BufferDocument::setByte(qint64 pos, char value) {
+    if (!engine_.setByte(pos, value)) return false;
+    emit bytesChanged(pos, 1);
+    return true;
+}
+
+void BufferDocument::place(qint64 offset, const BufferSource &data, qint64 length, char padByte) {
+    if (offset < 0 || length <= 0) return;
+    const qint64 take = std::min(length, data.size());
+    if (offset > size()) appendFill(offset - size(), padByte);
+    overwrite(offset, data.mid(0, take));
+    if (offset + length > size()) appendFill(offset + length - size(), padByte);
+    if (length > take) fill(offset + take, length - take, padByte);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QObject>
+
+#include "BufferEngine.h"
+
+// The editable buffer as seen by the UI.
+//
+// Wraps a BufferEngine and announces every mutation with the exact range it
+// touched, already clamped to the buffer. Views listen to these instead of
+// being reset, so their work is proportional to the change.
+class BufferDocument : public QObject {
+    Q_OBJECT
+public:
+    explicit BufferDocument(QObject *parent = nullptr);
+
+    const BufferEngine &engine() const { return engine_; }
+
+    // Read access
+    qint64     size() const { return engine_.size(); }
+    bool       isEmpty() const { return engine_.isEmpty(); }
+    char       at(qint64 pos) const { return engine_.at(pos); }
+    QByteArray read(qint64 pos, qint64 length) const { return engine_.read(pos, length); }
+    qint64     read(qint64 pos, char *dst, qint64 length) const { return engine_.read(pos, dst, length); }
+    bool forEachChunk(qint64 pos, qint64 length, const BufferEngine::ChunkFn &fn) const {
+        return engine_.forEachChunk(pos, length, fn);
+    }
+    bool writeTo(QIODevice *dev, qint64 pos = 0, qint64 length = -1) const {
+        return engine_.writeTo(dev, pos, length);
+    }
+
+    // Mutations, same semantics as BufferEngine
+    void clear();
+    void insert(qint64 pos, const BufferSource &data);
+    void insertFill(qint64 pos, qint64 length, char value);
+    void append(const BufferSource &data) { insert(size(), data); }
+    void appendFill(qint64 length, char value) { insertFill(size(), length, value); }
+    void remove(qint64 pos, qint64 length);
+    void move(qint64 from, qint64 length, qint64 to);
+    void overwrite(qint64 pos, const BufferSource &data);
+    void fill(qint64 pos, qint64 length, char value);
+    bool setByte(qint64 pos, char value);
+    // As the load dialog places a file: pad up to offset, then the data cut
+    // or padded to length
+    void place(qint64 offset, const BufferSource &data, qint64 length, char padByte);
+
+signals:
+    // Everything may have changed (cleared)
+    void reset();
+    // [pos, pos+length) is new; bytes from pos on moved up by length
+    void bytesInserted(qint64 pos, qint64 length);
+    // [pos, pos+length) is gone; bytes after it moved down by length
+    void bytesRemoved(qint64 pos, qint64 length);
+    // [from, from+length) now starts at 'to', measured with it removed
+    void bytesMoved(qint64 from, qint64 length, qint64 to);
+    // [pos, pos+length) has new contents, nothing moved
+    void bytesChanged(qint64 pos, qint64 length);
+
+private:
+    BufferEngine engine_;
+};
@@ -0,0 +1,387 @@
+#include "BufferEngine.h"
+
+#include <QFile>
+#include <QIODevice>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+// Granularity of the private copy made when a byte inside a shared piece is edited
+constexpr qint64 kEditPage = 4096;
+// Chunk size used when materializing fill pieces for readers
+constexpr qint64 kFillChunk = 64 * 1024;
+}
+
+BufferSource::BufferSource(const QByteArray &bytes)
+    : bytes_(bytes), offset_(0), length_(bytes.size()) {}
+
+BufferSource BufferSource::mapFile(const QString &path, QString *errorString) {
+    auto file = std::make_shared<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+        if (errorString) *errorString = file->errorString();
+        return {};
+    }
+    const qint64 size = file->size();
+    if (size <= 0) return {};
+
+    // Private mapping: our edits never reach the file. The mapping lives as
+    // long as the QFile, which every piece slicing this source shares.
+    // It does not guard against the file itself being truncated or rewritten
+    // in place, which shows up as SIGBUS or changed bytes on the next read, so
+    // saves go through QSaveFile and replace the file instead of rewriting it.
+    uchar *mem = file->map(0, size, QFileDevice::MapPrivateOption);
+    if (!mem) {
+        const QByteArray bytes = file->readAll();
+        if (bytes.size() != size) {
+            if (errorString) *errorString = file->errorString();
+            return {};
+        }
+        return BufferSource(bytes);
+    }
+
+    BufferSource out;
+    out.bytes_ = QByteArray::fromRawData(reinterpret_cast<const char *>(mem), size);
+    out.length_ = size;
+    out.mapping_ = std::move(file);
+    return out;
+}
+
+BufferSource BufferSource::mid(qint64 offset, qint64 length) const {
+    BufferSource out(*this);
+    offset = std::clamp<qint64>(offset, 0, length_);
+    if (length < 0 || offset + length > length_) length = length_ - offset;
+    out.offset_ = offset_ + offset;
+    out.length_ = length;
+    return out;
+}
+
+char *BufferSource::mutableData() {
+    return bytes_.data() + offset_;
+}
+
+struct BufferEngine::Node {
+    Piece   piece;
+    quint32 priority{};
+    qint64  total{};   // bytes in this subtree
+    int     count{};   // pieces in this subtree
+    NodePtr left;
+    NodePtr right;
+};
+
+BufferEngine::BufferEngine() = default;
+BufferEngine::BufferEngine(BufferEngine &&other) noexcept = default;
+BufferEngine &BufferEngine::operator=(BufferEngine &&other) noexcept = default;
+BufferEngine::~BufferEngine() = default;
+
+BufferEngine::BufferEngine(const BufferEngine &other)
+    : root_(clone(other.root_.get())), seed_(other.seed_) {}
+
+BufferEngine &BufferEngine::operator=(const BufferEngine &other) {
+    if (this != &other) {
+        root_ = clone(other.root_.get());
+        seed_ = other.seed_;
+    }
+    return *this;
+}
+
+BufferEngine::NodePtr BufferEngine::clone(const Node *n) {
+    if (!n) return {};
+    auto c = std::make_unique<Node>();
+    c->piece    = n->piece;
+    c->priority = n->priority;
+    c->total    = n->total;
+    c->count    = n->count;
+    c->left     = clone(n->left.get());
+    c->right    = clone(n->right.get());
+    return c;
+}
+
+BufferEngine::NodePtr BufferEngine::makeNode(Piece piece) {
+    // xorshift32, deterministic per buffer
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    auto n = std::make_unique<Node>();
+    n->piece = std::move(piece);
+    n->priority = seed_;
+    update(n.get());
+    return n;
+}
+
+qint64 BufferEngine::totalOf(const Node *n) {
+    return n ? n->total : 0;
+}
+
+void BufferEngine::update(Node *n) {
+    if (!n) return;
+    n->total = totalOf(n->left.get()) + n->piece.length + totalOf(n->right.get());
+    n->count = 1 + (n->left ? n->left->count : 0) + (n->right ? n->right->count : 0);
+}
+
+BufferEngine::NodePtr BufferEngine::merge(NodePtr a, NodePtr b) {
+    if (!a) return b;
+    if (!b) return a;
+    if (a->priority > b->priority) {
+        a->right = merge(std::move(a->right), std::move(b));
+        update(a.get());
+        return a;
+    }
+    b->left = merge(std::move(a), std::move(b->left));
+    update(b.get());
+    return b;
+}
+
+// Split t so that the returned tree holds the first pos bytes and rightOut
+// the rest. A piece straddling pos is cut in two.
+BufferEngine::NodePtr BufferEngine::split(NodePtr t, qint64 pos, NodePtr &rightOut) {
+    if (!t) { rightOut.reset(); return {}; }
+
+    const qint64 leftSize = totalOf(t->left.get());
+    const qint64 len = t->piece.length;
+
+    if (pos <= leftSize) {
+        NodePtr r;
+        NodePtr l = split(std::move(t->left), pos, r);
+        t->left = std::move(r);
+        update(t.get());
+        rightOut = std::move(t);
+        return l;
+    }
+    if (pos >= leftSize + len) {
+        NodePtr r;
+        t->right = split(std::move(t->right), pos - leftSize - len, r);
+        update(t.get());
+        rightOut = std::move(r);
+        return t;
+    }
+
+    // Cut inside this piece: head stays in t, tail becomes a new node
+    const qint64 cut = pos - leftSize;
+    Piece tail = t->piece;
+    tail.length = len - cut;
+    if (!tail.isFill) tail.src = t->piece.src.mid(cut);
+    t->piece.length = cut;
+    if (!t->piece.isFill) t->piece.src = t->piece.src.mid(0, cut);
+
+    rightOut = merge(makeNode(std::move(tail)), std::move(t->right));
+    update(t.get());
+    return t;
+}
+
+// Replace [pos, pos+length) with the given subtree (which may be empty)
+void BufferEngine::replaceRange(qint64 pos, qint64 length, NodePtr middle) {
+    NodePtr rest;
+    NodePtr left = split(std::move(root_), pos, rest);
+    NodePtr right;
+    NodePtr dropped = split(std::move(rest), length, right);
+    dropped.reset();
+    root_ = merge(merge(std::move(left), std::move(middle)), std::move(right));
+}
+
+qint64 BufferEngine::size() const {
+    return totalOf(root_.get());
+}
+
+int BufferEngine::pieceCount() const {
+    return root_ ? root_->count : 0;
+}
+
+void BufferEngine::clear() {
+    root_.reset();
+}
+
+void BufferEngine::insert(qint64 pos, const BufferSource &data) {
+    if (data.isEmpty()) return;
+    pos = std::clamp<qint64>(pos, 0, size());
+    Piece p;
+    p.src = data;
+    p.length = data.size();
+    replaceRange(pos, 0, makeNode(std::move(p)));
+}
+
+void BufferEngine::insertFill(qint64 pos, qint64 length, char value) {
+    if (length <= 0) return;
+    pos = std::clamp<qint64>(pos, 0, size());
+    Piece p;
+    p.length = length;
+    p.fill = value;
+    p.isFill = true;
+    replaceRange(pos, 0, makeNode(std::move(p)));
+}
+
+void BufferEngine::remove(qint64 pos, qint64 length) {
+    const qint64 total = size();
+    if (pos < 0 || pos >= total || length <= 0) return;
+    length = std::min(length, total - pos);
+    replaceRange(pos, length, {});
+}
+
+void BufferEngine::move(qint64 from, qint64 length, qint64 to) {
+    const qint64 total = size();
+    if (from < 0 || from >= total || length <= 0) return;
+    length = std::min(length, total - from);
+
+    NodePtr rest;
+    NodePtr left = split(std::move(root_), from, rest);
+    NodePtr right;
+    NodePtr moving = split(std::move(rest), length, right);
+    root_ = merge(std::move(left), std::move(right));
+
+    to = std::clamp<qint64>(to, 0, size());
+    NodePtr tail;
+    NodePtr head = split(std::move(root_), to, tail);
+    root_ = merge(merge(std::move(head), std::move(moving)), std::move(tail));
+}
+
+void BufferEngine::overwrite(qint64 pos, const BufferSource &data) {
+    if (data.isEmpty()) return;
+    const qint64 total = size();
+    if (pos < 0 || pos > total) return;
+    Piece p;
+    p.src = data;
+    p.length = data.size();
+    replaceRange(pos, std::min(data.size(), total - pos), makeNode(std::move(p)));
+}
+
+void BufferEngine::fill(qint64 pos, qint64 length, char value) {
+    const qint64 total = size();
+    if (pos < 0 || pos >= total || length <= 0) return;
+    length = std::min(length, total - pos);
+    Piece p;
+    p.length = length;
+    p.fill = value;
+    p.isFill = true;
+    replaceRange(pos, length, makeNode(std::move(p)));
+}
+
+bool BufferEngine::setByte(qint64 pos, char value) {
+    if (pos < 0 || pos >= size()) return false;
+
+    // Locate the piece holding pos
+    Node *n = root_.get();
+    qint64 base = 0;
+    while (n) {
+        const qint64 leftSize = totalOf(n->left.get());
+        if (pos < base + leftSize) { n = n->left.get(); continue; }
+        if (pos >= base + leftSize + n->piece.length) {
+            base += leftSize + n->piece.length;
+            n = n->right.get();
+            continue;
+        }
+        base += leftSize;
+        break;
+    }
+    if (!n) return false;
+
+    Piece &piece = n->piece;
+    const qint64 local = pos - base;
+    const char old = piece.isFill ? piece.fill : piece.src.constData()[local];
+    if (old == value) return false;
+
+    if (piece.owned) {
+        piece.src.mutableData()[local] = value;
+        return true;
+    }
+
+    // Copy out the surrounding page of this piece and edit the private copy
+    const qint64 pageBeg = local - (local % kEditPage);
+    const qint64 pageEnd = std::min(piece.length, pageBeg + kEditPage);
+    QByteArray page;
+    if (piece.isFill) {
+        page = QByteArray(pageEnd - pageBeg, piece.fill);
+    } else {
+        page = QByteArray(piece.src.constData() + pageBeg, pageEnd - pageBeg);
+    }
+    page[local - pageBeg] = value;
+
+    Piece edited;
+    edited.src = page;
+    edited.length = page.size();
+    edited.owned = true;
+    replaceRange(base + pageBeg, pageEnd - pageBeg, makeNode(std::move(edited)));
+    return true;
+}
+
+char BufferEngine::at(qint64 pos) const {
+    const Node *n = root_.get();
+    while (n) {
+        const qint64 leftSize = totalOf(n->left.get());
+        if (pos < leftSize) { n = n->left.get(); continue; }
+        pos -= leftSize;
+        if (pos < n->piece.length) {
+            return n->piece.isFill ? n->piece.fill : n->piece.src.constData()[pos];
+        }
+        pos -= n->piece.length;
+        n = n->right.get();
+    }
+    return 0;
+}
+
+bool BufferEngine::visit(const Node *n, qint64 base, qint64 pos, qint64 end, const ChunkFn &fn) {
+    if (!n || pos >= end) return true;
+    const qint64 leftSize = totalOf(n->left.get());
+    const qint64 pieceBeg = base + leftSize;
+    const qint64 pieceEnd = pieceBeg + n->piece.length;
+
+    if (pos < pieceBeg) {
+        if (!visit(n->left.get(), base, pos, end, fn)) return false;
+    }
+    if (pos < pieceEnd && end > pieceBeg) {
+        const qint64 b = std::max(pos, pieceBeg) - pieceBeg;
+        const qint64 e = std::min(end, pieceEnd) - pieceBeg;
+        if (n->piece.isFill) {
+            const QByteArray block(std::min(e - b, kFillChunk), n->piece.fill);
+            for (qint64 off = b; off < e; off += block.size()) {
+                if (!fn(block.constData(), std::min<qint64>(block.size(), e - off))) return false;
+            }
+        } else if (!fn(n->piece.src.constData() + b, e - b)) {
+            return false;
+        }
+    }
+    if (end > pieceEnd) {
+        if (!visit(n->right.get(), pieceEnd, pos, end, fn)) return false;
+    }
+    return true;
+}
+
+bool BufferEngine::forEachChunk(qint64 pos, qint64 length, const ChunkFn &fn) const {
+    const qint64 total = size();
+    if (pos < 0) pos = 0;
+    if (length < 0 || pos + length > total) length = total - pos;
+    if (length <= 0) return true;
+    return visit(root_.get(), 0, pos, pos + length, fn);
+}
+
+qint64 BufferEngine::read(qint64 pos, char *dst, qint64 length) const {
+    qint64 copied = 0;
+    forEachChunk(pos, length, [&](const char *data, qint64 n) {
+        std::memcpy(dst + copied, data, size_t(n));
+        copied += n;
+        return true;
+    });
+    return copied;
+}
+
+QByteArray BufferEngine::read(qint64 pos, qint64 length) const {
+    const qint64 total = size();
+    if (pos < 0 || pos >= total || length <= 0) return {};
+    length = std::min(length, total - pos);
+    QByteArray out(length, Qt::Uninitialized);
+    read(pos, out.data(), length);
+    return out;
+}
+
+BufferSource BufferEngine::flatten() const {
+    if (root_ && root_->count == 1 && !root_->piece.isFill)
+        return root_->piece.src.mid(0, root_->piece.length);
+    return BufferSource(read(0, size()));
+}
+
+bool BufferEngine::writeTo(QIODevice *dev, qint64 pos, qint64 length) const {
+    if (!dev) return false;
+    return forEachChunk(pos, length, [dev](const char *data, qint64 n) {
+        return dev->write(data, n) == n;
+    });
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <QByteArray>
+#include <QtGlobal>
+
+#include <functional>
+#include <memory>
+
+class QFile;
+class QIODevice;
+class QString;
+
+// Read-only view into a shared byte source. Pieces of the buffer reference
+// these instead of owning copies, so slicing a source never copies data.
+class BufferSource {
+public:
+    BufferSource() = default;
+    BufferSource(const QByteArray &bytes); // NOLINT: implicit on purpose
+
+    // Memory-map a file read-only (copy-on-write at the buffer level). Pages
+    // are only faulted in when read, so large dumps cost almost no resident
+    // memory. Falls back to reading the file if it cannot be mapped. On error
+    // returns an empty source and sets errorString.
+    static BufferSource mapFile(const QString &path, QString *errorString = nullptr);
+
+    qint64 size() const { return length_; }
+    bool   isEmpty() const { return length_ == 0; }
+    const char *constData() const { return bytes_.constData() + offset_; }
+
+    // Sub-range view, clamped to this source
+    BufferSource mid(qint64 offset, qint64 length = -1) const;
+
+private:
+    friend class BufferEngine;
+    char *mutableData(); // detaches the underlying QByteArray if shared
+
+    QByteArray bytes_;
+    qint64     offset_{};
+    qint64     length_{};
+    std::shared_ptr<QFile> mapping_; // keeps a mapped file alive, if any
+};
+
+// Piece-table byte buffer with 64-bit offsets.
+//
+// The buffer is an ordered sequence of pieces kept in a size-augmented treap,
+// so insert/remove/move of whole ranges are O(log n) in the number of pieces
+// and never touch the payload. Single-byte edits copy out one small page of
+// the affected piece (copy-on-write) and are written in place afterwards.
+//
+// Copying a BufferEngine clones the piece tree only; the byte sources are
+// shared, which makes cheap snapshots possible.
+class BufferEngine {
+public:
+    BufferEngine();
+    BufferEngine(const BufferEngine &other);
+    BufferEngine(BufferEngine &&other) noexcept;
+    BufferEngine &operator=(const BufferEngine &other);
+    BufferEngine &operator=(BufferEngine &&other) noexcept;
+    ~BufferEngine();
+
+    qint64 size() const;
+    bool   isEmpty() const { return size() == 0; }
+    int    pieceCount() const;
+
+    void clear();
+
+    // Insert bytes so that they start at pos (0 <= pos <= size())
+    void insert(qint64 pos, const BufferSource &data);
+    void insertFill(qint64 pos, qint64 length, char value);
+    void append(const BufferSource &data) { insert(size(), data); }
+    void appendFill(qint64 length, char value) { insertFill(size(), length, value); }
+
+    // Remove [pos, pos+length), clamped to the buffer
+    void remove(qint64 pos, qint64 length);
+
+    // Move [from, from+length) so that it starts at 'to', where 'to' is
+    // measured in the buffer with the range already removed.
+    void move(qint64 from, qint64 length, qint64 to);
+
+    // Replace bytes starting at pos (pos <= size()); grows the buffer if the
+    // data runs past the current end.
+    void overwrite(qint64 pos, const BufferSource &data);
+    void fill(qint64 pos, qint64 length, char value);
+
+    // Single byte edit; returns false if out of range or unchanged
+    bool setByte(qint64 pos, char value);
+
+    // Read access
+    char       at(qint64 pos) const;
+    QByteArray read(qint64 pos, qint64 length) const;
+    qint64     read(qint64 pos, char *dst, qint64 length) const;
+
+    // Visit the contiguous chunks covering [pos, pos+length) in order. The
+    // callback returns false to stop early. Returns false if stopped.
+    using ChunkFn = std::function<bool(const char *data, qint64 length)>;
+    bool forEachChunk(qint64 pos, qint64 length, const ChunkFn &fn) const;
+
+    // Stream [pos, pos+length) to a device without flattening the buffer
+    bool writeTo(QIODevice *dev, qint64 pos = 0, qint64 length = -1) const;
+
+    // The whole buffer as one contiguous source: shared when it is a single
+    // piece (e.g. a mapped file), else a copy
+    BufferSource flatten() const;
+
+private:
+    struct Piece {
+        BufferSource src;       // payload, unused for fill pieces
+        qint64       length{};
+        char         fill{};
+        bool         isFill{};
+        bool         owned{};   // private edit page, may be written in place
+    };
+    struct Node;
+    using NodePtr = std::unique_ptr<Node>;
+
+    NodePtr makeNode(Piece piece);
+    static NodePtr clone(const Node *n);
+    static void update(Node *n);
+    static qint64 totalOf(const Node *n);
+    static NodePtr merge(NodePtr a, NodePtr b);
+    NodePtr split(NodePtr t, qint64 pos, NodePtr &rightOut);
+    void replaceRange(qint64 pos, qint64 length, NodePtr middle);
+    static bool visit(const Node *n, qint64 base, qint64 pos, qint64 end, const ChunkFn &fn);
+
+    NodePtr root_;
+    quint32 seed_{0x9E3779B9u};
+};
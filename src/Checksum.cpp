@@ -0,0 +1,126 @@
+#include "Checksum.h"
+
+#include "BufferEngine.h"
+
+#include <algorithm>
+#include <array>
+
+namespace {
+
+constexpr quint32 kPoly = 0xEDB88320u;   // reflected
+
+// table[0] is the usual byte table; table[k] advances a byte k more places
+using Tables = std::array<std::array<quint32, 256>, 8>;
+
+const Tables &crcTables() {
+    static const Tables tables = [] {
+        Tables t{};
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? kPoly ^ (c >> 1) : c >> 1;
+            t[0][i] = c;
+        }
+        for (int k = 1; k < 8; ++k)
+            for (int i = 0; i < 256; ++i)
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+        return t;
+    }();
+    return tables;
+}
+
+// a * b modulo the CRC polynomial, bit-reflected like the CRC itself
+quint32 multModP(quint32 a, quint32 b) {
+    quint32 m = 1u << 31;
+    quint32 p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ kPoly : b >> 1;
+    }
+    return p;
+}
+
+// x^(2^k) modulo the polynomial, k = 0..31
+const std::array<quint32, 32> &powerTable() {
+    static const std::array<quint32, 32> table = [] {
+        std::array<quint32, 32> t{};
+        quint32 p = 1u << 30;   // x^1
+        t[0] = p;
+        for (int k = 1; k < 32; ++k) t[k] = p = multModP(p, p);
+        return t;
+    }();
+    return table;
+}
+
+// x^(8 * bytes) modulo the polynomial
+quint32 shiftBytes(qint64 bytes) {
+    const auto &t = powerTable();
+    quint32 p = 1u << 31;       // x^0
+    for (int k = 3; bytes; bytes >>= 1, ++k)
+        if (bytes & 1) p = multModP(t[k & 31], p);
+    return p;
+}
+
+} // namespace
+
+quint32 Checksum::crc32(const uchar *p, qint64 n, quint32 crc) {
+    const Tables &t = crcTables();
+    crc = ~crc;
+    while (n >= 8) {
+        const quint32 lo = crc ^ (quint32(p[0]) | quint32(p[1]) << 8 | quint32(p[2]) << 16 | quint32(p[3]) << 24);
+        const quint32 hi = quint32(p[4]) | quint32(p[5]) << 8 | quint32(p[6]) << 16 | quint32(p[7]) << 24;
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+            ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        p += 8;
+        n -= 8;
+    }
+    while (n-- > 0) crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+quint32 Checksum::crc32(const BufferEngine &image, qint64 pos, qint64 length) {
+    quint32 crc = 0;
+    image.forEachChunk(pos, length, [&](const char *data, qint64 n) {
+        crc = crc32(reinterpret_cast<const uchar *>(data), n, crc);
+        return true;
+    });
+    return crc;
+}
+
+quint32 Checksum::crc32Combine(quint32 crcA, quint32 crcB, qint64 lengthB) {
+    return multModP(shiftBytes(lengthB), crcA) ^ crcB;
+}
+
+quint64 Checksum::byteSum(const uchar *data, qint64 length) {
+    // 32-bit partial sums can't overflow in 16 MiB and let the compiler
+    // vectorise the inner loop
+    quint64 total = 0;
+    while (length > 0) {
+        const qint64 n = std::min<qint64>(length, 1 << 24);
+        quint32 part = 0;
+        for (qint64 i = 0; i < n; ++i) part += data[i];
+        total += part;
+        data += n;
+        length -= n;
+    }
+    return total;
+}
+
+Checksum::Sums Checksum::sums(const BufferEngine &image, qint64 pos, qint64 length) {
+    Sums s;
+    image.forEachChunk(pos, length, [&](const char *data, qint64 n) {
+        const auto *p = reinterpret_cast<const uchar *>(data);
+        s.crc = crc32(p, n, s.crc);
+        s.sum += byteSum(p, n);
+        s.length += n;
+        return true;
+    });
+    return s;
+}
+
+Checksum::Sums Checksum::combine(const Sums &a, const Sums &b) {
+    return { crc32Combine(a.crc, b.crc, b.length), a.sum + b.sum, a.length + b.length };
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QtGlobal>
+
+class BufferEngine;
+
+// CRC-32 (IEEE 802.3) and byte sums.
+//
+// The CRC runs eight bytes per step through eight lookup tables (slicing by
+// 8), which is portable and several times faster than a byte at a time.
+// CRCs of adjacent ranges can be joined without rereading the data, so a
+// checksum over many pieces is the join of the pieces' checksums; a panel
+// that caches them per chunk only has to rescan the chunks an edit touched.
+class Checksum {
+public:
+    // Checksums of one range; the empty range is all zero
+    struct Sums {
+        quint32 crc{0};
+        quint64 sum{0};         // plain sum of the bytes; 16-bit sum is sum & 0xFFFF
+        qint64  length{0};
+    };
+
+    // Running CRC: pass the result of the previous call to continue
+    static quint32 crc32(const uchar *data, qint64 length, quint32 crc = 0);
+    // [pos, pos+length), streamed over the pieces
+    static quint32 crc32(const BufferEngine &image, qint64 pos, qint64 length);
+    // CRC of A followed by B, from the CRCs of A and B and B's length
+    static quint32 crc32Combine(quint32 crcA, quint32 crcB, qint64 lengthB);
+
+    static quint64 byteSum(const uchar *data, qint64 length);
+
+    static Sums sums(const BufferEngine &image, qint64 pos, qint64 length);
+    // Sums of a followed by b
+    static Sums combine(const Sums &a, const Sums &b);
+};
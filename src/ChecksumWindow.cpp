@@ -0,0 +1,355 @@
+#include "ChecksumWindow.h"
+
+#include "BufferDocument.h"
+#include "HexView.h"
+#include "SegmentIndex.h"
+
+#include <QAbstractItemModel>
+#include <QAction>
+#include <QApplication>
+#include <QClipboard>
+#include <QCryptographicHash>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLocale>
+#include <QStringList>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <thread>
+
+namespace {
+
+constexpr qint64 kChunk = 1 << 20;          // CRC/sum cache granularity
+constexpr qint64 kForever = std::numeric_limits<qint64>::max() / 4;
+constexpr int    kMaxSegmentRows = 500;
+
+enum Column { ColName, ColRange, ColSize, ColCrc, ColSum16, ColSum32, ColSha1, ColSha256, ColCount };
+
+// fn(i) for every i in [0, count), spread over the cores
+void parallelFor(int count, const std::function<void(int)> &fn) {
+    std::atomic<int> next{0};
+    const int threads = std::min(count, std::max(1, QThread::idealThreadCount()));
+    const auto run = [&]{
+        for (int i; (i = next.fetch_add(1)) < count;) fn(i);
+    };
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) workers.emplace_back(run);
+    run();
+    for (auto &w : workers) w.join();
+}
+
+// Both hashes in one pass; false if cancelled first
+bool hashRange(const BufferEngine &image, ChecksumWorker::RangeResult &r,
+               const std::function<bool()> &cancelled) {
+    QCryptographicHash sha1(QCryptographicHash::Sha1);
+    QCryptographicHash sha256(QCryptographicHash::Sha256);
+    const bool done = image.forEachChunk(r.pos, r.length, [&](const char *data, qint64 n) {
+        for (qint64 off = 0; off < n; off += kChunk) {
+            if (cancelled()) return false;
+            const QByteArray piece = QByteArray::fromRawData(data + off, std::min(kChunk, n - off));
+            sha1.addData(piece);
+            sha256.addData(piece);
+        }
+        return true;
+    });
+    if (!done) return false;
+    r.sha1 = sha1.result();
+    r.sha256 = sha256.result();
+    return true;
+}
+
+// Whole chunks come from the cache, the partial ones at the ends are read
+Checksum::Sums joinSums(const BufferEngine &image, const std::vector<Checksum::Sums> &chunks,
+                        qint64 pos, qint64 length) {
+    Checksum::Sums s;
+    const qint64 end = pos + length;
+    const qint64 size = image.size();
+    while (pos < end) {
+        const qint64 i = pos / kChunk;
+        const qint64 chunkEnd = std::min((i + 1) * kChunk, size);
+        const qint64 stop = std::min(end, chunkEnd);
+        if (pos == i * kChunk && stop == chunkEnd)
+            s = Checksum::combine(s, chunks[size_t(i)]);
+        else
+            s = Checksum::combine(s, Checksum::sums(image, pos, stop - pos));
+        pos = stop;
+    }
+    return s;
+}
+
+QString hexRange(qint64 pos, qint64 length) {
+    return QString("0x%1 - 0x%2").arg(QString::number(pos, 16).toUpper(),
+                                       QString::number(pos + length - 1, 16).toUpper());
+}
+
+} // namespace
+
+void ChecksumWorker::compute(const Job &job) {
+    Result result;
+    result.serial = job.serial;
+    result.chunks = job.chunks;
+    const std::function<bool()> cancelled = [this, serial = job.serial]{
+        return cancelled_.load() >= serial;
+    };
+
+    std::vector<int> stale;
+    for (size_t i = 0; i < result.chunks.size(); ++i)
+        if (result.chunks[i].length == 0) stale.push_back(int(i));
+
+    std::vector<RangeResult> ranges;
+    for (const auto &range : job.ranges) ranges.push_back({ range.first, range.second, {}, {}, {} });
+    std::vector<char> hashed(ranges.size(), 0);
+
+    // Hashes first, they are the long tasks; then the stale chunks
+    const int hashTasks = int(ranges.size());
+    const qint64 size = job.image.size();
+    parallelFor(hashTasks + int(stale.size()), [&](int task) {
+        if (cancelled()) return;
+        if (task < hashTasks) {
+            hashed[size_t(task)] = hashRange(job.image, ranges[size_t(task)], cancelled);
+            return;
+        }
+        const qint64 pos = qint64(stale[size_t(task - hashTasks)]) * kChunk;
+        result.chunks[size_t(pos / kChunk)] = Checksum::sums(job.image, pos, std::min(kChunk, size - pos));
+    });
+
+    if (cancelled()) {
+        result.cancelled = true;
+        emit computed(result);
+        return;
+    }
+    parallelFor(hashTasks, [&](int i) {
+        RangeResult &r = ranges[size_t(i)];
+        r.sums = joinSums(job.image, result.chunks, r.pos, r.length);
+    });
+    for (size_t i = 0; i < ranges.size(); ++i)
+        if (hashed[i]) result.ranges << ranges[i];
+    emit computed(result);
+}
+
+ChecksumWindow::ChecksumWindow(BufferDocument *buffer,
+                               const SegmentIndex *segments,
+                               QAbstractItemModel *segmentModel,
+                               HexView *hexView,
+                               QWidget *parent)
+    : QDialog(parent), buffer_(buffer), segments_(segments), hexView_(hexView)
+{
+    setWindowTitle(tr("Checksums"));
+    resize(900, 320);
+
+    auto *layout = new QVBoxLayout(this);
+    table_ = new QTableWidget(0, ColCount, this);
+    table_->setHorizontalHeaderLabels({ tr("Name"), tr("Range"), tr("Size"), tr("CRC-32"),
+                                        tr("Sum-16"), tr("Sum-32"), tr("SHA-1"), tr("SHA-256") });
+    table_->horizontalHeaderItem(ColSum16)->setToolTip(tr("Sum of the bytes, low 16 bits, as minipro reports it"));
+    table_->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    table_->horizontalHeader()->setStretchLastSection(true);
+    table_->verticalHeader()->setVisible(false);
+    table_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table_->setAlternatingRowColors(true);
+    table_->setContextMenuPolicy(Qt::ActionsContextMenu);
+    auto *actCopy = new QAction(tr("Copy"), table_);
+    actCopy->setShortcut(QKeySequence::Copy);
+    actCopy->setShortcutContext(Qt::WidgetShortcut);
+    connect(actCopy, &QAction::triggered, this, &ChecksumWindow::copySelection);
+    table_->addAction(actCopy);
+    layout->addWidget(table_);
+    status_ = new QLabel(this);
+    layout->addWidget(status_);
+
+    worker_ = new ChecksumWorker;
+    worker_->moveToThread(&workerThread_);
+    connect(&workerThread_, &QThread::finished, worker_, &QObject::deleteLater);
+    connect(worker_, &ChecksumWorker::computed, this, &ChecksumWindow::finished);
+    workerThread_.setObjectName("checksums");
+    workerThread_.start();
+
+    // Wait for typing in the hex view to pause
+    debounce_.setSingleShot(true);
+    debounce_.setInterval(250);
+    connect(&debounce_, &QTimer::timeout, this, &ChecksumWindow::start);
+
+    connect(buffer_, &BufferDocument::reset, this, [this]{ invalidateFrom(0); });
+    connect(buffer_, &BufferDocument::bytesChanged, this, &ChecksumWindow::invalidate);
+    connect(buffer_, &BufferDocument::bytesInserted, this, [this](qint64 pos, qint64) { invalidateFrom(pos); });
+    connect(buffer_, &BufferDocument::bytesRemoved, this, [this](qint64 pos, qint64) { invalidateFrom(pos); });
+    connect(buffer_, &BufferDocument::bytesMoved, this, [this](qint64 from, qint64 length, qint64 to) {
+        const qint64 first = std::min(from, to);
+        invalidate(first, std::max(from, to) + length - first);
+    });
+
+    // Rows follow the segment legend and the selection
+    connect(segmentModel, &QAbstractItemModel::modelReset, this, &ChecksumWindow::schedule);
+    connect(segmentModel, &QAbstractItemModel::layoutChanged, this, &ChecksumWindow::schedule);
+    connect(segmentModel, &QAbstractItemModel::rowsInserted, this, &ChecksumWindow::schedule);
+    connect(segmentModel, &QAbstractItemModel::rowsRemoved, this, &ChecksumWindow::schedule);
+    connect(segmentModel, &QAbstractItemModel::rowsMoved, this, &ChecksumWindow::schedule);
+    connect(segmentModel, &QAbstractItemModel::dataChanged, this, &ChecksumWindow::schedule);
+    if (hexView_) connect(hexView_, &HexView::cursorMoved, this, &ChecksumWindow::schedule);
+}
+
+ChecksumWindow::~ChecksumWindow() {
+    disconnect(worker_, nullptr, this, nullptr);
+    worker_->cancelUpTo(std::numeric_limits<quint64>::max());
+    workerThread_.quit();
+    workerThread_.wait();
+}
+
+void ChecksumWindow::showEvent(QShowEvent *event) {
+    QDialog::showEvent(event);
+    start();
+}
+
+void ChecksumWindow::invalidate(qint64 pos, qint64 length) {
+    if (length <= 0) return;
+    const qint64 end = pos + length;
+    const size_t last = size_t(std::min<qint64>((end - 1) / kChunk, qint64(chunks_.size()) - 1) + 1);
+    for (size_t i = size_t(pos / kChunk); i < last; ++i) chunks_[i] = Checksum::Sums{};
+    for (auto it = cache_.begin(); it != cache_.end();) {
+        if (it->pos < end && pos < it->pos + it->length) it = cache_.erase(it);
+        else ++it;
+    }
+    if (running_) {
+        changedWhileRunning_.add(pos, length);
+        worker_->cancelUpTo(serial_);
+    }
+    schedule();
+}
+
+void ChecksumWindow::invalidateFrom(qint64 pos) {
+    invalidate(pos, kForever);
+}
+
+void ChecksumWindow::schedule() {
+    if (isVisible()) debounce_.start();
+}
+
+void ChecksumWindow::start() {
+    if (running_) {
+        pending_ = true;
+        return;
+    }
+    const qint64 size = buffer_->size();
+    chunks_.resize(size_t((size + kChunk - 1) / kChunk));
+
+    // Only rows still shown keep their results
+    const QList<Row> current = rows();
+    QHash<QPair<qint64, qint64>, ChecksumWorker::RangeResult> kept;
+    ChecksumWorker::Job job;
+    for (const Row &row : current) {
+        const auto key = qMakePair(row.pos, row.length);
+        const auto it = cache_.constFind(key);
+        if (it != cache_.constEnd()) kept.insert(key, *it);
+        else if (!job.ranges.contains(key)) job.ranges << key;
+    }
+    cache_ = kept;
+    if (job.ranges.isEmpty()) {
+        updateTable();
+        return;
+    }
+
+    job.serial = ++serial_;
+    job.image = buffer_->engine();
+    job.chunks = chunks_;
+    running_ = true;
+    changedWhileRunning_.clear();
+    elapsed_.start();
+    QMetaObject::invokeMethod(worker_, [w = worker_, job]{ w->compute(job); }, Qt::QueuedConnection);
+    updateTable();
+}
+
+void ChecksumWindow::finished(const ChecksumWorker::Result &result) {
+    running_ = false;
+
+    // Keep what an edit during the run didn't touch
+    const size_t n = std::min(result.chunks.size(), chunks_.size());
+    for (size_t i = 0; i < n; ++i) {
+        if (chunks_[i].length == 0 && result.chunks[i].length != 0
+            && !changedWhileRunning_.anyInRange(qint64(i) * kChunk, kChunk))
+            chunks_[i] = result.chunks[i];
+    }
+    for (const auto &r : result.ranges) {
+        if (!changedWhileRunning_.anyInRange(r.pos, r.length))
+            cache_.insert(qMakePair(r.pos, r.length), r);
+    }
+    changedWhileRunning_.clear();
+
+    if (!result.cancelled)
+        status_->setText(tr("Computed in %1 ms").arg(QLocale().toString(elapsed_.elapsed())));
+    updateTable();
+    if (pending_ || result.cancelled) {
+        pending_ = false;
+        schedule();
+    }
+}
+
+QList<ChecksumWindow::Row> ChecksumWindow::rows() const {
+    QList<Row> out;
+    const qint64 size = buffer_->size();
+    if (size == 0) return out;
+    out << Row{ tr("Buffer"), 0, size };
+
+    if (hexView_ && hexView_->selectionLength() > 1) {
+        const qint64 pos = hexView_->selectionStart();
+        const qint64 length = std::min(hexView_->selectionLength(), size - pos);
+        if (length > 0) out << Row{ tr("Selection"), pos, length };
+    }
+
+    segments_->forEach([&](int row, const SegmentIndex::Segment &seg) {
+        if (row >= kMaxSegmentRows) return false;
+        const qint64 pos = qint64(seg.start);
+        const qint64 length = std::min(qint64(seg.length), size - pos);
+        if (length > 0)
+            out << Row{ seg.label.isEmpty() ? tr("Segment %1").arg(row + 1) : seg.label, pos, length };
+        return true;
+    });
+    return out;
+}
+
+void ChecksumWindow::updateTable() {
+    const QList<Row> current = rows();
+    table_->setRowCount(int(current.size()));
+    const auto set = [this](int row, int col, const QString &text) {
+        auto *item = table_->item(row, col);
+        if (!item) table_->setItem(row, col, item = new QTableWidgetItem);
+        item->setText(text);
+    };
+    const auto hex = [](quint64 v, int digits) {
+        return QString("%1").arg(v, digits, 16, QChar('0')).toUpper();
+    };
+    for (int i = 0; i < current.size(); ++i) {
+        const Row &row = current.at(i);
+        set(i, ColName, row.label);
+        set(i, ColRange, hexRange(row.pos, row.length));
+        set(i, ColSize, QLocale().toString(row.length));
+        const auto it = cache_.constFind(qMakePair(row.pos, row.length));
+        const bool known = it != cache_.constEnd();
+        const QString wait = QStringLiteral("…");
+        set(i, ColCrc,    known ? hex(it->sums.crc, 8) : wait);
+        set(i, ColSum16,  known ? hex(it->sums.sum & 0xFFFF, 4) : wait);
+        set(i, ColSum32,  known ? hex(it->sums.sum & 0xFFFFFFFF, 8) : wait);
+        set(i, ColSha1,   known ? QString::fromLatin1(it->sha1.toHex()) : wait);
+        set(i, ColSha256, known ? QString::fromLatin1(it->sha256.toHex()) : wait);
+    }
+    if (running_) status_->setText(tr("Computing…"));
+    else if (current.isEmpty()) status_->setText(tr("The buffer is empty"));
+}
+
+void ChecksumWindow::copySelection() {
+    const auto ranges = table_->selectedRanges();
+    if (ranges.isEmpty()) return;
+    QStringList lines;
+    for (const auto &range : ranges) {
+        for (int r = range.topRow(); r <= range.bottomRow(); ++r) {
+            QStringList cells;
+            for (int c = range.leftColumn(); c <= range.rightColumn(); ++c)
+                cells << (table_->item(r, c) ? table_->item(r, c)->text() : QString());
+            lines << cells.join('\t');
+        }
+    }
+    QApplication::clipboard()->setText(lines.join('\n'));
+}
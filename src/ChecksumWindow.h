@@ -0,0 +1,124 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDialog>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QThread>
+#include <QTimer>
+
+#include <atomic>
+#include <vector>
+
+#include "BufferEngine.h"
+#include "Checksum.h"
+#include "DirtyRanges.h"
+
+class BufferDocument;
+class HexView;
+class QAbstractItemModel;
+class QLabel;
+class QTableWidget;
+class SegmentIndex;
+
+// Computes checksums of a buffer snapshot off the UI thread
+class ChecksumWorker : public QObject {
+    Q_OBJECT
+public:
+    struct RangeResult {
+        qint64        pos{0};
+        qint64        length{0};
+        Checksum::Sums sums;
+        QByteArray    sha1;
+        QByteArray    sha256;
+    };
+
+    struct Job {
+        quint64      serial{0};
+        BufferEngine image;
+        // Per 1 MiB of the image; length 0 means still to be computed
+        std::vector<Checksum::Sums> chunks;
+        QList<QPair<qint64, qint64>> ranges;   // (pos, length) to report
+    };
+
+    struct Result {
+        quint64 serial{0};
+        std::vector<Checksum::Sums> chunks;
+        QList<RangeResult> ranges;             // the completed ones
+        bool cancelled{false};
+    };
+
+    // Runs on the worker's thread
+    void compute(const Job &job);
+    // Thread-safe: jobs up to serial stop at their next megabyte
+    void cancelUpTo(quint64 serial) { cancelled_.store(serial); }
+
+signals:
+    void computed(const ChecksumWorker::Result &result);
+
+private:
+    std::atomic<quint64> cancelled_{0};
+};
+
+// Checksums of the whole buffer, each segment and the hex selection:
+// CRC-32, 16- and 32-bit byte sums, SHA-1 and SHA-256.
+//
+// CRCs and sums are kept per 1 MiB chunk and a row's values are joined from
+// its chunks, so after an edit only the chunks it touched are read again.
+// SHA hashes can't be joined; they are kept per row and recomputed for rows
+// an edit reached. Work runs on a worker thread, spread over all cores,
+// shortly after the last change and only while the window is shown.
+class ChecksumWindow : public QDialog {
+    Q_OBJECT
+public:
+    ChecksumWindow(BufferDocument *buffer,
+                   const SegmentIndex *segments,
+                   QAbstractItemModel *segmentModel,
+                   HexView *hexView,
+                   QWidget *parent = nullptr);
+    ~ChecksumWindow() override;
+
+protected:
+    void showEvent(QShowEvent *event) override;
+
+private:
+    struct Row {
+        QString label;
+        qint64  pos{0};
+        qint64  length{0};
+    };
+
+    // Buffer edits; [pos, pos+length) changed, or everything from pos on
+    // when bytes moved
+    void invalidate(qint64 pos, qint64 length);
+    void invalidateFrom(qint64 pos);
+
+    void schedule();
+    void start();
+    void finished(const ChecksumWorker::Result &result);
+
+    QList<Row> rows() const;
+    void updateTable();
+    void copySelection();
+
+    BufferDocument     *buffer_{};
+    const SegmentIndex *segments_{};
+    HexView            *hexView_{};
+
+    QThread         workerThread_;
+    ChecksumWorker *worker_{};
+    QTimer          debounce_;
+    quint64         serial_{0};
+    bool            running_{false};
+    bool            pending_{false};      // something changed while running
+
+    std::vector<Checksum::Sums> chunks_;  // length 0 = stale
+    QHash<QPair<qint64, qint64>, ChecksumWorker::RangeResult> cache_;
+    DirtyRanges     changedWhileRunning_;
+    QElapsedTimer   elapsed_;
+
+    QTableWidget *table_{};
+    QLabel       *status_{};
+};
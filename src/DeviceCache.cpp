@@ -0,0 +1,185 @@
+#include "DeviceCache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLockFile>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+
+namespace {
+
+constexpr int kFormat = 1;
+
+const QString kFormatKey      = QStringLiteral("format");
+const QString kMiniproKey     = QStringLiteral("minipro");
+const QString kNamesKey       = QStringLiteral("names");
+const QString kProgrammersKey = QStringLiteral("programmers");
+const QString kDevicesKey     = QStringLiteral("devices");
+const QString kChipsKey       = QStringLiteral("chips");
+const QString kInfoKey        = QStringLiteral("info");
+
+// Entry shape: { "minipro": key, <payload> }
+QJsonObject entry(const QString &key, const QString &field, const QJsonValue &payload) {
+    return QJsonObject{ { kMiniproKey, key }, { field, payload } };
+}
+
+// Cache contents on disk; anything unreadable or from another format is
+// simply started over
+QJsonObject readFile(const QString &path) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) return {};
+    const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+    if (doc.isObject() && doc.object().value(kFormatKey).toInt() == kFormat)
+        return doc.object();
+    return {};
+}
+
+QJsonValue valueAt(const QJsonObject &root, const QStringList &path) {
+    QJsonValue v = root;
+    for (const QString &key : path) v = v.toObject().value(key);
+    return v;
+}
+
+// Undefined removes the entry
+void setAt(QJsonObject &root, const QStringList &path, qsizetype depth, const QJsonValue &v) {
+    const QString &key = path.at(depth);
+    if (depth == path.size() - 1) {
+        if (v.isUndefined()) root.remove(key);
+        else root.insert(key, v);
+        return;
+    }
+    QJsonObject child = root.value(key).toObject();
+    setAt(child, path, depth + 1, v);
+    root.insert(key, child);
+}
+
+} // namespace
+
+QString DeviceCache::defaultPath() {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+           + QStringLiteral("/devicecache.json");
+}
+
+void DeviceCache::load(const QString &path) {
+    path_ = path;
+    root_ = readFile(path);
+    touched_.clear();
+}
+
+bool DeviceCache::save() {
+    if (touched_.isEmpty() || path_.isEmpty()) return true;
+
+    QDir().mkpath(QFileInfo(path_).absolutePath());
+    // Other instances write the same file; read, merge and write under a lock
+    QLockFile lock(path_ + QStringLiteral(".lock"));
+    if (!lock.lock()) return false;
+
+    QJsonObject merged = readFile(path_);
+    for (const QStringList &p : std::as_const(touched_))
+        setAt(merged, p, 0, valueAt(root_, p));
+    merged.insert(kFormatKey, kFormat);
+
+    QSaveFile out(path_);
+    if (!out.open(QIODevice::WriteOnly)) return false;
+    out.write(QJsonDocument(merged).toJson(QJsonDocument::Compact));
+    if (!out.commit()) return false;
+    // Pick up what the others stored meanwhile
+    root_ = merged;
+    touched_.clear();
+    return true;
+}
+
+void DeviceCache::touch(const QStringList &path) {
+    if (!touched_.contains(path)) touched_.append(path);
+}
+
+bool DeviceCache::programmers(QStringList *out, bool *fresh) const {
+    const QJsonObject e = root_.value(kProgrammersKey).toObject();
+    if (e.isEmpty()) return false;
+    if (out) *out = e.value(kNamesKey).toVariant().toStringList();
+    if (fresh) *fresh = e.value(kMiniproKey).toString() == key_;
+    return true;
+}
+
+bool DeviceCache::setProgrammers(const QStringList &names) {
+    QStringList old;
+    bool fresh = false;
+    const bool had = programmers(&old, &fresh);
+    const bool changed = !had || old != names;
+    if (changed || !fresh) {
+        root_.insert(kProgrammersKey, entry(key_, kNamesKey, QJsonArray::fromStringList(names)));
+        touch({ kProgrammersKey });
+    }
+    return changed;
+}
+
+bool DeviceCache::deviceList(const QString &programmer, QStringList *out, bool *fresh) const {
+    const QJsonObject e = root_.value(kDevicesKey).toObject().value(programmer).toObject();
+    if (e.isEmpty()) return false;
+    if (out) *out = e.value(kNamesKey).toVariant().toStringList();
+    if (fresh) *fresh = e.value(kMiniproKey).toString() == key_;
+    return true;
+}
+
+bool DeviceCache::setDeviceList(const QString &programmer, const QStringList &names) {
+    QStringList old;
+    bool fresh = false;
+    const bool had = deviceList(programmer, &old, &fresh);
+    const bool changed = !had || old != names;
+    if (!changed && fresh) return false;
+
+    QJsonObject devices = root_.value(kDevicesKey).toObject();
+    devices.insert(programmer, entry(key_, kNamesKey, QJsonArray::fromStringList(names)));
+    root_.insert(kDevicesKey, devices);
+    touch({ kDevicesKey, programmer });
+
+    // Chip info of devices that went away is of no use any more
+    if (changed) {
+        QJsonObject chips = root_.value(kChipsKey).toObject();
+        QJsonObject forProgrammer = chips.value(programmer).toObject();
+        const QSet<QString> listed(names.cbegin(), names.cend());
+        for (auto it = forProgrammer.begin(); it != forProgrammer.end();) {
+            if (listed.contains(it.key())) {
+                ++it;
+            } else {
+                touch({ kChipsKey, programmer, it.key() });
+                it = forProgrammer.erase(it);
+            }
+        }
+        chips.insert(programmer, forProgrammer);
+        root_.insert(kChipsKey, chips);
+    }
+    return changed;
+}
+
+bool DeviceCache::chipInfo(const QString &programmer, const QString &device,
+                           QJsonObject *out, bool *fresh) const {
+    const QJsonObject e = root_.value(kChipsKey).toObject()
+                              .value(programmer).toObject()
+                              .value(device).toObject();
+    if (e.isEmpty()) return false;
+    if (out) *out = e.value(kInfoKey).toObject();
+    if (fresh) *fresh = e.value(kMiniproKey).toString() == key_;
+    return true;
+}
+
+bool DeviceCache::setChipInfo(const QString &programmer, const QString &device,
+                              const QJsonObject &info) {
+    QJsonObject old;
+    bool fresh = false;
+    const bool had = chipInfo(programmer, device, &old, &fresh);
+    const bool changed = !had || old != info;
+    if (!changed && fresh) return false;
+
+    QJsonObject chips = root_.value(kChipsKey).toObject();
+    QJsonObject forProgrammer = chips.value(programmer).toObject();
+    forProgrammer.insert(device, entry(key_, kInfoKey, info));
+    chips.insert(programmer, forProgrammer);
+    root_.insert(kChipsKey, chips);
+    touch({ kChipsKey, programmer, device });
+    return changed;
+}
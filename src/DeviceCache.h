@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// Results of earlier minipro runs, kept on disk between sessions.
+//
+// Holds the programmer scan, the device list per programmer and chip info
+// per programmer/device. Every entry remembers which minipro it came from
+// (see setMiniproKey()); entries from another minipro are still returned,
+// flagged as not fresh, so the UI can show them at once and refresh in the
+// background. Storing a result reports whether it differed from the cached
+// one, so unchanged refreshes can be dropped silently.
+//
+// Several instances may share the file (main window, gang lanes, batch
+// runs). Saving merges: only the entries this instance changed are written
+// over what is on disk, so one instance never drops another's results.
+class DeviceCache {
+public:
+    static QString defaultPath();
+
+    void load(const QString &path = defaultPath());
+    // Write if anything changed since load/save, merged into the file's
+    // current contents
+    bool save();
+
+    // Identity of the minipro binary in use
+    void setMiniproKey(const QString &key) { key_ = key; }
+    QString miniproKey() const { return key_; }
+
+    bool programmers(QStringList *out, bool *fresh = nullptr) const;
+    bool setProgrammers(const QStringList &names);
+
+    bool deviceList(const QString &programmer, QStringList *out, bool *fresh = nullptr) const;
+    // Chip entries of devices that are no longer listed are dropped
+    bool setDeviceList(const QString &programmer, const QStringList &names);
+
+    // Chip info is stored as the JSON ProcessHandling gives it
+    bool chipInfo(const QString &programmer, const QString &device,
+                  QJsonObject *out, bool *fresh = nullptr) const;
+    bool setChipInfo(const QString &programmer, const QString &device, const QJsonObject &info);
+
+private:
+    void touch(const QStringList &path);
+
+    QString     path_;
+    QString     key_;
+    QJsonObject root_;
+    // Entries changed since load/save, as key paths into root_
+    QList<QStringList> touched_;
+};
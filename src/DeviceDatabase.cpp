@@ -0,0 +1,523 @@
+#include "DeviceDatabase.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QXmlStreamReader>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr char    kMagic[4] = { 'F', 'M', 'D', 'B' };
+constexpr quint32 kFormatVersion = 1;
+constexpr int     kFamilies = 2;   // 0: TL866A/CS (INFOIC), 1: TL866II+/T48/T56 (INFOIC2PLUS)
+
+// minipro flag bits we need (see minipro's database.c)
+constexpr quint32 kDataOrgMask = 0x03000000;
+constexpr quint32 kPic18F = 0x82;
+constexpr quint32 kPic18J = 0x85;
+
+// On-disk layout: Header, Record[recordCount], then per family a display
+// list and a lookup table of quint32 record indices, then the string pool.
+// Everything is native endian and 4-byte aligned; the file is a local cache.
+struct Header {
+    char    magic[4];
+    quint32 version;
+    quint64 key;
+    quint32 recordCount;
+    quint32 recordsOffset;
+    quint32 stringsOffset;
+    quint32 stringsSize;
+    quint32 listOffset[kFamilies];   // sorted, deduplicated display order
+    quint32 listCount[kFamilies];
+    quint32 lookupOffset[kFamilies]; // sorted by case-folded name, one winner per name
+    quint32 lookupCount[kFamilies];
+};
+static_assert(sizeof(Header) == 64, "cache header layout");
+
+enum RecordFlag : quint8 {
+    RecLogic  = 0x01,
+    RecCustom = 0x02,
+};
+
+struct Record {
+    quint32 name;        // offset into the string pool
+    quint32 bytes;
+    quint32 readBuf;
+    quint32 writeBuf;
+    quint16 nameLength;
+    quint16 vectors;
+    quint8  protocol;
+    quint8  wordBits;
+    quint8  flags;
+    quint8  reserved;
+};
+static_assert(sizeof(Record) == 24, "cache record layout");
+
+inline char foldAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+// Case-insensitive (ASCII) ordering of two names
+int compareFolded(const char *a, qsizetype na, const char *b, qsizetype nb) {
+    const qsizetype n = std::min(na, nb);
+    for (qsizetype i = 0; i < n; ++i) {
+        const char ca = foldAscii(a[i]);
+        const char cb = foldAscii(b[i]);
+        if (ca != cb) return uchar(ca) < uchar(cb) ? -1 : 1;
+    }
+    return na == nb ? 0 : (na < nb ? -1 : 1);
+}
+
+quint64 fnv1a(quint64 h, const void *data, size_t length) {
+    const uchar *p = static_cast<const uchar *>(data);
+    for (size_t i = 0; i < length; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+// Identity of the XML the cache was built from
+quint64 sourceKey(const QStringList &paths) {
+    quint64 h = 0xcbf29ce484222325ull;
+    h = fnv1a(h, &kFormatVersion, sizeof(kFormatVersion));
+    for (const QString &p : paths) {
+        const QFileInfo fi(p);
+        const QByteArray path = fi.absoluteFilePath().toUtf8();
+        const qint64 size = fi.size();
+        const qint64 mtime = fi.lastModified().toMSecsSinceEpoch();
+        h = fnv1a(h, path.constData(), size_t(path.size()));
+        h = fnv1a(h, &size, sizeof(size));
+        h = fnv1a(h, &mtime, sizeof(mtime));
+    }
+    return h;
+}
+
+// One name of an <ic>, before it gets a record index
+struct Entry {
+    QByteArray name;
+    Record     rec{};
+    int        source{};  // -1 logic, else family
+};
+
+quint32 attrNumber(const QXmlStreamAttributes &attrs, QLatin1String name) {
+    bool ok = false;
+    const quint32 v = attrs.value(name).toUInt(&ok, 0);
+    return ok ? v : 0;
+}
+
+void addNames(std::vector<Entry> &out, const QXmlStreamAttributes &attrs,
+              const Record &rec, int source) {
+    const QByteArray list = attrs.value(QLatin1String("name")).toUtf8();
+    for (const QByteArray &n : list.split(',')) {
+        const QByteArray name = n.trimmed();
+        if (name.isEmpty()) continue;
+        out.push_back({ name, rec, source });
+    }
+}
+
+bool parseLogic(const QString &path, std::vector<Entry> &out, QString *error) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (error) *error = QString("cannot open %1").arg(path);
+        return false;
+    }
+    QXmlStreamReader xml(&f);
+    bool custom = false;
+    QXmlStreamAttributes icAttrs;
+    Record rec{};
+    bool inIc = false;
+    while (!xml.atEnd()) {
+        const auto token = xml.readNext();
+        if (token == QXmlStreamReader::StartElement) {
+            const auto name = xml.name();
+            if (name == QLatin1String("manufacturer")) {
+                custom = false;
+            } else if (name == QLatin1String("custom")) {
+                custom = true;
+            } else if (name == QLatin1String("ic")) {
+                icAttrs = xml.attributes();
+                rec = Record{};
+                rec.flags = RecLogic | (custom ? RecCustom : 0);
+                inIc = true;
+            } else if (inIc && name == QLatin1String("vector")) {
+                ++rec.vectors;
+            }
+        } else if (token == QXmlStreamReader::EndElement && inIc
+                   && xml.name() == QLatin1String("ic")) {
+            addNames(out, icAttrs, rec, -1);
+            inIc = false;
+        }
+    }
+    if (xml.hasError()) {
+        if (error) *error = QString("%1: %2").arg(path, xml.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool parseInfoic(const QString &path, std::vector<Entry> &out, QString *error) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (error) *error = QString("cannot open %1").arg(path);
+        return false;
+    }
+    QXmlStreamReader xml(&f);
+    int family = -1;
+    bool custom = false;
+    while (!xml.atEnd()) {
+        if (xml.readNext() != QXmlStreamReader::StartElement) continue;
+        const auto name = xml.name();
+        if (name == QLatin1String("database")) {
+            const auto type = xml.attributes().value(QLatin1String("type"));
+            family = type == QLatin1String("INFOIC")      ? 0
+                   : type == QLatin1String("INFOIC2PLUS") ? 1 : -1;
+        } else if (name == QLatin1String("manufacturer")) {
+            custom = false;
+        } else if (name == QLatin1String("custom")) {
+            custom = true;
+        } else if (name == QLatin1String("ic") && family >= 0) {
+            const QXmlStreamAttributes attrs = xml.attributes();
+            const quint32 flags = attrNumber(attrs, QLatin1String("flags"));
+            const quint32 chipInfo = attrNumber(attrs, QLatin1String("chip_info"));
+            const quint32 code = attrNumber(attrs, QLatin1String("code_memory_size"));
+
+            // Memory shape the way minipro -d prints it
+            quint32 dataOrg = (flags & kDataOrgMask) >> 24;
+            quint32 wordSize = dataOrg == 1 ? 2 : 1;
+            if (chipInfo == kPic18F || chipInfo == kPic18J) {
+                wordSize = 2;
+                dataOrg = 0;
+            }
+            const quint32 count = code / wordSize;
+
+            Record rec{};
+            if (dataOrg == 0) {
+                rec.bytes = count;
+                rec.wordBits = 8;
+            } else if (dataOrg == 1) {
+                rec.bytes = count * 2;
+                rec.wordBits = 16;
+            }
+            rec.protocol = quint8(attrNumber(attrs, QLatin1String("protocol_id")));
+            rec.readBuf  = attrNumber(attrs, QLatin1String("read_buffer_size"));
+            rec.writeBuf = attrNumber(attrs, QLatin1String("write_buffer_size"));
+            rec.flags = custom ? RecCustom : 0;
+            addNames(out, attrs, rec, family);
+        }
+    }
+    if (xml.hasError()) {
+        if (error) *error = QString("%1: %2").arg(path, xml.errorString());
+        return false;
+    }
+    return true;
+}
+
+template <typename T>
+void appendRaw(QByteArray &blob, const T *data, size_t count) {
+    blob.append(reinterpret_cast<const char *>(data), qsizetype(sizeof(T) * count));
+}
+
+// Parse both XML files into the cache image
+bool buildIndex(const QString &infoicPath, const QString &logicPath, quint64 key,
+                QByteArray *blob, QString *error) {
+    std::vector<Entry> entries;
+    entries.reserve(64 * 1024);
+    if (!parseLogic(logicPath, entries, error)) return false;
+    if (!parseInfoic(infoicPath, entries, error)) return false;
+    if (entries.empty()) {
+        if (error) *error = QStringLiteral("no devices in database");
+        return false;
+    }
+
+    // Intern names into the pool; most appear in both databases
+    QByteArray strings;
+    QHash<QByteArray, quint32> interned;
+    interned.reserve(int(entries.size()));
+    std::vector<Record> records;
+    records.reserve(entries.size());
+    for (Entry &e : entries) {
+        auto it = interned.constFind(e.name);
+        if (it == interned.constEnd()) {
+            it = interned.insert(e.name, quint32(strings.size()));
+            strings.append(e.name);
+        }
+        e.rec.name = it.value();
+        e.rec.nameLength = quint16(e.name.size());
+        records.push_back(e.rec);
+    }
+    const char *pool = strings.constData();
+    auto nameLess = [&](quint32 a, quint32 b) {
+        const Record &ra = records[a];
+        const Record &rb = records[b];
+        return compareFolded(pool + ra.name, ra.nameLength, pool + rb.name, rb.nameLength) < 0;
+    };
+
+    std::vector<quint32> lists[kFamilies];
+    std::vector<quint32> lookups[kFamilies];
+    for (int f = 0; f < kFamilies; ++f) {
+        // Logic chips are listed for every programmer, as minipro -l does
+        QSet<QByteArray> seen;
+        QHash<QByteArray, quint32> winner;
+        for (quint32 i = 0; i < quint32(entries.size()); ++i) {
+            const Entry &e = entries[i];
+            if (e.source != -1 && e.source != f) continue;
+
+            QByteArray display = e.name;
+            if (e.rec.flags & RecCustom) display += "(custom)";
+            if (!seen.contains(display)) {
+                seen.insert(display);
+                lists[f].push_back(i);
+            }
+
+            // minipro -p/-d: logic wins, else the first regular entry,
+            // unless a custom one comes later
+            const QByteArray folded = e.name.toLower();
+            auto w = winner.find(folded);
+            if (w == winner.end())
+                winner.insert(folded, i);
+            else if ((e.rec.flags & RecCustom) && !(records[w.value()].flags & RecLogic))
+                w.value() = i;
+        }
+        std::stable_sort(lists[f].begin(), lists[f].end(), nameLess);
+        for (auto it = winner.cbegin(); it != winner.cend(); ++it)
+            lookups[f].push_back(it.value());
+        std::sort(lookups[f].begin(), lookups[f].end(), nameLess);
+    }
+
+    Header h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kFormatVersion;
+    h.key = key;
+    h.recordCount = quint32(records.size());
+
+    blob->clear();
+    blob->resize(sizeof(Header));
+    h.recordsOffset = quint32(blob->size());
+    appendRaw(*blob, records.data(), records.size());
+    for (int f = 0; f < kFamilies; ++f) {
+        h.listOffset[f] = quint32(blob->size());
+        h.listCount[f] = quint32(lists[f].size());
+        appendRaw(*blob, lists[f].data(), lists[f].size());
+        h.lookupOffset[f] = quint32(blob->size());
+        h.lookupCount[f] = quint32(lookups[f].size());
+        appendRaw(*blob, lookups[f].data(), lookups[f].size());
+    }
+    h.stringsOffset = quint32(blob->size());
+    h.stringsSize = quint32(strings.size());
+    blob->append(strings);
+    std::memcpy(blob->data(), &h, sizeof(h));
+    return true;
+}
+
+int familyOf(const QString &programmer) {
+    const QString p = programmer.trimmed().toLower();
+    if (p.startsWith(QLatin1String("tl866a")) || p.startsWith(QLatin1String("tl866cs"))) return 0;
+    if (p.startsWith(QLatin1String("tl866ii")) || p.startsWith(QLatin1String("t48"))
+        || p.startsWith(QLatin1String("t56")))
+        return 1;
+    return -1;
+}
+
+QString cachePath() {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+           + QStringLiteral("/devicedb.bin");
+}
+
+} // namespace
+
+DeviceDatabase::~DeviceDatabase() {
+    close();
+}
+
+QString DeviceDatabase::locateDataDir(const QString &miniproBin) {
+    QStringList dirs;
+    const QString home = qEnvironmentVariable("MINIPRO_HOME");
+    if (!home.isEmpty()) dirs << home;
+#ifdef Q_OS_WIN
+    const QString appData = qEnvironmentVariable("APPDATA");
+    if (!appData.isEmpty()) dirs << appData + "/minipro";
+#endif
+    if (!miniproBin.isEmpty()) {
+        const QString binDir = QFileInfo(miniproBin).absolutePath();
+        dirs << binDir + "/../share/minipro";
+    }
+    dirs << QStringLiteral("/usr/local/share/minipro")
+         << QStringLiteral("/opt/homebrew/share/minipro")
+         << QStringLiteral("/usr/share/minipro");
+
+    for (const QString &d : std::as_const(dirs)) {
+        if (QFileInfo::exists(d + "/infoic.xml") && QFileInfo::exists(d + "/logicic.xml"))
+            return QDir(d).canonicalPath();
+    }
+    return {};
+}
+
+bool DeviceDatabase::knowsProgrammer(const QString &programmer) {
+    return familyOf(programmer) >= 0;
+}
+
+void DeviceDatabase::close() {
+    if (map_ && file_.isOpen()) file_.unmap(map_);
+    file_.close();
+    map_ = nullptr;
+    mapSize_ = 0;
+    dataDir_.clear();
+}
+
+const uchar *DeviceDatabase::section(quint32 offset, quint64 length) const {
+    if (quint64(offset) + length > quint64(mapSize_)) return nullptr;
+    return map_ + offset;
+}
+
+bool DeviceDatabase::mapCache(const QString &path, quint64 key) {
+    file_.setFileName(path);
+    if (!file_.open(QIODevice::ReadOnly)) return false;
+    const qint64 size = file_.size();
+    if (size < qint64(sizeof(Header))) {
+        file_.close();
+        return false;
+    }
+    uchar *map = file_.map(0, size);
+    if (!map) {
+        file_.close();
+        return false;
+    }
+    map_ = map;
+    mapSize_ = size;
+
+    // Reject anything stale, foreign or truncated
+    Header h;
+    std::memcpy(&h, map_, sizeof(h));
+    bool ok = std::memcmp(h.magic, kMagic, sizeof(kMagic)) == 0
+              && h.version == kFormatVersion && h.key == key
+              && section(h.recordsOffset, quint64(h.recordCount) * sizeof(Record))
+              && section(h.stringsOffset, h.stringsSize);
+    for (int f = 0; ok && f < kFamilies; ++f) {
+        ok = section(h.listOffset[f], quint64(h.listCount[f]) * sizeof(quint32))
+             && section(h.lookupOffset[f], quint64(h.lookupCount[f]) * sizeof(quint32));
+    }
+
+    // Check every reference once here, so lookups can trust them
+    if (ok) {
+        const auto *records = reinterpret_cast<const Record *>(map_ + h.recordsOffset);
+        for (quint32 i = 0; ok && i < h.recordCount; ++i)
+            ok = quint64(records[i].name) + records[i].nameLength <= h.stringsSize;
+        for (int f = 0; ok && f < kFamilies; ++f) {
+            const auto *list = reinterpret_cast<const quint32 *>(map_ + h.listOffset[f]);
+            const auto *lookup = reinterpret_cast<const quint32 *>(map_ + h.lookupOffset[f]);
+            ok = std::all_of(list, list + h.listCount[f], [&](quint32 i) { return i < h.recordCount; })
+                 && std::all_of(lookup, lookup + h.lookupCount[f], [&](quint32 i) { return i < h.recordCount; });
+        }
+    }
+    if (!ok) {
+        file_.unmap(map_);
+        file_.close();
+        map_ = nullptr;
+        mapSize_ = 0;
+    }
+    return ok;
+}
+
+bool DeviceDatabase::open(const QString &dataDir, QString *error) {
+    close();
+    rebuilt_ = false;
+    const QString infoicPath = dataDir + "/infoic.xml";
+    const QString logicPath = dataDir + "/logicic.xml";
+    if (!QFileInfo::exists(infoicPath) || !QFileInfo::exists(logicPath)) {
+        if (error) *error = QString("no infoic.xml/logicic.xml in %1").arg(dataDir);
+        return false;
+    }
+
+    const quint64 key = sourceKey({ infoicPath, logicPath });
+    const QString path = cachePath();
+    if (!mapCache(path, key)) {
+        QByteArray blob;
+        if (!buildIndex(infoicPath, logicPath, key, &blob, error)) return false;
+
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QSaveFile out(path);
+        if (!out.open(QIODevice::WriteOnly) || out.write(blob) != blob.size() || !out.commit()) {
+            if (error) *error = QString("cannot write %1").arg(path);
+            return false;
+        }
+        if (!mapCache(path, key)) {
+            if (error) *error = QString("cannot map %1").arg(path);
+            return false;
+        }
+        rebuilt_ = true;
+    }
+    dataDir_ = dataDir;
+    return true;
+}
+
+int DeviceDatabase::deviceCount() const {
+    if (!map_) return 0;
+    Header h;
+    std::memcpy(&h, map_, sizeof(h));
+    return int(h.recordCount);
+}
+
+QStringList DeviceDatabase::deviceNames(const QString &programmer) const {
+    const int f = familyOf(programmer);
+    if (!map_ || f < 0) return {};
+    Header h;
+    std::memcpy(&h, map_, sizeof(h));
+    const auto *records = reinterpret_cast<const Record *>(map_ + h.recordsOffset);
+    const auto *list = reinterpret_cast<const quint32 *>(map_ + h.listOffset[f]);
+    const char *pool = reinterpret_cast<const char *>(map_ + h.stringsOffset);
+
+    QStringList out;
+    out.reserve(int(h.listCount[f]));
+    for (quint32 i = 0; i < h.listCount[f]; ++i) {
+        const Record &r = records[list[i]];
+        QString name = QString::fromUtf8(pool + r.name, r.nameLength);
+        if (r.flags & RecCustom) name += QStringLiteral("(custom)");
+        out << name;
+    }
+    return out;
+}
+
+bool DeviceDatabase::find(const QString &programmer, const QString &name, Device *out) const {
+    const int f = familyOf(programmer);
+    if (!map_ || f < 0 || name.isEmpty()) return false;
+    Header h;
+    std::memcpy(&h, map_, sizeof(h));
+    const auto *records = reinterpret_cast<const Record *>(map_ + h.recordsOffset);
+    const auto *lookup = reinterpret_cast<const quint32 *>(map_ + h.lookupOffset[f]);
+    const char *pool = reinterpret_cast<const char *>(map_ + h.stringsOffset);
+
+    const QByteArray key = name.trimmed().toUtf8();
+    const quint32 *end = lookup + h.lookupCount[f];
+    const quint32 *it = std::lower_bound(lookup, end, key, [&](quint32 idx, const QByteArray &k) {
+        const Record &r = records[idx];
+        return compareFolded(pool + r.name, r.nameLength, k.constData(), k.size()) < 0;
+    });
+    if (it == end) return false;
+    const Record &r = records[*it];
+    if (compareFolded(pool + r.name, r.nameLength, key.constData(), key.size()) != 0) return false;
+
+    if (out) {
+        Device d;
+        d.name = QString::fromUtf8(pool + r.name, r.nameLength);
+        d.isLogic = r.flags & RecLogic;
+        d.vectorCount = r.vectors;
+        if (!d.isLogic) {
+            d.bytes = r.bytes;
+            d.wordBits = r.wordBits;
+            d.protocol = r.protocol;
+            d.readBuf = int(r.readBuf);
+            d.writeBuf = int(r.writeBuf);
+        }
+        *out = d;
+    }
+    return true;
+}
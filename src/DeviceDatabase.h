@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+// Device list and chip info straight from minipro's own XML database.
+//
+// infoic.xml and logicic.xml are parsed once into a compact binary index
+// (interned names, fixed-size records, per-programmer sorted lists) that is
+// written to the cache directory and memory-mapped. The index is keyed by
+// the XML files' paths, sizes and modification times, so it is rebuilt
+// when minipro is upgraded. After that, listing devices and looking up a
+// chip never touch the XML or spawn minipro.
+class DeviceDatabase {
+public:
+    // What minipro -d would tell about a device
+    struct Device {
+        QString name;          // as spelled in the database
+        quint64 bytes{};       // code memory, 0 if not byte/word organized
+        int     wordBits{};    // 8 or 16, 0 if unknown
+        int     protocol{-1};  // protocol_id, -1 for logic chips
+        int     readBuf{};
+        int     writeBuf{};
+        bool    isLogic{};
+        int     vectorCount{};
+    };
+
+    DeviceDatabase() = default;
+    ~DeviceDatabase();
+    DeviceDatabase(const DeviceDatabase &) = delete;
+    DeviceDatabase &operator=(const DeviceDatabase &) = delete;
+
+    // Directory minipro reads its XML from: MINIPRO_HOME, then the usual
+    // install locations (relative to miniproBin first). Empty if not found.
+    static QString locateDataDir(const QString &miniproBin);
+
+    // Map the cached index for the XML in dataDir, building it first if it
+    // is missing or stale. On failure the database stays closed and
+    // *error says why.
+    bool open(const QString &dataDir, QString *error = nullptr);
+    void close();
+    bool isOpen() const { return map_ != nullptr; }
+    // True if open() had to parse the XML
+    bool wasRebuilt() const { return rebuilt_; }
+    QString dataDir() const { return dataDir_; }
+    int deviceCount() const;
+
+    // Whether the programmer name maps to one of the databases
+    static bool knowsProgrammer(const QString &programmer);
+
+    // Devices for this programmer as minipro -l lists them, deduplicated
+    // and sorted case-insensitively. Empty if unknown.
+    QStringList deviceNames(const QString &programmer) const;
+    // Exact, case-insensitive name lookup with minipro's precedence
+    bool find(const QString &programmer, const QString &name, Device *out) const;
+
+private:
+    bool mapCache(const QString &path, quint64 key);
+    const uchar *section(quint32 offset, quint64 length) const;
+
+    QString dataDir_;
+    QFile   file_;
+    uchar  *map_{};
+    qint64  mapSize_{};
+    bool    rebuilt_{};
+};
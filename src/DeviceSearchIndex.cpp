@@ -0,0 +1,156 @@
+#include "DeviceSearchIndex.h"
+
+#include <QStringView>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Below this share of a word's trigrams, a name is not a fuzzy match
+constexpr double kMinTrigramShare = 0.6;
+
+// Query words; '@' separates words too, so "at28c256@dip28" works like
+// "at28c256 dip28"
+QStringList splitTerms(const QString &query) {
+    QStringList terms;
+    QString cur;
+    for (const QChar c : query) {
+        if (c.isSpace() || c == QLatin1Char('@')) {
+            if (!cur.isEmpty()) terms << std::exchange(cur, {});
+        } else {
+            cur += c.toLower();
+        }
+    }
+    if (!cur.isEmpty()) terms << cur;
+    return terms;
+}
+
+} // namespace
+
+quint32 DeviceSearchIndex::trigram(const QChar *p) {
+    return (quint32(p[0].unicode() & 0x3ff) << 20)
+         | (quint32(p[1].unicode() & 0x3ff) << 10)
+         |  quint32(p[2].unicode() & 0x3ff);
+}
+
+void DeviceSearchIndex::build(const QStringList &names) {
+    names_ = names;
+    folded_.clear();
+    folded_.reserve(names.size());
+    exact_.clear();
+    exact_.reserve(names.size());
+    postings_.clear();
+
+    std::vector<quint32> grams;
+    for (int row = 0; row < names.size(); ++row) {
+        const QString f = names.at(row).toLower();
+        folded_ << f;
+        if (!exact_.contains(f)) exact_.insert(f, row);
+
+        grams.clear();
+        for (int i = 0; i + 3 <= f.size(); ++i) grams.push_back(trigram(f.constData() + i));
+        std::sort(grams.begin(), grams.end());
+        grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+        for (quint32 g : grams) postings_[g].push_back(row);
+    }
+
+    sorted_.resize(names.size());
+    for (int i = 0; i < sorted_.size(); ++i) sorted_[i] = i;
+    std::sort(sorted_.begin(), sorted_.end(), [this](int a, int b) {
+        return folded_.at(a) < folded_.at(b);
+    });
+}
+
+int DeviceSearchIndex::indexOf(const QString &name) const {
+    return exact_.value(name.trimmed().toLower(), -1);
+}
+
+// Score of one name against all words, 0 if any word does not match
+int DeviceSearchIndex::score(int row, const QStringList &terms) const {
+    const QString &k = folded_.at(row);
+    const int at = k.indexOf(QLatin1Char('@'));
+    const QStringView base = at < 0 ? QStringView(k) : QStringView(k).left(at);
+
+    int total = 0;
+    for (const QString &t : terms) {
+        int s = 0;
+        int pos = -1;
+        if (k == t)                           s = 1000;
+        else if (base == t)                   s = 900;   // any package of it
+        else if (k.startsWith(t))             s = 800;
+        else if (base.endsWith(t))            s = 700;   // vendor prefix left out
+        else if ((pos = k.indexOf(t)) >= 0)   s = 600 - std::min(pos, 100);
+        else if (t.size() >= 3) {
+            // Typos: count how many of the word's trigrams the name has
+            int shared = 0;
+            const int grams = t.size() - 2;
+            for (int i = 0; i < grams; ++i)
+                if (k.contains(QStringView(t).mid(i, 3))) ++shared;
+            const double share = double(shared) / grams;
+            if (share >= kMinTrigramShare) s = int(400 * share);
+        }
+        if (s == 0) return 0;
+        total += s;
+    }
+    return total;
+}
+
+QVector<int> DeviceSearchIndex::search(const QString &query, int limit) const {
+    const QStringList terms = splitTerms(query);
+    if (terms.isEmpty() || names_.isEmpty()) return {};
+
+    const QString &longest = *std::max_element(terms.cbegin(), terms.cend(),
+        [](const QString &a, const QString &b) { return a.size() < b.size(); });
+
+    // Candidates: names sharing enough trigrams with the longest word, or
+    // for very short queries, names starting with it
+    QVector<int> candidates;
+    if (longest.size() < 3) {
+        auto lo = std::lower_bound(sorted_.cbegin(), sorted_.cend(), longest,
+            [this](int row, const QString &q) { return folded_.at(row) < q; });
+        for (; lo != sorted_.cend() && folded_.at(*lo).startsWith(longest); ++lo)
+            candidates << *lo;
+    } else {
+        std::vector<quint32> grams;
+        for (int i = 0; i + 3 <= longest.size(); ++i) grams.push_back(trigram(longest.constData() + i));
+        std::sort(grams.begin(), grams.end());
+        grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+
+        const int need = std::max(1, int(grams.size() * kMinTrigramShare + 0.999));
+        std::vector<quint16> hits(size_t(names_.size()), 0);
+        for (quint32 g : grams) {
+            auto it = postings_.constFind(g);
+            if (it == postings_.cend()) continue;
+            for (int row : it.value())
+                if (++hits[size_t(row)] == need) candidates << row;
+        }
+    }
+
+    struct Ranked {
+        int row;
+        int score;
+    };
+    std::vector<Ranked> ranked;
+    ranked.reserve(size_t(candidates.size()));
+    for (int row : std::as_const(candidates)) {
+        const int s = score(row, terms);
+        if (s > 0) ranked.push_back({ row, s });
+    }
+
+    // Best score first, then shorter names, then alphabetical
+    auto better = [this](const Ranked &a, const Ranked &b) {
+        if (a.score != b.score) return a.score > b.score;
+        const QString &na = folded_.at(a.row);
+        const QString &nb = folded_.at(b.row);
+        if (na.size() != nb.size()) return na.size() < nb.size();
+        return na < nb;
+    };
+    const size_t keep = std::min(ranked.size(), size_t(std::max(limit, 0)));
+    std::partial_sort(ranked.begin(), ranked.begin() + keep, ranked.end(), better);
+
+    QVector<int> out;
+    out.reserve(int(keep));
+    for (size_t i = 0; i < keep; ++i) out << ranked[i].row;
+    return out;
+}
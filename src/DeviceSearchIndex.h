@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <vector>
+
+// Search over the device names of one programmer.
+//
+// Built once per device list: an exact-name hash, the case-folded names in
+// sorted order for short prefixes, and trigram posting lists for everything
+// else. A query only scores the names that share enough trigrams with it,
+// so typing never walks the whole list.
+//
+// Matching is case-insensitive and forgiving about how names are written:
+// "28c256" finds "AT28C256" (vendor prefix left out), "at28c256" finds every
+// "AT28C256@..." package, and words may be given in any order
+// ("dip28 28c256"). A few typos still match through shared trigrams.
+class DeviceSearchIndex {
+public:
+    void build(const QStringList &names);
+    void clear() { build({}); }
+
+    int count() const { return int(names_.size()); }
+    const QString &name(int i) const { return names_.at(i); }
+
+    // Row of the name, ignoring case, or -1
+    int indexOf(const QString &name) const;
+
+    // Rows of the best matches, best first
+    QVector<int> search(const QString &query, int limit = 200) const;
+
+private:
+    static quint32 trigram(const QChar *p);
+    int score(int row, const QStringList &terms) const;
+
+    QStringList       names_;
+    QStringList       folded_;   // lower case, same rows as names_
+    QVector<int>      sorted_;   // rows ordered by folded_
+    QHash<QString, int> exact_;
+    QHash<quint32, std::vector<int>> postings_;  // trigram -> rows, ascending
+};
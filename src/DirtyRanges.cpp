@@ -0,0 +1,124 @@
+#include "DirtyRanges.h"
+
+#include <algorithm>
+#include <iterator>
+
+void DirtyRanges::clear() {
+    ranges_.clear();
+    bytes_ = 0;
+}
+
+void DirtyRanges::add(qint64 pos, qint64 length) {
+    if (length <= 0 || pos < 0) return;
+    qint64 beg = pos;
+    qint64 end = pos + length;
+
+    // Swallow every interval that overlaps or touches [beg, end)
+    auto it = ranges_.upper_bound(beg);
+    if (it != ranges_.begin()) {
+        auto prev = std::prev(it);
+        if (prev->second >= beg) it = prev;
+    }
+    while (it != ranges_.end() && it->first <= end) {
+        beg = std::min(beg, it->first);
+        end = std::max(end, it->second);
+        bytes_ -= it->second - it->first;
+        it = ranges_.erase(it);
+    }
+    ranges_.emplace_hint(it, beg, end);
+    bytes_ += end - beg;
+}
+
+bool DirtyRanges::contains(qint64 off) const {
+    auto it = ranges_.upper_bound(off);
+    if (it == ranges_.begin()) return false;
+    return std::prev(it)->second > off;
+}
+
+bool DirtyRanges::anyInRange(qint64 pos, qint64 length) const {
+    if (length <= 0) return false;
+    const qint64 next = nextFrom(pos);
+    return next >= 0 && next < pos + length;
+}
+
+qint64 DirtyRanges::nextFrom(qint64 off) const {
+    auto it = ranges_.upper_bound(off);
+    if (it != ranges_.begin()) {
+        auto prev = std::prev(it);
+        if (prev->second > off) return off;
+    }
+    return it == ranges_.end() ? -1 : it->first;
+}
+
+qint64 DirtyRanges::previousFrom(qint64 off) const {
+    if (off < 0) return -1;
+    auto it = ranges_.upper_bound(off);
+    if (it == ranges_.begin()) return -1;
+    --it;
+    return std::min(off, it->second - 1);
+}
+
+std::pair<qint64, qint64> DirtyRanges::rangeAt(qint64 off) const {
+    auto it = ranges_.upper_bound(off);
+    if (it == ranges_.begin() || std::prev(it)->second <= off) return { -1, -1 };
+    --it;
+    return { it->first, it->second };
+}
+
+void DirtyRanges::forEachInRange(qint64 pos, qint64 length, const RangeFn &fn) const {
+    if (length <= 0) return;
+    const qint64 end = pos + length;
+    auto it = ranges_.upper_bound(pos);
+    if (it != ranges_.begin() && std::prev(it)->second > pos) --it;
+    for (; it != ranges_.end() && it->first < end; ++it) {
+        const qint64 b = std::max(pos, it->first);
+        const qint64 e = std::min(end, it->second);
+        if (!fn(b, e - b)) return;
+    }
+}
+
+std::vector<std::pair<qint64, qint64>> DirtyRanges::takeFrom(qint64 pos) {
+    auto it = ranges_.upper_bound(pos);
+    if (it != ranges_.begin() && std::prev(it)->second > pos) --it;
+    std::vector<std::pair<qint64, qint64>> out(it, ranges_.end());
+    for (const auto &r : out) bytes_ -= r.second - r.first;
+    ranges_.erase(it, ranges_.end());
+    return out;
+}
+
+void DirtyRanges::insertGap(qint64 pos, qint64 length) {
+    if (length <= 0) return;
+    for (const auto &[beg, end] : takeFrom(pos)) {
+        if (beg < pos) {
+            // split around the gap
+            add(beg, pos - beg);
+            add(pos + length, end - pos);
+        } else {
+            add(beg + length, end - beg);
+        }
+    }
+}
+
+void DirtyRanges::removeSpan(qint64 pos, qint64 length) {
+    if (length <= 0) return;
+    const qint64 cut = pos + length;
+    for (const auto &[beg, end] : takeFrom(pos)) {
+        if (beg < pos) add(beg, std::min(end, pos) - beg);
+        if (end > cut) {
+            const qint64 b = std::max(beg, cut);
+            add(b - length, end - b);
+        }
+    }
+}
+
+void DirtyRanges::moveSpan(qint64 from, qint64 length, qint64 to) {
+    if (length <= 0 || from == to) return;
+    std::vector<std::pair<qint64, qint64>> moving;
+    forEachInRange(from, length, [&](qint64 start, qint64 len) {
+        moving.emplace_back(start - from, len);
+        return true;
+    });
+    removeSpan(from, length);
+    insertGap(to, length);
+    for (const auto &[rel, len] : moving) add(to + rel, len);
+}
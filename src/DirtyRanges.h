@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Set of edited byte offsets, stored as disjoint half-open intervals.
+//
+// Adjacent and overlapping additions are coalesced, so a bulk edit of any
+// size is a single entry. Queries are O(log n) in the number of intervals.
+class DirtyRanges {
+public:
+    bool   isEmpty() const { return ranges_.empty(); }
+    int    rangeCount() const { return int(ranges_.size()); }
+    qint64 byteCount() const { return bytes_; }
+    void   clear();
+
+    // Mark [pos, pos+length)
+    void add(qint64 pos, qint64 length);
+
+    bool contains(qint64 off) const;
+    bool anyInRange(qint64 pos, qint64 length) const;
+
+    // First dirty offset >= off, or -1
+    qint64 nextFrom(qint64 off) const;
+    // Last dirty offset <= off, or -1
+    qint64 previousFrom(qint64 off) const;
+    // The interval holding off as (start, end), or (-1, -1)
+    std::pair<qint64, qint64> rangeAt(qint64 off) const;
+
+    // Follow structural edits of the buffer; work is proportional to the
+    // number of intervals at or after pos
+    void insertGap(qint64 pos, qint64 length);
+    void removeSpan(qint64 pos, qint64 length);
+    void moveSpan(qint64 from, qint64 length, qint64 to);
+
+    // Visit the dirty parts of [pos, pos+length) in order, clipped to it.
+    // The callback returns false to stop early.
+    using RangeFn = std::function<bool(qint64 start, qint64 length)>;
+    void forEachInRange(qint64 pos, qint64 length, const RangeFn &fn) const;
+
+private:
+    // Take out every interval ending after pos, as (start, end) pairs
+    std::vector<std::pair<qint64, qint64>> takeFrom(qint64 pos);
+
+    std::map<qint64, qint64> ranges_; // start -> end
+    qint64 bytes_{};
+};
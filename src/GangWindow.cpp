@@ -0,0 +1,310 @@
+#include "GangWindow.h"
+
+#include "ProcessHandling.h"
+#include "ProgramPipeline.h"
+
+#include <QCheckBox>
+#include <QCoreApplication>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLocale>
+#include <QMessageBox>
+#include <QPlainTextEdit>
+#include <QProcess>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QStyleFactory>
+#include <QTabWidget>
+#include <QTableWidget>
+#include <QThread>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+GangWindow::GangWindow(const QStringList &programmers,
+                       const QString &device,
+                       const BufferEngine &image,
+                       const QStringList &extraFlags,
+                       bool verify,
+                       QWidget *parent)
+    : QDialog(parent), device_(device), image_(image),
+      extraFlags_(extraFlags), verify_(verify)
+{
+    setWindowTitle(tr("Gang programming - %1").arg(device));
+    setMinimumSize(640, 560);
+    auto *layout = new QVBoxLayout(this);
+
+    auto *intro = new QLabel(tr("Writes the buffer (%1 bytes) to %2 on every lane at once.")
+                             .arg(QLocale().toString(image_.size())).arg(device), this);
+    layout->addWidget(intro);
+
+    // One lane on the default minipro to begin with; any more need their
+    // own command, so seeding a lane per scanned programmer could not start
+    laneTable_ = new QTableWidget(0, 2, this);
+    laneTable_->setHorizontalHeaderLabels({ tr("Lane"), tr("minipro command (empty: default)") });
+    laneTable_->horizontalHeaderItem(1)->setToolTip(
+        tr("Program to run for this lane. Leading KEY=value words are set in its environment."));
+    laneTable_->horizontalHeader()->setStretchLastSection(true);
+    laneTable_->verticalHeader()->setVisible(false);
+    laneTable_->setSelectionBehavior(QAbstractItemView::SelectRows);
+    addLaneRow(programmers.isEmpty() ? tr("Lane 1") : programmers.first(), QString());
+    layout->addWidget(laneTable_);
+
+    auto *laneButtons = new QHBoxLayout;
+    btnAddLane_    = new QPushButton(tr("Add lane"), this);
+    btnRemoveLane_ = new QPushButton(tr("Remove lane"), this);
+    laneButtons->addWidget(btnAddLane_);
+    laneButtons->addWidget(btnRemoveLane_);
+    laneButtons->addStretch(1);
+    layout->addLayout(laneButtons);
+
+    chkPipeline_ = new QCheckBox(tr("Erase and blank check before writing"), this);
+    chkPipeline_->setChecked(true);
+    layout->addWidget(chkPipeline_);
+
+    auto *runButtons = new QHBoxLayout;
+    btnStart_  = new QPushButton(tr("Start all"), this);
+    btnCancel_ = new QPushButton(tr("Cancel all"), this);
+    btnCancel_->setEnabled(false);
+    runButtons->addWidget(btnStart_);
+    runButtons->addWidget(btnCancel_);
+    runButtons->addStretch(1);
+    layout->addLayout(runButtons);
+
+    // Progress lanes, then one log tab per lane
+    auto *barsBox = new QWidget(this);
+    laneBars_ = new QVBoxLayout(barsBox);
+    laneBars_->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(barsBox);
+
+    laneLogs_ = new QTabWidget(this);
+    layout->addWidget(laneLogs_, 1);
+
+    summary_ = new QLabel(this);
+    layout->addWidget(summary_);
+
+    connect(btnAddLane_, &QPushButton::clicked, this, [this]{
+        addLaneRow(tr("Lane %1").arg(laneTable_->rowCount() + 1), QString());
+    });
+    connect(btnRemoveLane_, &QPushButton::clicked, this, [this]{
+        const int row = laneTable_->currentRow();
+        if (row >= 0) laneTable_->removeRow(row);
+    });
+    connect(btnStart_, &QPushButton::clicked, this, &GangWindow::start);
+    connect(btnCancel_, &QPushButton::clicked, this, [this]{
+        for (Lane *lane : std::as_const(lanes_))
+            if (lane->running) lane->proc->cancel();
+    });
+}
+
+GangWindow::~GangWindow() {
+    stopLanes();
+}
+
+void GangWindow::reject() {
+    const bool running = std::any_of(lanes_.cbegin(), lanes_.cend(),
+                                     [](const Lane *l) { return l->running; });
+    if (running && QMessageBox::question(this, tr("Gang programming"),
+            tr("Lanes are still running. Stop them and close?")) != QMessageBox::Yes)
+        return;
+    QDialog::reject();
+}
+
+void GangWindow::addLaneRow(const QString &name, const QString &command) {
+    const int row = laneTable_->rowCount();
+    laneTable_->insertRow(row);
+    laneTable_->setItem(row, 0, new QTableWidgetItem(name));
+    laneTable_->setItem(row, 1, new QTableWidgetItem(command));
+}
+
+// Threads end after the running minipro is killed by its ProcessHandling
+void GangWindow::stopLanes() {
+    for (Lane *lane : std::as_const(lanes_)) {
+        disconnect(lane->proc, nullptr, this, nullptr);
+        lane->thread->quit();
+        lane->thread->wait();
+        delete lane->thread;
+        delete lane;
+    }
+    lanes_.clear();
+    // Results the lanes sent before stopping refer to the lanes just deleted
+    QCoreApplication::removePostedEvents(this, QEvent::MetaCall);
+
+    while (QLayoutItem *item = laneBars_->takeAt(0)) {
+        if (QLayout *row = item->layout()) {
+            while (QLayoutItem *w = row->takeAt(0)) {
+                delete w->widget();
+                delete w;
+            }
+        }
+        delete item;
+    }
+    while (laneLogs_->count() > 0) {
+        QWidget *page = laneLogs_->widget(0);
+        laneLogs_->removeTab(0);
+        delete page;
+    }
+}
+
+void GangWindow::start() {
+    // "[KEY=value ...] program" per row
+    struct LaneSetup {
+        QString     name;
+        QString     program;
+        QStringList environment;
+        QStringList ignored;
+        QString     binary;     // program resolved as ProcessHandling runs it
+    };
+    QList<LaneSetup> setups;
+    for (int row = 0; row < laneTable_->rowCount(); ++row) {
+        const auto text = [&](int col) {
+            const QTableWidgetItem *item = laneTable_->item(row, col);
+            return item ? item->text().trimmed() : QString();
+        };
+        LaneSetup setup;
+        setup.name = text(0).isEmpty() ? tr("Lane %1").arg(row + 1) : text(0);
+        QStringList words = QProcess::splitCommand(text(1));
+        while (!words.isEmpty() && words.first().indexOf('=') > 0) setup.environment << words.takeFirst();
+        setup.program = words.isEmpty() ? QString() : words.takeFirst();
+        setup.ignored = words;
+        setup.binary = ProcessHandling::resolveProgram(setup.program);
+        setups << setup;
+    }
+
+    // Lanes running the same binary the same way open the same programmer,
+    // and would fight over it. The default minipro always opens the first
+    // one, however it is named ("", "minipro", "/usr/bin/minipro").
+    const QString defaultBinary = ProcessHandling::resolveProgram(QString());
+    for (int i = 0; i < setups.size(); ++i) {
+        for (int j = i + 1; j < setups.size(); ++j) {
+            const LaneSetup &a = setups.at(i);
+            const LaneSetup &b = setups.at(j);
+            if (a.binary != b.binary) continue;
+            const bool bothDefault = a.binary == defaultBinary;
+            if (!bothDefault && a.environment != b.environment) continue;
+            QMessageBox::warning(this, tr("Gang programming"),
+                bothDefault
+                    ? tr("%1 and %2 both run the default minipro, which always opens the "
+                         "first programmer. Give each lane its own command.").arg(a.name, b.name)
+                    : tr("%1 and %2 run the same command and would drive the same "
+                         "programmer. Give each lane its own command.").arg(a.name, b.name));
+            return;
+        }
+    }
+
+    stopLanes();
+
+    ProgramPipeline pipeline;
+    if (chkPipeline_->isChecked()) pipeline = ProgramPipeline::standard(verify_);
+    else pipeline.stages << ProgramPipeline::Stage::Write;  // minipro erases and verifies itself
+
+    for (const LaneSetup &setup : std::as_const(setups)) {
+        auto *lane = new Lane;
+        lane->name = setup.name;
+
+        // Lane widgets
+        auto *barRow = new QHBoxLayout;
+        auto *label = new QLabel(lane->name, this);
+        label->setMinimumWidth(80);
+        lane->bar = new QProgressBar(this);
+        lane->bar->setRange(0, 100);
+        lane->bar->setValue(0);
+        lane->bar->setFormat(tr("Waiting"));
+        lane->bar->setStyle(QStyleFactory::create("Fusion"));
+        lane->status = new QLabel(this);
+        lane->status->setMinimumWidth(160);
+        barRow->addWidget(label);
+        barRow->addWidget(lane->bar, 1);
+        barRow->addWidget(lane->status);
+        laneBars_->addLayout(barRow);
+
+        lane->log = new QPlainTextEdit(this);
+        lane->log->setReadOnly(true);
+        laneLogs_->addTab(lane->log, lane->name);
+        if (!setup.ignored.isEmpty())
+            lane->log->appendPlainText(tr("[Gang] Ignoring arguments after the program: %1")
+                                       .arg(setup.ignored.join(' ')));
+
+        // Same setup as the main window's instance, one thread per lane
+        lane->thread = new QThread(this);
+        lane->proc = new ProcessHandling;
+        lane->proc->setMinipro(setup.program, setup.environment);
+        lane->proc->moveToThread(lane->thread);
+        connect(lane->thread, &QThread::finished, lane->proc, &QObject::deleteLater);
+
+        connect(lane->proc, &ProcessHandling::output, this,
+                [lane](quint64, const QList<ProcessHandling::OutputLine> &lines) {
+            for (const auto &line : lines) {
+                if (line.kind == ProcessHandling::OutputLine::Error)
+                    lane->log->appendHtml(QString("<span style=\"color:#d33\">%1</span>")
+                                          .arg(line.text.toHtmlEscaped()));
+                else
+                    lane->log->appendPlainText(line.text);
+            }
+        });
+        connect(lane->proc, &ProcessHandling::progress, this,
+                [lane](quint64, int pct, const QString &label) {
+            lane->bar->setValue(pct);
+            if (!label.isEmpty()) lane->bar->setFormat(label + " %p%");
+        });
+        connect(lane->proc, &ProcessHandling::pipelineDone, this,
+                [this, lane](bool ok, const QList<ProgramPipeline::StageResult> &results) {
+            QString detail;
+            if (!ok && !results.isEmpty())
+                detail = tr("%1 failed").arg(ProgramPipeline::stageName(results.last().stage));
+            laneFinished(lane, ok, detail);
+        });
+        // Covers a lane that ended without a pipeline result (failed start)
+        connect(lane->proc, &ProcessHandling::finished, this,
+                [this, lane](quint64, int exitCode, QProcess::ExitStatus) {
+            if (lane->running) laneFinished(lane, false, tr("exit=%1").arg(exitCode));
+        });
+
+        lanes_ << lane;
+        lane->thread->start();
+        lane->running = true;
+        lane->proc->runPipeline(lane->name, device_, pipeline, image_, extraFlags_);
+    }
+
+    runTimer_.start();
+    setRunning(!lanes_.isEmpty());
+    updateSummary();
+}
+
+void GangWindow::laneFinished(Lane *lane, bool ok, const QString &detail) {
+    if (!lane->running) return;
+    lane->running = false;
+    lane->passed = ok;
+    if (ok) lane->bar->setValue(100);
+    lane->bar->setFormat(ok ? tr("Done") : tr("Stopped at %p%"));
+    lane->status->setText(ok ? tr("PASS") : tr("FAIL %1").arg(detail));
+    lane->status->setStyleSheet(ok ? "color:#2a2;font-weight:bold" : "color:#d33;font-weight:bold");
+
+    updateSummary();
+    const bool anyRunning = std::any_of(lanes_.cbegin(), lanes_.cend(),
+                                        [](const Lane *l) { return l->running; });
+    if (!anyRunning) setRunning(false);
+}
+
+void GangWindow::updateSummary() {
+    int running = 0, passed = 0, failed = 0;
+    for (const Lane *lane : std::as_const(lanes_)) {
+        if (lane->running) ++running;
+        else if (lane->passed) ++passed;
+        else ++failed;
+    }
+    summary_->setText(tr("%1 passed, %2 failed, %3 running - %4 s")
+                      .arg(passed).arg(failed).arg(running)
+                      .arg(runTimer_.elapsed() / 1000.0, 0, 'f', 1));
+}
+
+// Lanes can't be edited while they run
+void GangWindow::setRunning(bool on) {
+    laneTable_->setEnabled(!on);
+    btnAddLane_->setEnabled(!on);
+    btnRemoveLane_->setEnabled(!on);
+    chkPipeline_->setEnabled(!on);
+    btnStart_->setEnabled(!on);
+    btnCancel_->setEnabled(on);
+}
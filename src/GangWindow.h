@@ -0,0 +1,83 @@
+#pragma once
+
+#include <QDialog>
+#include <QElapsedTimer>
+#include <QList>
+#include <QStringList>
+
+#include "BufferEngine.h"
+
+class QCheckBox;
+class QLabel;
+class QPlainTextEdit;
+class QProgressBar;
+class QPushButton;
+class QTabWidget;
+class QTableWidget;
+class QThread;
+class QVBoxLayout;
+class ProcessHandling;
+
+// Gang programming: the same image written to several programmers at once.
+//
+// Each lane runs its own ProcessHandling on its own thread with its own
+// minipro command, and has its own progress bar, log and pass/fail result.
+// minipro itself always opens the first programmer it finds, so a lane's
+// command is what ties it to one programmer (a wrapper script, a patched
+// minipro); leading KEY=value words set environment variables for it.
+// Commands are compared by the binary they resolve to: lanes that would run
+// the same one with the same environment, or two on the default minipro,
+// are refused.
+// Pointing every lane at tools/fake-minipro, each with its own FAKE_MINIPRO_*
+// settings, tries the whole thing out.
+class GangWindow : public QDialog {
+    Q_OBJECT
+public:
+    GangWindow(const QStringList &programmers,
+               const QString &device,
+               const BufferEngine &image,
+               const QStringList &extraFlags,
+               bool verify,
+               QWidget *parent = nullptr);
+    ~GangWindow() override;
+
+    // Asks first while lanes are still writing
+    void reject() override;
+
+private:
+    struct Lane {
+        QString          name;
+        QThread         *thread{};
+        ProcessHandling *proc{};
+        QProgressBar    *bar{};
+        QLabel          *status{};
+        QPlainTextEdit  *log{};
+        bool             running{false};
+        bool             passed{false};
+    };
+
+    void addLaneRow(const QString &name, const QString &command);
+    void start();
+    void stopLanes();
+    void laneFinished(Lane *lane, bool ok, const QString &detail);
+    void updateSummary();
+    void setRunning(bool on);
+
+    QString      device_;
+    BufferEngine image_;        // snapshot taken when the window opened
+    QStringList  extraFlags_;
+    bool         verify_{true};
+
+    QTableWidget *laneTable_{};
+    QPushButton  *btnAddLane_{};
+    QPushButton  *btnRemoveLane_{};
+    QCheckBox    *chkPipeline_{};
+    QPushButton  *btnStart_{};
+    QPushButton  *btnCancel_{};
+    QVBoxLayout  *laneBars_{};
+    QTabWidget   *laneLogs_{};
+    QLabel       *summary_{};
+
+    QList<Lane*>  lanes_;
+    QElapsedTimer runTimer_;
+};
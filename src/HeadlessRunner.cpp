@@ -0,0 +1,232 @@
+#include "HeadlessRunner.h"
+
+#include "Checksum.h"
+#include "ProcessHandling.h"
+#include "SizeParse.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include <cstdio>
+
+namespace {
+
+// A JSON number, or a string the load dialog would accept
+bool jsonSize(const QJsonValue &v, qulonglong &out) {
+    if (v.isDouble()) {
+        const qint64 n = v.toInteger(-1);
+        if (n < 0) return false;
+        out = qulonglong(n);
+        return true;
+    }
+    return v.isString() && parseSizeLike(v.toString(), out);
+}
+
+QString hex(qulonglong v) {
+    return "0x" + QString::number(v, 16).toUpper();
+}
+
+} // namespace
+
+HeadlessRunner::HeadlessRunner(QObject *parent)
+    : QObject(parent)
+{
+    // Lives on this thread: nothing else runs here that it could hold up
+    proc_ = new ProcessHandling(this);
+
+    connect(proc_, &ProcessHandling::output, this,
+            [this](quint64, const QList<ProcessHandling::OutputLine> &lines) {
+        for (const auto &line : lines) {
+            if (line.kind == ProcessHandling::OutputLine::Error) errors_ << line.text;
+            if (verbose_) std::fprintf(stderr, "%s\n", qPrintable(line.text));
+        }
+    });
+    connect(proc_, &ProcessHandling::pipelineDone, this, &HeadlessRunner::finish);
+    // A pipeline that never got going (minipro missing)
+    connect(proc_, &ProcessHandling::finished, this, [this](quint64, int, QProcess::ExitStatus) {
+        if (!finished_) finish(false, {});
+    });
+}
+
+void HeadlessRunner::run(const QString &jobPath) {
+    timer_.start();
+    QString error;
+    if (!loadJob(jobPath, &error)) {
+        fail(error);
+        return;
+    }
+    if (pipeline_.stages.isEmpty()) {
+        finish(true, {});
+        return;
+    }
+    proc_->runPipeline(programmer_, device_, pipeline_, image_.engine(), flags_);
+}
+
+bool HeadlessRunner::loadJob(const QString &jobPath, QString *error) {
+    QFile f(jobPath);
+    if (!f.open(QIODevice::ReadOnly)) {
+        *error = QString("%1: %2").arg(jobPath, f.errorString());
+        return false;
+    }
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(f.readAll(), &parseError);
+    if (!doc.isObject()) {
+        *error = QString("%1: %2 at offset %3").arg(jobPath, parseError.errorString())
+                     .arg(parseError.offset);
+        return false;
+    }
+    const QJsonObject job = doc.object();
+    const QDir base = QFileInfo(jobPath).absoluteDir();
+
+    device_     = job.value("device").toString().trimmed();
+    programmer_ = job.value("programmer").toString().trimmed();
+    for (const QJsonValue v : job.value("flags").toArray()) flags_ << v.toString();
+
+    qulonglong pad = 0xFF;
+    if (job.contains("pad") && (!jsonSize(job.value("pad"), pad) || pad > 0xFF)) {
+        *error = "invalid pad";
+        return false;
+    }
+
+    // The image, file by file
+    const QJsonArray files = job.value("files").toArray();
+    for (int i = 0; i < files.size(); ++i) {
+        const QJsonObject entry = files.at(i).toObject();
+        const QString path = base.absoluteFilePath(entry.value("path").toString());
+        QString openError;
+        const BufferSource data = BufferSource::mapFile(path, &openError);
+        if (!openError.isEmpty()) {
+            *error = QString("files[%1]: %2").arg(i).arg(openError);
+            return false;
+        }
+
+        qulonglong offset = qulonglong(image_.size()), length = qulonglong(data.size()), filePad = pad;
+        if ((entry.contains("offset") && !jsonSize(entry.value("offset"), offset))
+            || (entry.contains("length") && !jsonSize(entry.value("length"), length))
+            || (entry.contains("pad") && (!jsonSize(entry.value("pad"), filePad) || filePad > 0xFF))) {
+            *error = QString("files[%1]: invalid offset, length or pad").arg(i);
+            return false;
+        }
+        if (length == 0) length = qulonglong(data.size());
+        image_.place(qint64(offset), data, qint64(length), char(filePad));
+        files_.append(QJsonObject{
+            { "path",   path },
+            { "offset", hex(offset) },
+            { "length", qint64(length) },
+        });
+    }
+
+    qulonglong size = 0;
+    if (job.contains("size")) {
+        if (!jsonSize(job.value("size"), size)) {
+            *error = "invalid size";
+            return false;
+        }
+        if (size > qulonglong(image_.size())) image_.appendFill(qint64(size) - image_.size(), char(pad));
+    }
+
+    if (job.contains("save")) {
+        QSaveFile out(base.absoluteFilePath(job.value("save").toString()));
+        if (!out.open(QIODevice::WriteOnly) || !image_.writeTo(&out) || !out.commit()) {
+            *error = QString("save: %1").arg(out.errorString());
+            return false;
+        }
+    }
+
+    // Operations, run as one pipeline in the order given. That order must be
+    // erase, blank check, write, verify: a write after an erase stage skips
+    // its own erase, so anything else would program the wrong chip state.
+    for (const QJsonValue v : job.value("operations").toArray()) {
+        const QString op = v.toString().toLower();
+        QList<ProgramPipeline::Stage> add;
+        if (op == "program")          add = ProgramPipeline::standard().stages;
+        else if (op == "erase")       add << ProgramPipeline::Stage::Erase;
+        else if (op == "blank_check") add << ProgramPipeline::Stage::BlankCheck;
+        else if (op == "write")       add << ProgramPipeline::Stage::Write;
+        else if (op == "verify")      add << ProgramPipeline::Stage::Verify;
+        else {
+            *error = QString("unknown operation \"%1\"").arg(v.toString());
+            return false;
+        }
+        for (const auto stage : add) {
+            if (pipeline_.contains(stage)) continue;
+            if (!pipeline_.stages.isEmpty() && pipeline_.stages.last() > stage) {
+                *error = QString("operations out of order: %1 after %2")
+                             .arg(ProgramPipeline::stageName(stage),
+                                  ProgramPipeline::stageName(pipeline_.stages.last()));
+                return false;
+            }
+            pipeline_.stages << stage;
+        }
+    }
+    if (!pipeline_.stages.isEmpty()) {
+        if (device_.isEmpty()) {
+            *error = "no device";
+            return false;
+        }
+        const bool needsImage = pipeline_.contains(ProgramPipeline::Stage::Write)
+                                || pipeline_.contains(ProgramPipeline::Stage::Verify);
+        if (needsImage && image_.isEmpty()) {
+            *error = "nothing to write: the image is empty";
+            return false;
+        }
+    }
+    return true;
+}
+
+void HeadlessRunner::finish(bool ok, const QList<ProgramPipeline::StageResult> &results) {
+    if (finished_) return;
+    finished_ = true;
+
+    QJsonArray stages;
+    for (const auto &r : results) {
+        stages.append(QJsonObject{
+            { "stage",      ProgramPipeline::stageName(r.stage) },
+            { "ok",         r.ok },
+            { "skipped",    r.skipped },
+            { "exit_code",  r.exitCode },
+            { "elapsed_ms", r.elapsedMs },
+        });
+    }
+    report(ok ? 0 : 1, stages);
+}
+
+void HeadlessRunner::fail(const QString &error) {
+    finished_ = true;
+    errors_ << error;
+    report(2, {});
+}
+
+void HeadlessRunner::report(int exitCode, const QJsonArray &stages) {
+    QJsonObject result{
+        { "ok",         exitCode == 0 },
+        { "device",     device_ },
+        { "files",      files_ },
+        { "stages",     stages },
+        { "errors",     QJsonArray::fromStringList(errors_) },
+        { "elapsed_ms", timer_.elapsed() },
+    };
+    if (exitCode != 2) {
+        result.insert("image", QJsonObject{
+            { "size",  image_.size() },
+            { "crc32", hex(Checksum::crc32(image_.engine(), 0, image_.size())) },
+        });
+    }
+    const QByteArray json = QJsonDocument(result).toJson(QJsonDocument::Indented);
+
+    if (outputPath_.isEmpty()) {
+        std::fwrite(json.constData(), 1, size_t(json.size()), stdout);
+        std::fflush(stdout);
+    } else {
+        QSaveFile out(outputPath_);
+        if (!out.open(QIODevice::WriteOnly) || out.write(json) != json.size() || !out.commit()) {
+            std::fprintf(stderr, "%s: %s\n", qPrintable(outputPath_), qPrintable(out.errorString()));
+            if (exitCode == 0) exitCode = 2;
+        }
+    }
+    emit done(exitCode);
+}
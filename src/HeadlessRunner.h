@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QObject>
+#include <QStringList>
+
+#include "BufferDocument.h"
+#include "ProgramPipeline.h"
+
+class ProcessHandling;
+
+// `fireminipro --batch job.json`: builds the image from the files listed in
+// the job, runs its chip operations and reports the outcome as JSON, all
+// under QCoreApplication so no display or widget stack is needed.
+//
+// Job file (paths relative to the job file):
+//   {
+//     "device": "AT28C256",
+//     "flags": ["-y"],                      extra minipro arguments
+//     "pad": "0xFF",                        default pad byte
+//     "size": "32K",                        pad the image up to this size
+//     "files": [ { "path": "boot.bin", "offset": "0x0",
+//                  "length": "0x2000", "pad": "0xFF" } ],
+//     "save": "image.bin",                  write the assembled image
+//     "operations": ["erase", "blank_check", "write", "verify"]
+//   }
+// Numbers are JSON numbers or strings as in the load dialog (0x.., 32K).
+// "program" stands for the full erase, blank check, write, verify run.
+// Placement follows the load dialog: gaps are filled with the pad byte and
+// a file is cut or padded to its length.
+class HeadlessRunner : public QObject {
+    Q_OBJECT
+public:
+    explicit HeadlessRunner(QObject *parent = nullptr);
+
+    // Log lines go to stderr as they come
+    void setVerbose(bool on) { verbose_ = on; }
+    // Result to this file instead of stdout
+    void setOutputPath(const QString &path) { outputPath_ = path; }
+
+    // Starts the job; done() follows, also when the job file is bad
+    void run(const QString &jobPath);
+
+signals:
+    // 0: all went well, 1: an operation failed, 2: the job could not run
+    void done(int exitCode);
+
+private:
+    bool loadJob(const QString &jobPath, QString *error);
+    void finish(bool ok, const QList<ProgramPipeline::StageResult> &results);
+    void fail(const QString &error);
+    void report(int exitCode, const QJsonArray &stages);
+
+    ProcessHandling *proc_{};
+    bool             verbose_{false};
+    bool             finished_{false};
+    QString          outputPath_;
+    QElapsedTimer    timer_;
+
+    QString          device_;
+    QString          programmer_;
+    QStringList      flags_;
+    BufferDocument   image_;
+    ProgramPipeline  pipeline_;
+    QJsonArray       files_;     // where each file went, for the report
+    QStringList      errors_;
+};
@@ -0,0 +1,191 @@
+#include "HexDiffWindow.h"
+
+#include "DirtyRanges.h"
+#include "HexView.h"
+
+#include <QElapsedTimer>
+#include <QFont>
+#include <QLabel>
+#include <QListWidget>
+#include <QLocale>
+#include <QSplitter>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+namespace {
+
+constexpr int kMaxListed = 10000;
+
+QString hex(qint64 v) {
+    return QString("0x%1").arg(QString::number(v, 16).toUpper());
+}
+
+QString describe(const BinaryDiff::Hunk &h) {
+    const QLocale locale;
+    if (h.aLength == 0)
+        return QObject::tr("%1 / %2  inserted %3 bytes")
+            .arg(hex(h.aPos), hex(h.bPos), locale.toString(h.bLength));
+    if (h.bLength == 0)
+        return QObject::tr("%1 / %2  deleted %3 bytes")
+            .arg(hex(h.aPos), hex(h.bPos), locale.toString(h.aLength));
+    if (h.aLength == h.bLength)
+        return QObject::tr("%1 / %2  changed %3 bytes")
+            .arg(hex(h.aPos), hex(h.bPos), locale.toString(h.aLength));
+    return QObject::tr("%1 / %2  changed %3 → %4 bytes")
+        .arg(hex(h.aPos), hex(h.bPos), locale.toString(h.aLength), locale.toString(h.bLength));
+}
+
+} // namespace
+
+void HexDiffWorker::align(const BufferEngine &left, const BufferEngine &right) {
+    QElapsedTimer timer;
+    timer.start();
+    Result result;
+    result.left = left.flatten();
+    result.right = right.flatten();
+    result.hunks = BinaryDiff::diff(reinterpret_cast<const uchar *>(result.left.constData()), result.left.size(),
+                                    reinterpret_cast<const uchar *>(result.right.constData()), result.right.size(),
+                                    &cancelled_);
+    if (cancelled_.load()) return;
+    result.elapsedMs = timer.elapsed();
+    emit aligned(result);
+}
+
+HexDiffWindow::HexDiffWindow(const BufferEngine &left, const QString &leftName,
+                             const BufferEngine &right, const QString &rightName,
+                             QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle(tr("Diff - %1 / %2").arg(leftName, rightName));
+    resize(1300, 700);
+
+    QFont mono;
+    mono.setFamily("Courier New");
+    mono.setStyleHint(QFont::TypeWriter);
+    mono.setPointSizeF(font().pointSizeF() - 1);
+
+    auto *layout = new QVBoxLayout(this);
+    auto *split = new QSplitter(Qt::Horizontal, this);
+    const auto makeSide = [&](BufferDocument *doc, const QString &name, qint64 size) {
+        auto *box = new QWidget(split);
+        auto *boxLayout = new QVBoxLayout(box);
+        boxLayout->setContentsMargins(0, 0, 0, 0);
+        boxLayout->addWidget(new QLabel(tr("%1 (%2 bytes)").arg(name, QLocale().toString(size)), box));
+        auto *view = new HexView(box);
+        view->setFont(mono);
+        view->setReadOnly(true);
+        view->setDocument(doc);
+        boxLayout->addWidget(view, 1);
+        split->addWidget(box);
+        return view;
+    };
+    leftView_ = makeSide(&leftDoc_, leftName, left.size());
+    rightView_ = makeSide(&rightDoc_, rightName, right.size());
+    jumpList_ = new QListWidget(split);
+    jumpList_->setFont(mono);
+    split->addWidget(jumpList_);
+    split->setStretchFactor(0, 3);
+    split->setStretchFactor(1, 3);
+    split->setStretchFactor(2, 2);
+    layout->addWidget(split, 1);
+    status_ = new QLabel(tr("Aligning…"), this);
+    layout->addWidget(status_);
+
+    connect(leftView_, &HexView::scrolled, this, &HexDiffWindow::leftScrolled);
+    connect(rightView_, &HexView::scrolled, this, &HexDiffWindow::rightScrolled);
+    connect(leftView_, &HexView::cursorMoved, this, &HexDiffWindow::leftCursorMoved);
+    connect(rightView_, &HexView::cursorMoved, this, &HexDiffWindow::rightCursorMoved);
+    connect(jumpList_, &QListWidget::currentRowChanged, this, &HexDiffWindow::showHunk);
+
+    // The snapshots are copied into the call; flattening and diffing both
+    // happen on the worker
+    worker_ = new HexDiffWorker;
+    worker_->moveToThread(&workerThread_);
+    connect(&workerThread_, &QThread::finished, worker_, &QObject::deleteLater);
+    connect(worker_, &HexDiffWorker::aligned, this, &HexDiffWindow::aligned);
+    workerThread_.setObjectName("diff");
+    workerThread_.start();
+    QMetaObject::invokeMethod(worker_, [w = worker_, left, right]{ w->align(left, right); },
+                              Qt::QueuedConnection);
+}
+
+HexDiffWindow::~HexDiffWindow() {
+    disconnect(worker_, nullptr, this, nullptr);
+    worker_->cancel();
+    workerThread_.quit();
+    workerThread_.wait();
+}
+
+void HexDiffWindow::aligned(const HexDiffWorker::Result &result) {
+    leftSource_ = result.left;
+    rightSource_ = result.right;
+    hunks_ = result.hunks;
+    leftDoc_.append(leftSource_);
+    rightDoc_.append(rightSource_);
+
+    // The side missing the bytes of an insertion or deletion gets the byte
+    // at the gap marked (the last one for a gap at the end), so both panes
+    // show where the hunk is
+    const auto mark = [](DirtyRanges &marks, qint64 pos, qint64 length, qint64 size) {
+        if (length > 0) marks.add(pos, length);
+        else if (size > 0) marks.add(std::min(pos, size - 1), 1);
+    };
+    DirtyRanges leftMarks;
+    DirtyRanges rightMarks;
+    for (const auto &h : hunks_) {
+        mark(leftMarks, h.aPos, h.aLength, leftSource_.size());
+        mark(rightMarks, h.bPos, h.bLength, rightSource_.size());
+    }
+    leftView_->setMismatches(leftMarks);
+    rightView_->setMismatches(rightMarks);
+
+    const int listed = int(std::min<qsizetype>(hunks_.size(), kMaxListed));
+    for (int i = 0; i < listed; ++i) jumpList_->addItem(describe(hunks_.at(i)));
+
+    QString text = hunks_.isEmpty()
+        ? tr("The images are identical")
+        : tr("%1 differing regions").arg(QLocale().toString(hunks_.size()));
+    if (hunks_.size() > listed) text += tr(", the first %1 listed").arg(QLocale().toString(listed));
+    status_->setText(text + tr(", aligned in %1 ms").arg(QLocale().toString(result.elapsedMs)));
+}
+
+void HexDiffWindow::leftScrolled(qint64 top) {
+    if (syncing_) return;
+    syncing_ = true;
+    rightView_->scrollToTopOffset(BinaryDiff::mapAtoB(hunks_, top));
+    syncing_ = false;
+}
+
+void HexDiffWindow::rightScrolled(qint64 top) {
+    if (syncing_) return;
+    syncing_ = true;
+    leftView_->scrollToTopOffset(BinaryDiff::mapBtoA(hunks_, top));
+    syncing_ = false;
+}
+
+// The cursor follows on the other side, then the rows line up again
+void HexDiffWindow::leftCursorMoved(qint64 offset) {
+    if (syncing_) return;
+    syncing_ = true;
+    rightView_->scrollToOffset(BinaryDiff::mapAtoB(hunks_, offset), false);
+    rightView_->scrollToTopOffset(BinaryDiff::mapAtoB(hunks_, leftView_->topOffset()));
+    syncing_ = false;
+}
+
+void HexDiffWindow::rightCursorMoved(qint64 offset) {
+    if (syncing_) return;
+    syncing_ = true;
+    leftView_->scrollToOffset(BinaryDiff::mapBtoA(hunks_, offset), false);
+    leftView_->scrollToTopOffset(BinaryDiff::mapBtoA(hunks_, rightView_->topOffset()));
+    syncing_ = false;
+}
+
+void HexDiffWindow::showHunk(int index) {
+    if (index < 0 || index >= hunks_.size()) return;
+    const auto &h = hunks_.at(index);
+    syncing_ = true;
+    leftView_->scrollToOffset(h.aPos);
+    rightView_->scrollToOffset(h.bPos);
+    syncing_ = false;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QDialog>
+#include <QList>
+#include <QString>
+#include <QThread>
+
+#include <atomic>
+
+#include "BinaryDiff.h"
+#include "BufferDocument.h"
+
+class HexView;
+class QLabel;
+class QListWidget;
+
+// Aligns two images off the UI thread
+class HexDiffWorker : public QObject {
+    Q_OBJECT
+public:
+    struct Result {
+        // Contiguous for the diff: the mapped file itself, or a copy
+        BufferSource left;
+        BufferSource right;
+        QList<BinaryDiff::Hunk> hunks;
+        qint64 elapsedMs{0};
+    };
+
+    // Runs on the worker's thread
+    void align(const BufferEngine &left, const BufferEngine &right);
+    // Thread-safe: a running alignment stops early and reports nothing
+    void cancel() { cancelled_.store(true); }
+
+signals:
+    void aligned(const HexDiffWorker::Result &result);
+
+private:
+    std::atomic<bool> cancelled_{false};
+};
+
+// Two images side by side, aligned across inserted and deleted bytes.
+//
+// Differences are marked in both hex views and listed on the right;
+// scrolling or moving the cursor on one side brings the matching bytes
+// into view on the other. The views are read-only. Both sides are filled
+// once a worker thread has aligned them.
+class HexDiffWindow : public QDialog {
+    Q_OBJECT
+public:
+    HexDiffWindow(const BufferEngine &left, const QString &leftName,
+                  const BufferEngine &right, const QString &rightName,
+                  QWidget *parent = nullptr);
+    ~HexDiffWindow() override;
+
+private:
+    void aligned(const HexDiffWorker::Result &result);
+    void leftScrolled(qint64 top);
+    void rightScrolled(qint64 top);
+    void leftCursorMoved(qint64 offset);
+    void rightCursorMoved(qint64 offset);
+    void showHunk(int index);
+
+    // The sources keep file mappings alive and contiguous for the diff
+    BufferSource   leftSource_;
+    BufferSource   rightSource_;
+    BufferDocument leftDoc_;
+    BufferDocument rightDoc_;
+    QList<BinaryDiff::Hunk> hunks_;
+    bool syncing_{false};
+
+    QThread        workerThread_;
+    HexDiffWorker *worker_{};
+
+    HexView     *leftView_{};
+    HexView     *rightView_{};
+    QListWidget *jumpList_{};
+    QLabel      *status_{};
+};
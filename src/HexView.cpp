@@ -1,166 +1,664 @@
 #include "HexView.h"
+#include "BufferDocument.h"
 
-#include <QBrush>
+#include <QClipboard>
 #include <QColor>
-#include <QFont>
-#include <QVariant>
+#include <QFontMetrics>
+#include <QGuiApplication>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QSignalBlocker>
+#include <QVarLengthArray>
+#include <QWheelEvent>
 
-HexView::HexView(QObject *parent) : QAbstractTableModel(parent) {}
+#include <algorithm>
 
-void HexView::setBufferRef(QByteArray *buffer) {
-    beginResetModel();
-    buffer_ = buffer;
-    dirty_.clear(); // reset dirty tracking when buffer changes
-    endResetModel();
+namespace {
+constexpr char kHexDigits[] = "0123456789ABCDEF";
+
+// Atlas bands, 16x16 cells each: hex pairs and ASCII, normal and selected
+enum { kBandHex, kBandHexSel, kBandAscii, kBandAsciiSel };
+
+int bandX(int band, int charW) {
+    switch (band) {
+    case kBandHex:    return 0;
+    case kBandHexSel: return 32 * charW;
+    case kBandAscii:  return 64 * charW;
+    default:          return 80 * charW;
+    }
+}
+
+int cellWidth(int band, int charW) {
+    return band < kBandAscii ? 2 * charW : charW;
+}
+
+// Base shifted part of the way towards a saturated hue, so marks stay
+// readable on light and dark palettes alike
+QColor tint(const QColor &base, int hue, float amount) {
+    const QColor hueColor = QColor::fromHsl(hue, 200, 128);
+    return QColor::fromRgbF(base.redF() + (hueColor.redF() - base.redF()) * amount,
+                            base.greenF() + (hueColor.greenF() - base.greenF()) * amount,
+                            base.blueF() + (hueColor.blueF() - base.blueF()) * amount);
+}
+
+// QScrollBar is int based; beyond this many rows it steps several at a time
+constexpr qint64 kMaxScrollSteps = 1 << 30;
+
+// Upper bound for Ctrl+C, the text is three times the selection
+constexpr qint64 kMaxCopyBytes = 16 * 1024 * 1024;
+
+inline bool bytePrintable(uint8_t b) {
+    return b >= 32 && b <= 126;
+}
+} // namespace
+
+HexView::HexView(QWidget *parent) : QAbstractScrollArea(parent) {
+    setFocusPolicy(Qt::StrongFocus);
+    viewport()->setAttribute(Qt::WA_OpaquePaintEvent);
+    viewport()->setCursor(Qt::IBeamCursor);
+    updateMetrics();
+    updateScrollBars();
+}
+
+void HexView::setDocument(BufferDocument *doc) {
+    if (doc_) disconnect(doc_, nullptr, this, nullptr);
+    doc_ = doc;
+    if (doc_) {
+        connect(doc_, &BufferDocument::reset, this, &HexView::onReset);
+        connect(doc_, &BufferDocument::bytesInserted, this, &HexView::onInserted);
+        connect(doc_, &BufferDocument::bytesRemoved, this, &HexView::onRemoved);
+        connect(doc_, &BufferDocument::bytesMoved, this, &HexView::onMoved);
+        connect(doc_, &BufferDocument::bytesChanged, this, &HexView::invalidateRange);
+    }
+    onReset();
 }
 
 void HexView::clear() {
-    beginResetModel();
-    buffer_ = nullptr;
-    dirty_.clear();
-    endResetModel();
+    setDocument(nullptr);
+}
+
+void HexView::onReset() {
+    dirty_.clear(); // reset dirty tracking when buffer changes
+    mismatches_.clear();
+    topRow_ = cursor_ = anchor_ = 0;
+    nibble_ = 0;
+    refresh();
+}
+
+void HexView::onInserted(qint64 pos, qint64 length) {
+    dirty_.insertGap(pos, length);
+    mismatches_.insertGap(pos, length);
+    if (cursor_ >= pos && cursor_ < bufferSize() - length) cursor_ += length;
+    if (anchor_ >= pos && anchor_ < bufferSize() - length) anchor_ += length;
+    refresh();
+}
+
+void HexView::onRemoved(qint64 pos, qint64 length) {
+    dirty_.removeSpan(pos, length);
+    mismatches_.removeSpan(pos, length);
+    auto map = [&](qint64 off) {
+        if (off >= pos + length) return off - length;
+        return off >= pos ? pos : off;
+    };
+    cursor_ = map(cursor_);
+    anchor_ = map(anchor_);
+    refresh();
+}
+
+void HexView::onMoved(qint64 from, qint64 length, qint64 to) {
+    dirty_.moveSpan(from, length, to);
+    mismatches_.moveSpan(from, length, to);
+    auto map = [&](qint64 off) {
+        if (off >= from && off < from + length) return to + (off - from);
+        if (off >= from + length) off -= length;
+        return off >= to ? off + length : off;
+    };
+    cursor_ = map(cursor_);
+    anchor_ = map(anchor_);
+    invalidateRange(std::min(from, to), std::max(from, to) + length - std::min(from, to));
+}
+
+void HexView::refresh() {
+    const qint64 last = std::max<qint64>(0, bufferSize() - 1);
+    cursor_ = std::min(cursor_, last);
+    anchor_ = std::min(anchor_, last);
+    updateScrollBars();
+    viewport()->update();
+}
+
+void HexView::invalidateRange(qint64 offset, qint64 length) {
+    if (length <= 0) return;
+    const qint64 firstVisible = topRow_ * bytesPerRow_;
+    const qint64 endVisible = (topRow_ + visibleRows() + 1) * bytesPerRow_;
+    if (offset < endVisible && offset + length > firstVisible) viewport()->update();
 }
 
 void HexView::setBytesPerRow(int n) {
-    if (n < 1) n = 1;
+    n = std::clamp(n, 1, 256);
     if (bytesPerRow_ == n) return;
-    beginResetModel();
+    // Keep the byte at the top of the view where it is
+    const qint64 topOffset = topRow_ * bytesPerRow_;
     bytesPerRow_ = n;
-    endResetModel();
+    topRow_ = topOffset / n;
+    updateScrollBars();
+    viewport()->update();
 }
 
 void HexView::setSwapAscii16(bool on) {
     if (swapAscii16_ == on) return;
     swapAscii16_ = on;
-    if (rowCount() > 0 && columnCount() > 0) {
-        emit headerDataChanged(Qt::Horizontal, 0, columnCount()-1);
-        emit dataChanged(index(0, 0), index(rowCount()-1, columnCount()-1));
-    }
+    viewport()->update();
 }
 
-int HexView::rowCount(const QModelIndex &parent) const {
-    if (parent.isValid() || !buffer_) return 0;
-    const auto n = buffer_->size();
-    return (n + bytesPerRow_ - 1) / bytesPerRow_;
+void HexView::scrollToOffset(qint64 offset, bool center) {
+    const qint64 size = bufferSize();
+    if (size <= 0) return;
+    cursor_ = anchor_ = std::clamp<qint64>(offset, 0, size - 1);
+    nibble_ = 0;
+    activeArea_ = Area::Hex;
+    if (center) setTopRow(cursor_ / bytesPerRow_ - visibleRows() / 2);
+    else ensureCursorVisible();
+    viewport()->update();
+    emit cursorMoved(cursor_);
 }
 
-int HexView::columnCount(const QModelIndex &parent) const {
-    if (parent.isValid()) return 0;
-    // 0 = address, 1..bytesPerRow_ = hex bytes, last = ASCII
-    return 1 + bytesPerRow_ + 1;
+qint64 HexView::selectionStart() const {
+    return std::min(anchor_, cursor_);
 }
 
-QVariant HexView::headerData(int section, Qt::Orientation o, int role) const {
-    if (o != Qt::Horizontal || role != Qt::DisplayRole) return {};
-    if (section == 0) return QStringLiteral("Addr");
-    if (section == 1 + bytesPerRow_) {
-        return swapAscii16_ ? QStringLiteral("ASCII (swapped)") : QStringLiteral("ASCII");
+qint64 HexView::selectionLength() const {
+    if (bufferSize() <= 0) return 0;
+    return std::max(anchor_, cursor_) - selectionStart() + 1;
+}
+
+void HexView::clearDirty() { dirty_.clear(); viewport()->update(); }
+bool HexView::isDirty(qint64 off) const { return dirty_.contains(off); }
+qint64 HexView::dirtyCount() const { return dirty_.byteCount(); }
+
+bool HexView::gotoNextDirty() {
+    const qint64 off = dirty_.nextFrom(cursor_ + 1);
+    if (off < 0 || off >= bufferSize()) return false;
+    scrollToOffset(off, false);
+    return true;
+}
+
+bool HexView::gotoPreviousDirty() {
+    const qint64 off = dirty_.previousFrom(cursor_ - 1);
+    if (off < 0) return false;
+    scrollToOffset(off, false);
+    return true;
+}
+
+void HexView::setMismatches(const DirtyRanges &ranges) {
+    mismatches_ = ranges;
+    viewport()->update();
+}
+
+void HexView::clearMismatches() {
+    mismatches_.clear();
+    viewport()->update();
+}
+
+bool HexView::gotoNextMismatch() {
+    const auto here = mismatches_.rangeAt(cursor_);
+    const qint64 off = mismatches_.nextFrom(here.first >= 0 ? here.second : cursor_ + 1);
+    if (off < 0 || off >= bufferSize()) return false;
+    scrollToOffset(off, true);
+    return true;
+}
+
+bool HexView::gotoPreviousMismatch() {
+    const auto here = mismatches_.rangeAt(cursor_);
+    const qint64 last = mismatches_.previousFrom((here.first >= 0 ? here.first : cursor_) - 1);
+    if (last < 0) return false;
+    scrollToOffset(mismatches_.rangeAt(last).first, true);
+    return true;
+}
+
+qint64 HexView::bufferSize() const {
+    return doc_ ? doc_->size() : 0;
+}
+
+qint64 HexView::totalRows() const {
+    return (bufferSize() + bytesPerRow_ - 1) / bytesPerRow_;
+}
+
+int HexView::visibleRows() const {
+    // first line is the column header
+    return std::max(0, (viewport()->height() - lineH_) / lineH_);
+}
+
+qint64 HexView::maxTopRow() const {
+    return std::max<qint64>(0, totalRows() - std::max(1, visibleRows()));
+}
+
+void HexView::updateMetrics() {
+    const QFontMetrics fm(font());
+    charW_  = std::max(1, fm.horizontalAdvance(QLatin1Char('0')));
+    lineH_  = fm.height() + 4;
+    ascent_ = fm.ascent() + 2;
+    atlas_ = QPixmap(); // rebuilt on next paint
+}
+
+void HexView::rebuildAtlas() {
+    const qreal dpr = devicePixelRatioF();
+    const int hexW = 2 * charW_;
+    QPixmap atlas(QSize(96 * charW_, 16 * lineH_) * dpr);
+    atlas.setDevicePixelRatio(dpr);
+    atlas.fill(Qt::transparent);
+
+    QPainter p(&atlas);
+    p.setFont(font());
+    const QColor colors[2] = { palette().color(QPalette::Text),
+                               palette().color(QPalette::HighlightedText) };
+    for (int sel = 0; sel < 2; ++sel) {
+        p.setPen(colors[sel]);
+        const int hexBand = bandX(kBandHex + sel, charW_);
+        const int asciiBand = bandX(kBandAscii + sel, charW_);
+        for (int v = 0; v < 256; ++v) {
+            const int y = (v / 16) * lineH_ + ascent_;
+            const QChar pair[2] = { QLatin1Char(kHexDigits[v >> 4]), QLatin1Char(kHexDigits[v & 0xF]) };
+            p.drawText(QPointF(hexBand + (v % 16) * hexW, y), QString(pair, 2));
+            const QChar ch = bytePrintable(uint8_t(v)) ? QChar(v) : QLatin1Char('.');
+            p.drawText(QPointF(asciiBand + (v % 16) * charW_, y), QString(ch));
+        }
     }
-    if (section >= 1 && section <= bytesPerRow_) {
-        return QString("%1").arg(section-1, 2, 16, QLatin1Char('0')).toUpper();
+    p.end();
+
+    atlas_ = atlas;
+    atlasDpr_ = dpr;
+}
+
+void HexView::updateScrollBars() {
+    // Enough address digits for the last offset
+    const qint64 size = bufferSize();
+    const qulonglong last = size > 0 ? qulonglong(size - 1) : 0;
+    int digits = 8;
+    while (digits < 16 && (last >> (4 * digits)) != 0) digits += 2;
+    addrDigits_ = digits;
+
+    const qint64 maxTop = maxTopRow();
+    topRow_ = std::clamp<qint64>(topRow_, 0, maxTop);
+    scrollScale_ = std::max<qint64>(1, (maxTop + kMaxScrollSteps - 1) / kMaxScrollSteps);
+
+    QScrollBar *vbar = verticalScrollBar();
+    {
+        const QSignalBlocker block(vbar);
+        vbar->setRange(0, int((maxTop + scrollScale_ - 1) / scrollScale_));
+        vbar->setPageStep(std::max(1, int(visibleRows() / scrollScale_)));
+        vbar->setSingleStep(1);
+        vbar->setValue(topRow_ >= maxTop ? vbar->maximum() : int(topRow_ / scrollScale_));
     }
-    return {};
+
+    QScrollBar *hbar = horizontalScrollBar();
+    hbar->setRange(0, std::max(0, contentWidth() - viewport()->width()));
+    hbar->setPageStep(viewport()->width());
+    hbar->setSingleStep(charW_);
 }
 
-static inline bool bytePrintable(uint8_t b) {
-    return b >= 32 && b <= 126;
+void HexView::setTopRow(qint64 row) {
+    row = std::clamp<qint64>(row, 0, maxTopRow());
+    if (row == topRow_) return;
+    topRow_ = row;
+    QScrollBar *vbar = verticalScrollBar();
+    const QSignalBlocker block(vbar);
+    vbar->setValue(topRow_ >= maxTopRow() ? vbar->maximum() : int(topRow_ / scrollScale_));
+    viewport()->update();
+    emit scrolled(topOffset());
 }
 
-QVariant HexView::data(const QModelIndex &idx, int role) const {
-    if (!idx.isValid() || !buffer_) return {};
-    const int r = idx.row();
-    const int c = idx.column();
+void HexView::scrollToTopOffset(qint64 offset) {
+    setTopRow(offset / bytesPerRow_);
+}
 
-    const qint64 rowBase = qint64(r) * bytesPerRow_;
+void HexView::ensureCursorVisible() {
+    const qint64 row = cursor_ / bytesPerRow_;
+    const int fullRows = std::max(1, visibleRows());
+    if (row < topRow_) setTopRow(row);
+    else if (row >= topRow_ + fullRows) setTopRow(row - fullRows + 1);
+}
 
-    // Background tint for dirty bytes (hex columns) or for ascii row if any byte dirty
-    if (role == Qt::BackgroundRole) {
-        if (c >= 1 && c <= bytesPerRow_) {
-            const qint64 off = rowBase + (c - 1);
-            if (off < buffer_->size() && isDirty(off)) return QBrush(QColor(255,245,200));
-        } else if (c == 1 + bytesPerRow_) {
-            for (int i=0; i<bytesPerRow_; ++i) {
-                const qint64 off = rowBase + i;
-                if (off < buffer_->size() && isDirty(off)) return QBrush(QColor(255,245,200));
-            }
-        }
+void HexView::moveCursor(qint64 offset, bool extendSelection) {
+    const qint64 size = bufferSize();
+    if (size <= 0) return;
+    cursor_ = std::clamp<qint64>(offset, 0, size - 1);
+    if (!extendSelection) anchor_ = cursor_;
+    ensureCursorVisible();
+    viewport()->update();
+    emit cursorMoved(cursor_);
+}
+
+bool HexView::editNibble(int digit) {
+    const qint64 size = bufferSize();
+    if (readOnly_ || cursor_ >= size) return false;
+    const uint8_t old = uint8_t(doc_->at(cursor_));
+    const uint8_t b = nibble_ == 0 ? uint8_t((digit << 4) | (old & 0x0F))
+                                   : uint8_t((old & 0xF0) | digit);
+    if (doc_->setByte(cursor_, char(b))) {
+        dirty_.add(cursor_, 1);
+        emit byteEdited(cursor_);
+    }
+    if (nibble_ == 0) {
+        nibble_ = 1;
+        anchor_ = cursor_;
+        viewport()->update();
+    } else {
+        nibble_ = 0;
+        moveCursor(cursor_ + 1, false);
     }
+    return true;
+}
 
-    if (role == Qt::TextAlignmentRole) {
-        if (c == 0) return int(Qt::AlignRight | Qt::AlignVCenter);
-        if (c >= 1 && c <= bytesPerRow_) return int(Qt::AlignHCenter | Qt::AlignVCenter);
-        return int(Qt::AlignLeft | Qt::AlignVCenter);
+void HexView::copySelection() {
+    if (!doc_) return;
+    const qint64 len = std::min(selectionLength(), kMaxCopyBytes);
+    if (len <= 0) return;
+    QByteArray text;
+    text.reserve(int(len * 3));
+    doc_->forEachChunk(selectionStart(), len, [&](const char *data, qint64 n) {
+        for (qint64 i = 0; i < n; ++i) {
+            const uint8_t b = uint8_t(data[i]);
+            if (!text.isEmpty()) text.append(' ');
+            text.append(kHexDigits[b >> 4]);
+            text.append(kHexDigits[b & 0xF]);
+        }
+        return true;
+    });
+    QGuiApplication::clipboard()->setText(QString::fromLatin1(text));
+}
+
+int HexView::byteX(int column) const {
+    // address, two blanks, then "XX " per byte with an extra blank every 8
+    return charW_ * (1 + addrDigits_ + 2 + column * 3 + column / 8);
+}
+
+int HexView::asciiX() const {
+    return byteX(bytesPerRow_ - 1) + 4 * charW_;
+}
+
+int HexView::contentWidth() const {
+    return asciiX() + (bytesPerRow_ + 1) * charW_;
+}
+
+HexView::Hit HexView::hitTest(const QPoint &pos) const {
+    Hit hit;
+    const qint64 size = bufferSize();
+    if (size <= 0) return hit;
+
+    const int x = pos.x() + horizontalScrollBar()->value();
+    const int y = pos.y() - lineH_;
+    const qint64 row = std::clamp<qint64>(topRow_ + (y < 0 ? -1 : y / lineH_), 0, totalRows() - 1);
+
+    int column = 0;
+    const int ax = asciiX();
+    if (x >= ax - charW_) {
+        column = x > ax ? (x - ax) / charW_ : 0;
+        hit.area = Area::Ascii;
+    } else {
+        const int group = 8 * 3 * charW_ + charW_;
+        const int local = std::max(0, x - byteX(0));
+        const int within = local % group;
+        column = (local / group) * 8 + std::min(7, within / (3 * charW_));
+        hit.nibble = (within % (3 * charW_)) >= charW_ ? 1 : 0;
+        hit.area = Area::Hex;
     }
+    column = std::clamp(column, 0, bytesPerRow_ - 1);
+    hit.offset = std::min(size - 1, row * bytesPerRow_ + column);
+    return hit;
+}
+
+bool HexView::inSelection(qint64 off) const {
+    if (anchor_ == cursor_) return false;
+    return off >= std::min(anchor_, cursor_) && off <= std::max(anchor_, cursor_);
+}
+
+void HexView::paintEvent(QPaintEvent *) {
+    QPainter p(viewport());
+    const QPalette pal = palette();
+    p.fillRect(viewport()->rect(), pal.color(QPalette::Base));
+    if (atlas_.isNull() || !qFuzzyCompare(atlasDpr_, devicePixelRatioF())) rebuildAtlas();
+
+    const int xOff = horizontalScrollBar()->value();
+    p.translate(-xOff, 0);
+
+    const int hexW = 2 * charW_;
+    const int ax = asciiX();
+    const int width = std::max(contentWidth(), viewport()->width() + xOff);
+
+    // Fetch all visible bytes with a single walk of the piece tree
+    const qint64 size = bufferSize();
+    const int rows = visibleRows() + 1; // plus the partially visible one
+    const qint64 firstOff = topRow_ * bytesPerRow_;
+    const qint64 avail = size > firstOff ? std::min<qint64>(size - firstOff, qint64(rows) * bytesPerRow_) : 0;
+    rowScratch_.resize(int(avail));
+    if (avail > 0) doc_->read(firstOff, rowScratch_.data(), avail);
+    const auto *bytes = reinterpret_cast<const uint8_t *>(rowScratch_.constData());
+
+    QVarLengthArray<QPainter::PixmapFragment, 4096> frags;
+    const qreal scale = 1.0 / atlasDpr_;
+    auto blit = [&](int band, int value, int x, int y) {
+        const int w = cellWidth(band, charW_);
+        const QRectF src((bandX(band, charW_) + (value % 16) * w) * atlasDpr_,
+                         (value / 16) * lineH_ * atlasDpr_,
+                         w * atlasDpr_, lineH_ * atlasDpr_);
+        frags.append(QPainter::PixmapFragment::create(QPointF(x + w * 0.5, y + lineH_ * 0.5),
+                                                      src, scale, scale));
+    };
+
+    const QColor altColor = pal.color(QPalette::AlternateBase);
+    const QColor selColor = pal.color(QPalette::Highlight);
+    const QColor dirtyColor = tint(pal.color(QPalette::Base), 50, 0.25f);    // yellow
+    const QColor mismatchColor = tint(pal.color(QPalette::Base), 0, 0.35f);  // red
+
+    for (int r = 0; r < rows; ++r) {
+        const qint64 rowOff = firstOff + qint64(r) * bytesPerRow_;
+        if (rowOff >= size) break;
+        const int y = lineH_ * (r + 1);
+        if ((topRow_ + r) & 1) p.fillRect(0, y, width, lineH_, altColor);
 
-    if (role == Qt::DisplayRole) {
         // address
-        if (c == 0) {
-            return QString("%1").arg(rowBase, 8, 16, QLatin1Char('0')).toUpper();
-        }
+        qulonglong addr = qulonglong(rowOff);
+        for (int d = addrDigits_ - 1; d >= 0; --d, addr >>= 4)
+            blit(kBandAscii, kHexDigits[addr & 0xF], charW_ * (1 + d), y);
 
-        // hex bytes
-        if (c >= 1 && c <= bytesPerRow_) {
-            const qint64 off = rowBase + (c - 1);
-            if (off >= buffer_->size()) return QString("  ");
-            const uint8_t b = uint8_t(buffer_->at(int(off)));
-            return QString("%1").arg(b, 2, 16, QLatin1Char('0')).toUpper();
-        }
+        const int base = r * bytesPerRow_;
+        const int n = int(std::min<qint64>(bytesPerRow_, size - rowOff));
+
+        // edited spans of this row, one rectangle each
+        dirty_.forEachInRange(rowOff, n, [&](qint64 start, qint64 len) {
+            const int a = int(start - rowOff);
+            const int b = a + int(len);
+            p.fillRect(byteX(a), y, byteX(b - 1) + hexW - byteX(a), lineH_, dirtyColor);
+            p.fillRect(ax + a * charW_, y, (b - a) * charW_, lineH_, dirtyColor);
+            return true;
+        });
+        mismatches_.forEachInRange(rowOff, n, [&](qint64 start, qint64 len) {
+            const int a = int(start - rowOff);
+            const int b = a + int(len);
+            p.fillRect(byteX(a), y, byteX(b - 1) + hexW - byteX(a), lineH_, mismatchColor);
+            p.fillRect(ax + a * charW_, y, (b - a) * charW_, lineH_, mismatchColor);
+            return true;
+        });
 
-        // ascii column
-        if (c == 1 + bytesPerRow_) {
-            QString s; s.reserve(bytesPerRow_);
-            for (int i=0; i<bytesPerRow_; ++i) {
-                const qint64 off = rowBase + i;
-                if (off >= buffer_->size()) { s.append(' '); continue; }
-                const uint8_t b = uint8_t(buffer_->at(int(off)));
-                uint8_t ch = b;
-                if (swapAscii16_) {
-                    // swap each pair within the row region
-                    const int iPair = (i ^ 1);
-                    const qint64 other = rowBase + iPair;
-                    if (other < buffer_->size()) ch = uint8_t(buffer_->at(int(other)));
-                }
-                s.append(bytePrintable(ch) ? QChar(ch) : QChar('.'));
+        for (int i = 0; i < n; ++i) {
+            const qint64 off = rowOff + i;
+            const bool sel = inSelection(off);
+            const int hx = byteX(i);
+            const int cx = ax + i * charW_;
+            if (sel) {
+                // join the highlight with the next selected byte on this row
+                const int w = (i + 1 < n && inSelection(off + 1)) ? byteX(i + 1) - hx : hexW;
+                p.fillRect(hx, y, w, lineH_, selColor);
+                p.fillRect(cx, y, charW_, lineH_, selColor);
             }
-            return s;
+            blit(sel ? kBandHexSel : kBandHex, bytes[base + i], hx, y);
+            // swap each pair within the row region
+            const int ci = (swapAscii16_ && (i ^ 1) < n) ? (i ^ 1) : i;
+            blit(sel ? kBandAsciiSel : kBandAscii, bytes[base + ci], cx, y);
         }
     }
+    if (!frags.isEmpty()) p.drawPixmapFragments(frags.constData(), int(frags.size()), atlas_);
+
+    // cursor
+    const qint64 cursorRow = cursor_ / bytesPerRow_;
+    if (size > 0 && cursorRow >= topRow_ && cursorRow < topRow_ + rows) {
+        const int y = lineH_ * int(cursorRow - topRow_ + 1);
+        const int col = int(cursor_ % bytesPerRow_);
+        const QColor textColor = pal.color(QPalette::Text);
+        const QPen active(textColor);
+        const QPen passive(textColor, 1, Qt::DotLine);
+        p.setBrush(Qt::NoBrush);
+        p.setPen(activeArea_ == Area::Hex ? active : passive);
+        p.drawRect(byteX(col) - 1, y, hexW + 1, lineH_ - 1);
+        p.setPen(activeArea_ == Area::Ascii ? active : passive);
+        p.drawRect(ax + col * charW_, y, charW_, lineH_ - 1);
+        if (hasFocus() && activeArea_ == Area::Hex)
+            p.fillRect(byteX(col) + nibble_ * charW_, y + lineH_ - 3, charW_, 2, textColor);
+    }
 
-    return {};
+    // column header
+    p.fillRect(0, 0, width, lineH_, pal.color(QPalette::Button));
+    p.setPen(pal.color(QPalette::ButtonText));
+    p.drawText(QRect(charW_, 0, addrDigits_ * charW_, lineH_), Qt::AlignLeft | Qt::AlignVCenter,
+               QStringLiteral("Addr"));
+    for (int i = 0; i < bytesPerRow_; ++i) {
+        const QChar label[2] = { QLatin1Char(kHexDigits[(i >> 4) & 0xF]), QLatin1Char(kHexDigits[i & 0xF]) };
+        p.drawText(QRect(byteX(i), 0, hexW, lineH_), Qt::AlignCenter, QString(label, 2));
+    }
+    p.drawText(QRect(ax, 0, width - ax, lineH_), Qt::AlignLeft | Qt::AlignVCenter,
+               swapAscii16_ ? QStringLiteral("ASCII (swapped)") : QStringLiteral("ASCII"));
 }
 
-Qt::ItemFlags HexView::flags(const QModelIndex &idx) const {
-    if (!idx.isValid()) return Qt::NoItemFlags;
-    const int c = idx.column();
-    // editable hex bytes only (not address or ascii)
-    if (c >= 1 && c <= bytesPerRow_) return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable;
-    return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+void HexView::resizeEvent(QResizeEvent *event) {
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
 }
 
-bool HexView::setData(const QModelIndex &idx, const QVariant &val, int role) {
-    if (role != Qt::EditRole || !buffer_) return false;
-    const int r = idx.row();
-    const int c = idx.column();
-    if (c < 1 || c > bytesPerRow_) return false;
+void HexView::changeEvent(QEvent *event) {
+    QAbstractScrollArea::changeEvent(event);
+    switch (event->type()) {
+    case QEvent::FontChange:
+        updateMetrics();
+        updateScrollBars();
+        viewport()->update();
+        break;
+    case QEvent::PaletteChange:
+    case QEvent::StyleChange:
+        atlas_ = QPixmap();
+        viewport()->update();
+        break;
+    default:
+        break;
+    }
+}
 
-    const qint64 off = qint64(r) * bytesPerRow_ + (c - 1);
-    if (off < 0 || off >= buffer_->size()) return false;
+void HexView::scrollContentsBy(int, int dy) {
+    if (dy != 0) {
+        const QScrollBar *vbar = verticalScrollBar();
+        topRow_ = vbar->value() >= vbar->maximum() ? maxTopRow()
+                                                   : qint64(vbar->value()) * scrollScale_;
+    }
+    viewport()->update();
+    if (dy != 0) emit scrolled(topOffset());
+}
 
-    // parse two-hex-digit string
-    bool ok = false;
-    QString t = val.toString().trimmed();
-    if (t.startsWith("0x", Qt::CaseInsensitive)) t = t.mid(2);
-    const int b = t.toInt(&ok, 16);
-    if (!ok || b < 0 || b > 255) return false;
+void HexView::wheelEvent(QWheelEvent *event) {
+    const int delta = event->angleDelta().y();
+    if (delta == 0 || event->modifiers().testFlag(Qt::ControlModifier)) {
+        QAbstractScrollArea::wheelEvent(event);
+        return;
+    }
+    // three rows per notch, in exact rows even when the scroll bar is scaled
+    wheelRemainder_ += delta;
+    const int steps = wheelRemainder_ / 40;
+    wheelRemainder_ -= steps * 40;
+    if (steps != 0) setTopRow(topRow_ - steps);
+    event->accept();
+}
 
-    char &ref = (*buffer_)[int(off)];
-    if (ref == char(b)) return false;
-    ref = char(b);
-    dirty_.insert(off);
-    emit dataChanged(index(r, 0), index(r, columnCount()-1));
-    return true;
+void HexView::keyPressEvent(QKeyEvent *event) {
+    const qint64 size = bufferSize();
+    if (size <= 0) {
+        QAbstractScrollArea::keyPressEvent(event);
+        return;
+    }
+    if (event->matches(QKeySequence::Copy)) {
+        copySelection();
+        return;
+    }
+    if (event->matches(QKeySequence::SelectAll)) {
+        anchor_ = 0;
+        nibble_ = 0;
+        moveCursor(size - 1, true);
+        return;
+    }
+
+    // Alt+Up/Down jumps between edited bytes
+    if (event->modifiers().testFlag(Qt::AltModifier)) {
+        if (event->key() == Qt::Key_Down) { gotoNextDirty(); return; }
+        if (event->key() == Qt::Key_Up) { gotoPreviousDirty(); return; }
+    }
+
+    const bool shift = event->modifiers().testFlag(Qt::ShiftModifier);
+    const bool ctrl  = event->modifiers().testFlag(Qt::ControlModifier);
+    const qint64 page = qint64(std::max(1, visibleRows())) * bytesPerRow_;
+    const qint64 rowStart = cursor_ - cursor_ % bytesPerRow_;
+
+    qint64 target = cursor_;
+    switch (event->key()) {
+    case Qt::Key_Left:
+        if (activeArea_ == Area::Hex && nibble_ == 1 && !shift) {
+            nibble_ = 0;
+            viewport()->update();
+            return;
+        }
+        target = cursor_ - 1;
+        break;
+    case Qt::Key_Right:    target = cursor_ + 1; break;
+    case Qt::Key_Up:       target = cursor_ - bytesPerRow_; break;
+    case Qt::Key_Down:     target = cursor_ + bytesPerRow_; break;
+    case Qt::Key_PageUp:   target = cursor_ - page; break;
+    case Qt::Key_PageDown: target = cursor_ + page; break;
+    case Qt::Key_Home:     target = ctrl ? 0 : rowStart; break;
+    case Qt::Key_End:      target = ctrl ? size - 1 : rowStart + bytesPerRow_ - 1; break;
+    default: {
+        // hex digits overwrite the nibble under the cursor
+        const QString text = event->text();
+        if (activeArea_ == Area::Hex && !ctrl && text.size() == 1) {
+            bool ok = false;
+            const int digit = text.toInt(&ok, 16);
+            if (ok && editNibble(digit)) return;
+        }
+        QAbstractScrollArea::keyPressEvent(event);
+        return;
+    }
+    }
+    nibble_ = 0;
+    moveCursor(target, shift);
 }
 
-void HexView::clearDirty() { dirty_.clear(); }
-bool HexView::isDirty(qint64 off) const { return dirty_.contains(off); }
-int  HexView::dirtyCount() const { return dirty_.size(); }
+void HexView::mousePressEvent(QMouseEvent *event) {
+    if (event->button() != Qt::LeftButton) {
+        QAbstractScrollArea::mousePressEvent(event);
+        return;
+    }
+    const Hit hit = hitTest(event->position().toPoint());
+    if (hit.offset < 0) return;
+    activeArea_ = hit.area;
+    nibble_ = hit.area == Area::Hex ? hit.nibble : 0;
+    moveCursor(hit.offset, event->modifiers().testFlag(Qt::ShiftModifier));
+}
+
+void HexView::mouseMoveEvent(QMouseEvent *event) {
+    if (!event->buttons().testFlag(Qt::LeftButton)) return;
+    const QPoint pos = event->position().toPoint();
+    // dragging past the edges scrolls
+    if (pos.y() < lineH_) setTopRow(topRow_ - 1);
+    else if (pos.y() > viewport()->height()) setTopRow(topRow_ + 1);
+    const Hit hit = hitTest(pos);
+    if (hit.offset < 0) return;
+    nibble_ = 0;
+    moveCursor(hit.offset, true);
+}
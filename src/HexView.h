@@ -1,40 +1,140 @@
 #pragma once
 
-#include <QAbstractTableModel>
+#include <QAbstractScrollArea>
 #include <QByteArray>
-#include <QSet>
+#include <QPixmap>
+#include <QPointer>
 
-class HexView : public QAbstractTableModel {
+#include "DirtyRanges.h"
+
+class BufferDocument;
+
+// Hex viewer/editor for the buffer.
+//
+// Only the visible rows are ever touched: each paint reads them from the
+// buffer in one go and blits every byte from a pre-rendered glyph atlas.
+// Offsets and rows are 64-bit; when the row count outgrows the int range of
+// the scroll bar, the bar is scaled and the exact top row is kept here.
+// Buffer edits arrive as range notifications from the document; the cursor
+// and dirty marks follow inserts, removes and moves.
+class HexView : public QAbstractScrollArea {
     Q_OBJECT
 public:
-    explicit HexView(QObject *parent = nullptr);
+    explicit HexView(QWidget *parent = nullptr);
 
-    void setBufferRef(QByteArray *buffer);
+    // Show and edit this document (not owned)
+    void setDocument(BufferDocument *doc);
     void clear();
 
     void setBytesPerRow(int n);
     int  getBytesPerRow() const { return bytesPerRow_; }
 
     void setSwapAscii16(bool on);
+    // Typing no longer edits the document
+    void setReadOnly(bool on) { readOnly_ = on; }
 
-    // QAbstractTableModel
-    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
-    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
-    QVariant headerData(int section, Qt::Orientation o, int role) const override;
-    QVariant data(const QModelIndex &idx, int role) const override;
-    Qt::ItemFlags flags(const QModelIndex &idx) const override;
-    bool setData(const QModelIndex &idx, const QVariant &val, int role) override;
+    // Put the cursor on offset and scroll it into view
+    void scrollToOffset(qint64 offset, bool center = true);
+    qint64 cursorOffset() const { return cursor_; }
+    // First byte of the top row; scrolling alone leaves the cursor alone
+    qint64 topOffset() const { return topRow_ * bytesPerRow_; }
+    void   scrollToTopOffset(qint64 offset);
+    // Selected range, or the cursor byte when nothing is selected
+    qint64 selectionStart() const;
+    qint64 selectionLength() const;
 
     // dirty tracking
     void clearDirty();
     bool isDirty(qint64 off) const;
-    int  dirtyCount() const;
+    qint64 dirtyCount() const;
+    const DirtyRanges &dirtyRanges() const { return dirty_; }
+    // Move the cursor to the next/previous edited byte; false if there is none
+    bool gotoNextDirty();
+    bool gotoPreviousDirty();
+
+    // Compare results: marked in red, follow inserts, removes and moves like
+    // the dirty marks, and are dropped when the buffer is reset
+    void setMismatches(const DirtyRanges &ranges);
+    void clearMismatches();
+    const DirtyRanges &mismatches() const { return mismatches_; }
+    // Move the cursor to the start of the next/previous differing range
+    bool gotoNextMismatch();
+    bool gotoPreviousMismatch();
+
+signals:
+    void byteEdited(qint64 offset);
+    void cursorMoved(qint64 offset);
+    void scrolled(qint64 topOffset);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void changeEvent(QEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
 
 private:
-    static bool isPrintable(uint8_t b);
+    enum class Area { None, Hex, Ascii };
+    struct Hit {
+        qint64 offset{-1};
+        int    nibble{};
+        Area   area{Area::None};
+    };
+
+    void onReset();
+    void onInserted(qint64 pos, qint64 length);
+    void onRemoved(qint64 pos, qint64 length);
+    void onMoved(qint64 from, qint64 length, qint64 to);
+    void refresh();
+    void invalidateRange(qint64 offset, qint64 length);
 
-    QByteArray *buffer_{};    // not owned
+    qint64 bufferSize() const;
+    qint64 totalRows() const;
+    int    visibleRows() const;    // rows that fit completely
+    qint64 maxTopRow() const;
+
+    void updateMetrics();
+    void rebuildAtlas();
+    void updateScrollBars();
+    void setTopRow(qint64 row);
+    void ensureCursorVisible();
+    void moveCursor(qint64 offset, bool extendSelection);
+    bool editNibble(int digit);
+    void copySelection();
+
+    int  byteX(int column) const;  // left edge of a hex cell
+    int  asciiX() const;
+    int  contentWidth() const;
+    Hit  hitTest(const QPoint &pos) const;
+    bool inSelection(qint64 off) const;
+
+    QPointer<BufferDocument> doc_;
     int         bytesPerRow_{16};
     bool        swapAscii16_{false};
-    QSet<qint64> dirty_;
+    bool        readOnly_{false};
+    DirtyRanges dirty_;
+    DirtyRanges mismatches_;
+
+    // Position
+    qint64 topRow_{};
+    qint64 scrollScale_{1};  // rows per scroll bar step
+    int    wheelRemainder_{};
+    qint64 cursor_{};
+    qint64 anchor_{};
+    int    nibble_{};        // 0 = high nibble, 1 = low nibble
+    Area   activeArea_{Area::Hex};
+
+    // Layout, in pixels
+    int charW_{8};
+    int lineH_{16};
+    int ascent_{12};
+    int addrDigits_{8};
+
+    // Glyphs: 256 hex pairs and 256 ASCII cells, each in normal and selected colour
+    QPixmap atlas_;
+    qreal   atlasDpr_{};
+    QByteArray rowScratch_;
 };
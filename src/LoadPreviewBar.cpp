@@ -1,8 +1,13 @@
 #include "LoadPreviewBar.h"
+#include "DirtyRanges.h"
+#include "SegmentIndex.h"
 
+#include <QMouseEvent>
 #include <QPainter>
 #include <QPalette>
+#include <QVector>
 #include <algorithm>
+#include <cmath>
 #include <cstdlib>
 #include <limits>
 #include <utility>
@@ -19,11 +24,26 @@ void LoadPreviewBar::setParams(qulonglong bufSize, qulonglong off, qulonglong da
     update();
 }
 
-void LoadPreviewBar::setBufferSegments(QVector<QPair<qulonglong, qulonglong>> segments) {
-    bufferSegments_ = std::move(segments);
+void LoadPreviewBar::setSegmentIndex(const SegmentIndex *segments) {
+    segments_ = segments;
     update();
 }
 
+void LoadPreviewBar::setMismatches(const DirtyRanges *mismatches) {
+    mismatches_ = mismatches;
+    update();
+}
+
+void LoadPreviewBar::mousePressEvent(QMouseEvent *event) {
+    const qulonglong total = std::max(bufSize_, off_ + dataLen_ + padLen_);
+    if (event->button() != Qt::LeftButton || total == 0 || width() <= 2) {
+        QWidget::mousePressEvent(event);
+        return;
+    }
+    const double frac = std::clamp((event->position().x() - 1) / double(width() - 2), 0.0, 1.0);
+    emit addressClicked(std::min(total - 1, qulonglong(frac * double(total))));
+}
+
 QSize LoadPreviewBar::sizeHint() const {
     return QSize(420, 120);
 }
@@ -143,20 +163,42 @@ void LoadPreviewBar::paintEvent(QPaintEvent *event) {
         p.fillRect(x0, y, qMax(1, x1-x0), barH, paddingColor);
     }
 
-    // Existing buffer segments markers (thin vertical lines at each start, except first)
-    if (bufferSegments_.size() > 1) {
+    // Existing buffer segments markers (thin vertical lines at each start, except first).
+    // One index lookup per marked pixel column, however many segments there are.
+    if (segments_ && segments_->count() > 1 && W > 2) {
         const int lineTop = y + 1;
         const int lineBottom = y + barH - 2;
         QColor markerColor = frameColor;
         markerColor.setAlpha(180);
         QPen segmentPen(markerColor, 1);
         p.setPen(segmentPen);
-        for (int i = 1; i < bufferSegments_.size(); ++i) {
-            const auto &segment = bufferSegments_.at(i);
-            qulonglong segStart = segment.first;
-            if (segStart >= total) continue;
-            int x = xFor(segStart);
+        const int rows = segments_->count();
+        int row = 1;
+        while (row < rows) {
+            const qulonglong segStart = segments_->at(row).start;
+            if (segStart >= total) break;
+            const int x = xFor(segStart);
             p.drawLine(x, lineTop, x, lineBottom);
+            // first address that lands on the next pixel column
+            const qulonglong nextAddr = qulonglong(std::ceil(double(x) * double(total) / double(W - 2)));
+            row = std::max(row + 1, segments_->firstStartingAt(nextAddr));
+        }
+        p.setPen(frameColor);
+    }
+
+    // Differences, one mark per pixel column that has any
+    bool hasMismatch = false;
+    if (mismatches_ && !mismatches_->isEmpty() && W > 2) {
+        p.setPen(QPen(overlapColor, 1));
+        qulonglong addr = 0;
+        while (addr < total) {
+            const qint64 off = mismatches_->nextFrom(qint64(addr));
+            if (off < 0 || qulonglong(off) >= total) break;
+            const int x = xFor(qulonglong(off));
+            p.drawLine(x, y + 1, x, y + barH - 1);
+            hasMismatch = true;
+            const qulonglong nextAddr = qulonglong(std::ceil(double(x) * double(total) / double(W - 2)));
+            addr = std::max(qulonglong(off) + 1, nextAddr);
         }
         p.setPen(frameColor);
     }
@@ -326,6 +368,7 @@ void LoadPreviewBar::paintEvent(QPaintEvent *event) {
     const QString dataLabel = tr("data");
     const QString paddingLabel = tr("padding");
     const QString overlapLabel = tr("overlap");
+    const QString mismatchLabel = tr("differs");
     const bool hasBufferSegment = bufSize_ > 0;
     bool hasDataSegment = false;
     if (dataLen_ > 0) {
@@ -345,6 +388,7 @@ void LoadPreviewBar::paintEvent(QPaintEvent *event) {
     if (hasDataSegment) activeFields << dataLabel;
     if (hasPaddingSegment) activeFields << paddingLabel;
     if (hasOverlap) activeFields << overlapLabel;
+    if (hasMismatch) activeFields << mismatchLabel;
 
     QFont legendBold = legendFont;
     legendBold.setBold(true);
@@ -380,6 +424,6 @@ void LoadPreviewBar::paintEvent(QPaintEvent *event) {
         if (label == bufferLabel) legend(bufferColor, label, lx);
         else if (label == dataLabel) legend(dataColor, label, lx);
         else if (label == paddingLabel) legend(paddingColor, label, lx);
-        else if (label == overlapLabel) legend(overlapColor, label, lx);
+        else if (label == overlapLabel || label == mismatchLabel) legend(overlapColor, label, lx);
     }
 }
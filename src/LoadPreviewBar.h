@@ -1,25 +1,35 @@
 #pragma once
 
-#include <QPair>
-#include <QVector>
 #include <QWidget>
 
+class DirtyRanges;
+class SegmentIndex;
+
 // Visualizes how a file will be merged into the current buffer.
 class LoadPreviewBar : public QWidget {
+    Q_OBJECT
 public:
     explicit LoadPreviewBar(QWidget *parent = nullptr);
 
     void setParams(qulonglong bufSize, qulonglong off, qulonglong dataLen, qulonglong padLen);
-    void setBufferSegments(QVector<QPair<qulonglong, qulonglong>> segments);
+    // Segment starts are drawn as markers, read from the index (not owned)
+    void setSegmentIndex(const SegmentIndex *segments);
+    // Compare differences are drawn as red marks (not owned)
+    void setMismatches(const DirtyRanges *mismatches);
+
+signals:
+    void addressClicked(qulonglong address);
 
 protected:
     QSize sizeHint() const override;
     void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
 
 private:
     qulonglong bufSize_{};
     qulonglong off_{};
     qulonglong dataLen_{};
     qulonglong padLen_{};
-    QVector<QPair<qulonglong, qulonglong>> bufferSegments_;
+    const SegmentIndex *segments_{};
+    const DirtyRanges  *mismatches_{};
 };
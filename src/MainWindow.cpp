@@ -27,14 +27,25 @@
 #include <QPainter>
 #include "SegmentView.h"
 #include "SegmentTableView.h"
+#include "BatchWindow.h"
+#include "ChecksumWindow.h"
+#include "BufferCompare.h"
+#include "HexDiffWindow.h"
+#include "GangWindow.h"
+#include "SizeParse.h"
+#include "AutomationService.h"
+#include "RecordImport.h"
+#include "RecordExport.h"
 #include <QVector>
 #include <QTimer>
-#include <QSortFilterProxyModel>
+#include <QStringListModel>
 #include <QCompleter>
 #include <QProgressBar>
 #include <QStyleFactory>
 #include <QFileInfo>
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QSaveFile>
 #include <QMenuBar>
 #include <QMessageBox>
 #include <QFontDatabase>
@@ -99,6 +110,46 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     connect(actQuit, &QAction::triggered, qApp, &QCoreApplication::quit);
     menuApp->addAction(actQuit);
 
+    // Production runs
+    auto *menuProd = mb->addMenu(tr("&Production"));
+    actGang = new QAction(tr("&Gang programming…"), this);
+    connect(actGang, &QAction::triggered, this, &MainWindow::openGangWindow);
+    menuProd->addAction(actGang);
+    actBatch = new QAction(tr("&Batch programming…"), this);
+    connect(actBatch, &QAction::triggered, this, &MainWindow::openBatchWindow);
+    menuProd->addAction(actBatch);
+
+    // Buffer tools
+    auto *menuBuffer = mb->addMenu(tr("&Buffer"));
+    auto *actChecksums = new QAction(tr("&Checksums…"), this);
+    connect(actChecksums, &QAction::triggered, this, &MainWindow::openChecksumWindow);
+    menuBuffer->addAction(actChecksums);
+    menuBuffer->addSeparator();
+    auto *actCompareFile = new QAction(tr("Compare with &file…"), this);
+    connect(actCompareFile, &QAction::triggered, this, &MainWindow::compareWithFile);
+    menuBuffer->addAction(actCompareFile);
+    auto *actCompareChip = new QAction(tr("Compare with c&hip"), this);
+    connect(actCompareChip, &QAction::triggered, this, &MainWindow::compareWithChip);
+    menuBuffer->addAction(actCompareChip);
+    auto *actNextDiff = new QAction(tr("&Next difference"), this);
+    actNextDiff->setShortcut(QKeySequence(Qt::Key_F3));
+    connect(actNextDiff, &QAction::triggered, this, [this]{ if (hexView) hexView->gotoNextMismatch(); });
+    menuBuffer->addAction(actNextDiff);
+    auto *actPrevDiff = new QAction(tr("&Previous difference"), this);
+    actPrevDiff->setShortcut(QKeySequence(Qt::SHIFT | Qt::Key_F3));
+    connect(actPrevDiff, &QAction::triggered, this, [this]{ if (hexView) hexView->gotoPreviousMismatch(); });
+    menuBuffer->addAction(actPrevDiff);
+    auto *actClearDiff = new QAction(tr("C&lear differences"), this);
+    connect(actClearDiff, &QAction::triggered, this, &MainWindow::clearCompare);
+    menuBuffer->addAction(actClearDiff);
+    menuBuffer->addSeparator();
+    auto *actDiffFile = new QAction(tr("&Side-by-side diff with file…"), this);
+    connect(actDiffFile, &QAction::triggered, this, &MainWindow::diffWithFile);
+    menuBuffer->addAction(actDiffFile);
+    auto *actDiffFiles = new QAction(tr("Side-by-side diff of &two files…"), this);
+    connect(actDiffFiles, &QAction::triggered, this, &MainWindow::diffTwoFiles);
+    menuBuffer->addAction(actDiffFiles);
+
     // Left column
     auto *leftBox = new QWidget(central);
     auto *leftLayout = new QVBoxLayout(leftBox);
@@ -144,14 +195,10 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     comboDevice->setFocusPolicy(Qt::StrongFocus);
     comboDevice->lineEdit()->setClearButtonEnabled(true);
 
-    // Use a filter proxy model to filter the device list
-    auto *filter_model = new QSortFilterProxyModel(comboDevice);
-    filter_model->setFilterCaseSensitivity(Qt::CaseInsensitive);
-    filter_model->setSourceModel(comboDevice->model());
-
-    // Set the filtered model as the view for the combobox
+    // Completer shows ranked matches from deviceSearch_,
     // this allows typing to filter the dropdown list
-    auto *completer = new QCompleter(filter_model, comboDevice);
+    deviceMatches_ = new QStringListModel(comboDevice);
+    auto *completer = new QCompleter(deviceMatches_, comboDevice);
     completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
     comboDevice->setCompleter(completer);
 
@@ -175,11 +222,8 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     // fetch only on user action. Avoid fetching on every text change
     // to avoid spamming processes when user is in the middle of typing to filter
     connect(completer, qOverload<const QString&>(&QCompleter::activated), this, [this](const QString &text){
-        // Find exact item index (case-insensitive)
-        int idx = -1;
-        for (int i = 0; i < comboDevice->count(); ++i) {
-            if (comboDevice->itemText(i).compare(text, Qt::CaseInsensitive) == 0) { idx = i; break; }
-        }
+        // Exact item index (case-insensitive); combo rows follow the index
+        const int idx = deviceSearch_.indexOf(text);
         if (idx < 0 || !proc) return;
 
         comboDevice->setCurrentIndex(idx);   // reflect selection in the UI
@@ -195,9 +239,13 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     connect(comboDevice->lineEdit(),
       &QLineEdit::textEdited,
       this,
-      [this, filter_model](const QString &text) {
-        if (text.size() > 1 && filter_model) {
-            filter_model->setFilterFixedString(text);
+      [this](const QString &text) {
+        if (text.size() > 1) {
+            QStringList shown;
+            for (int row : deviceSearch_.search(text)) shown << deviceSearch_.name(row);
+            deviceMatches_->setStringList(shown);
+        } else if (deviceMatches_->rowCount() != deviceSearch_.count()) {
+            showAllDevices();
         }
       }
     );
@@ -296,11 +344,16 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     btnBlankCheck  = new QPushButton("Blank check",  groupDevOps);
     btnEraseDevice = new QPushButton("Erase device", groupDevOps);
     btnTestLogic   = new QPushButton("Test logic",   groupDevOps);
+    btnCancel      = new QPushButton("Cancel",       groupDevOps);
+    btnProgram     = new QPushButton("Erase, blank check, write && verify", groupDevOps);
+    btnCancel->setEnabled(false);
 
     // Layout: two columns, then one full-width
     gridDO->addWidget(btnBlankCheck,  0, 0);
     gridDO->addWidget(btnEraseDevice, 0, 1);
-    gridDO->addWidget(btnTestLogic,   1, 0, 1, 2);
+    gridDO->addWidget(btnTestLogic,   1, 0);
+    gridDO->addWidget(btnCancel,      1, 1);
+    gridDO->addWidget(btnProgram,     2, 0, 1, 2);
 
     groupDevOps->setLayout(gridDO);
     leftLayout->addWidget(groupDevOps);
@@ -312,12 +365,17 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     chkIgnoreId      = new QCheckBox("Ignore ID error", groupOpts);
     chkSkipId        = new QCheckBox("Skip ID check", groupOpts);
     chkNoSizeErr     = new QCheckBox("Ignore size error", groupOpts);
+    chkPipeData      = new QCheckBox("Stream via pipe", groupOpts);
+    chkPipeData->setToolTip(tr("Stream chip reads and writes through minipro's stdout/stdin "
+                               "instead of a temp file"));
+    chkPipeData->setChecked(true);
 
     // layout options (2 columns)
     gridO->addWidget(chkSkipVerify,    0,0);
     gridO->addWidget(chkIgnoreId,      0,1);
     gridO->addWidget(chkSkipId,        1,0);
     gridO->addWidget(chkNoSizeErr,     1,1);
+    gridO->addWidget(chkPipeData,      2,0);
 
     groupOpts->setLayout(gridO);
     leftLayout->addWidget(groupOpts);
@@ -325,12 +383,14 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
 
     // right side (hex + legend + log)
     auto *rightSplitter = new QSplitter(Qt::Vertical, central);
-    tableHex = new QTableView(rightSplitter);
+    hexView = new HexView(rightSplitter);
 
     // Buffer legend table
     legendTable = new SegmentTableView(rightSplitter);
     legendTable->setObjectName("bufferLegendTable");
     segmentModel = new SegmentView(legendTable);
+    segmentModel->setIndex(&bufferSegments);
+    segmentModel->setDocument(&buffer_);
     legendTable->setModel(segmentModel);
     legendTable->horizontalHeader()->setStretchLastSection(true);
     legendTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
@@ -347,6 +407,9 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     legendTable->viewport()->setAcceptDrops(true);
     legendTable->setFocusPolicy(Qt::StrongFocus);
     legendTable->verticalHeader()->setVisible(false);
+    // Single-line rows; a fixed height avoids measuring every row on each update
+    legendTable->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    legendTable->verticalHeader()->setDefaultSectionSize(legendTable->fontMetrics().height() + 8);
     legendTable->setAlternatingRowColors(true);
     legendTable->setMinimumHeight(152);
     legendTable->setContextMenuPolicy(Qt::CustomContextMenu);
@@ -359,6 +422,32 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     connect(legendTable, &SegmentTableView::customContextMenuRequested,
             this, &MainWindow::onLegendContextMenuRequested);
 
+    // Compare results: where the differences are, with navigation
+    compareBar_ = new QWidget(rightSplitter);
+    auto *gridCmp = new QGridLayout(compareBar_);
+    gridCmp->setContentsMargins(0, 0, 0, 0);
+    comparePreview_ = new LoadPreviewBar(compareBar_);
+    comparePreview_->setSegmentIndex(&bufferSegments);
+    comparePreview_->setMismatches(&hexView->mismatches());
+    comparePreview_->setToolTip(tr("Click to jump there"));
+    compareSummary_ = new QLabel(compareBar_);
+    auto *btnPrevDiff  = new QPushButton(tr("Previous"), compareBar_);
+    auto *btnNextDiff  = new QPushButton(tr("Next"), compareBar_);
+    auto *btnClearDiff = new QPushButton(tr("Clear"), compareBar_);
+    gridCmp->addWidget(comparePreview_, 0, 0, 1, 4);
+    gridCmp->addWidget(compareSummary_, 1, 0);
+    gridCmp->addWidget(btnPrevDiff,     1, 1);
+    gridCmp->addWidget(btnNextDiff,     1, 2);
+    gridCmp->addWidget(btnClearDiff,    1, 3);
+    gridCmp->setColumnStretch(0, 1);
+    compareBar_->hide();
+    connect(btnPrevDiff, &QPushButton::clicked, hexView, &HexView::gotoPreviousMismatch);
+    connect(btnNextDiff, &QPushButton::clicked, hexView, &HexView::gotoNextMismatch);
+    connect(btnClearDiff, &QPushButton::clicked, this, &MainWindow::clearCompare);
+    connect(comparePreview_, &LoadPreviewBar::addressClicked, this, [this](qulonglong address){
+        hexView->scrollToOffset(qint64(address));
+    });
+
     log = new QPlainTextEdit(rightSplitter);
     log->installEventFilter(this);
     log->setAttribute(Qt::WA_StaticContents, true);
@@ -369,41 +458,27 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
 
     applyLogFontForDevice();
 
-    rightSplitter->addWidget(tableHex);
+    rightSplitter->addWidget(hexView);
+    rightSplitter->addWidget(compareBar_);
     rightSplitter->addWidget(legendTable);
     rightSplitter->addWidget(log);
     rightSplitter->setStretchFactor(0, 5);
-    rightSplitter->setStretchFactor(1, 1);
-    rightSplitter->setStretchFactor(2, 3);
-
-    // Hex view/model
-    hexModel = new HexView(this);
-    hexModel->setBufferRef(&buffer_);
-    tableHex->setModel(hexModel);
+    rightSplitter->setStretchFactor(1, 0);
+    rightSplitter->setStretchFactor(2, 1);
+    rightSplitter->setStretchFactor(3, 3);
+
+    // Hex view
+    hexView->setDocument(&buffer_);
+    // The hex view moves its difference marks first, then the overview follows
+    connect(&buffer_, &BufferDocument::reset, this, [this]{ compareBar_->hide(); });
+    connect(&buffer_, &BufferDocument::bytesInserted, this, &MainWindow::updateCompareBar);
+    connect(&buffer_, &BufferDocument::bytesRemoved, this, &MainWindow::updateCompareBar);
+    connect(&buffer_, &BufferDocument::bytesMoved, this, &MainWindow::updateCompareBar);
     QFont mono;
     mono.setFamily("Courier New");
     mono.setStyleHint(QFont::TypeWriter);
     mono.setPointSizeF(this->font().pointSizeF() - 1);
-    tableHex->setFont(mono);
-    tableHex->setWordWrap(false);
-    tableHex->setAlternatingRowColors(true);
-    tableHex->setSelectionBehavior(QAbstractItemView::SelectItems);
-    tableHex->verticalHeader()->setDefaultSectionSize(20);
-
-    // Hexviewer header sizing
-    auto *hh = tableHex->horizontalHeader();
-    hh->setSectionResizeMode(QHeaderView::Fixed);
-    hh->setStretchLastSection(true);
-
-    // address column (0) to contents
-    hh->setSectionResizeMode(0, QHeaderView::ResizeToContents);
-
-    // set a compact width for all hex byte columns (1..bytesPerRow)
-    for (int c = 1; c <= hexModel->getBytesPerRow(); ++c) tableHex->setColumnWidth(c, 28);
-    tableHex->setAlternatingRowColors(true);
-    tableHex->verticalHeader()->setDefaultSectionSize(20);
-    // ASCII column
-    tableHex->horizontalHeader()->setStretchLastSection(true);
+    hexView->setFont(mono);
 
     auto *split = new QSplitter(Qt::Horizontal, central);
     split->addWidget(leftBox);
@@ -416,10 +491,10 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
 
     // button wiring
     connect(btnClear, &QPushButton::clicked, this, [this]{
+        if (bufferBusy()) return;
         buffer_.clear();
         bufferSegments.clear();
         updateLegendTable();
-        if (hexModel) hexModel->setBufferRef(&buffer_);
         if (lblBufSize)  lblBufSize->setText("Size: 0 (0x0)");
         updateActionEnabling();
     });
@@ -432,13 +507,23 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
         this, [this](const QString&){ updateActionEnabling(); });
 
     // Process wiring
-    proc = new ProcessHandling(this);
-    connect(proc, &ProcessHandling::logLine,
-            log, &QPlainTextEdit::appendPlainText);
+    // minipro runs and its output is parsed on a worker thread; we only
+    // get finished results here
+    proc = new ProcessHandling;
+    proc->moveToThread(&procThread_);
+    connect(&procThread_, &QThread::finished, proc, &QObject::deleteLater);
+    procThread_.setObjectName("minipro");
+    procThread_.start();
     // Display error lines in red
-    connect(proc, &ProcessHandling::errorLine, this, [this](const QString &line){
+    connect(proc, &ProcessHandling::output, this,
+            [this](quint64, const QList<ProcessHandling::OutputLine> &lines){
         if (!log) return;
-        log->appendHtml("<font color='red'>" + line + "</font>");
+        for (const auto &line : lines) {
+            if (line.kind == ProcessHandling::OutputLine::Error)
+                log->appendHtml("<font color='red'>" + line.text + "</font>");
+            else
+                log->appendPlainText(line.text);
+        }
     });
     connect(proc, &ProcessHandling::devicesScanned, this, [this](const QStringList &names){
         if (!log) return;
@@ -449,7 +534,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
 
     // ASCII byteswap toggle
     connect(chkAsciiSwap, &QCheckBox::toggled, this, [this](bool on){
-        if (hexModel) hexModel->setSwapAscii16(on);
+        if (hexView) hexView->setSwapAscii16(on);
     });
 
     // Trigger a device rescan
@@ -459,14 +544,18 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
         comboProgrammer->setPlaceholderText("No programmer");
         comboProgrammer->setEnabled(false);
         comboDevice->clear();
+        deviceSearch_.clear();
+        showAllDevices();
         comboDevice->setPlaceholderText("No devices");
         comboDevice->setEnabled(false);
         proc->scanConnectedDevices();
     });
 
-    // Kick off one initial scan on startup (after the window is up)
-    QTimer::singleShot(100, this, [this]{
-        if (proc) proc->scanConnectedDevices();
+    // Kick off one initial scan on startup (after the window is up). The
+    // last known programmers and devices come from the cache right away,
+    // the scan itself only reports if something changed.
+    QTimer::singleShot(0, this, [this]{
+        if (proc) proc->scanConnectedDevices(true);
     });
 
     // When a scan completes, we already populate programmers:
@@ -483,6 +572,8 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
                 if (index == -1) return;
                 const QString p = comboProgrammer->itemText(index).trimmed();
                 comboDevice->clear();
+                deviceSearch_.clear();
+                showAllDevices();
                 comboDevice->setPlaceholderText("");
                 comboDevice->setEnabled(false);
                 proc->fetchSupportedDevices(p);
@@ -498,7 +589,22 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
         const QString p = comboProgrammer->currentText().trimmed();
         const QString d = comboDevice->currentText().trimmed();
         if (p.isEmpty() || d.isEmpty()) return;
-        proc->readChipImage(p, d, optionFlags());
+        if (chkPipeData && chkPipeData->isChecked()) {
+            if (compareRead_ || streamReadStart_ >= 0) {
+                if (log) log->appendPlainText("[Error] a chip read is already running");
+                return;
+            }
+            // Appended to the end of the buffer as it arrives; the buffer
+            // stays locked until it ends so that start keeps pointing at it
+            streamReadStart_ = buffer_.size();
+            streamReadLabel_ = d;
+            if (hexView) hexView->setReadOnly(true);
+            if (segmentModel) segmentModel->setReorderEnabled(false);
+            if (automation_) automation_->setBufferLocked(true);
+            readJob_ = proc->readChipImageStreamed(p, d, optionFlags());
+        } else {
+            proc->readChipImage(p, d, optionFlags());
+        }
     });
 
     // Write to target
@@ -511,7 +617,12 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
             if (log) log->appendPlainText("[Error] buffer is empty");
             return;
         }
-        // Export buffer to a temp file
+        // Feed the buffer over stdin, no temp file involved
+        if (chkPipeData && chkPipeData->isChecked()) {
+            proc->writeChipImageStreamed(p, d, buffer_.engine(), optionFlags());
+            return;
+        }
+        // Fallback: export buffer to a temp file
         QString tempPath = exportBufferToTempFileLocal("fmp-write");
         if (tempPath.isEmpty()) {
             if (log) log->appendPlainText("[Error] failed to create temp file for writing");
@@ -519,7 +630,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
         }
         pendingWriteTempPath_ = tempPath;
         // Write to target
-        proc->writeChipImage(p, d, tempPath, optionFlags());
+        pendingWriteJob_ = proc->writeChipImage(p, d, tempPath, optionFlags());
     });
 
     // Read from target is ready
@@ -528,9 +639,67 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
         loadAtOffsetDialog(tempPath, true);
     });
 
+    // Streamed read: grow the buffer and the hex view as data comes in
+    connect(proc, &ProcessHandling::readChunk, this, [this](quint64 job, const QByteArray &data){
+        if (job != readJob_) return;  // a D-Bus read going to a file
+        if (compareRead_) {
+            compareImage_.append(data);
+            return;
+        }
+        if (streamReadStart_ < 0) return;
+        buffer_.append(data);
+        if (lblBufSize) {
+            lblBufSize->setText(QString("Size: %1 (0x%2)")
+                                .arg(QLocale().toString(buffer_.size()))
+                                .arg(QString::number(qulonglong(buffer_.size()), 16).toUpper()));
+        }
+    });
+
+    // Streamed read is over: keep it as a segment, or drop the partial image
+    connect(proc, &ProcessHandling::readStreamFinished, this, [this](quint64 job, bool ok, qint64 /*bytes*/){
+        if (job != readJob_) return;
+        readJob_ = 0;
+        if (compareRead_) {
+            compareRead_ = false;
+            if (ok) showComparison(compareImage_, compareLabel_);
+            else if (log) log->appendPlainText("[Compare] Read failed, nothing compared");
+            compareImage_ = BufferEngine();
+            return;
+        }
+        const qint64 start = streamReadStart_;
+        streamReadStart_ = -1;
+        if (start < 0) return;
+        if (hexView) hexView->setReadOnly(false);
+        if (segmentModel) segmentModel->setReorderEnabled(true);
+        if (automation_) automation_->setBufferLocked(false);
+        const qint64 got = buffer_.size() - start;
+        if (!ok) {
+            if (got > 0) {
+                buffer_.remove(start, got);
+                if (log) log->appendPlainText(QString("[Read] Discarded %1 bytes of incomplete read")
+                                              .arg(QLocale().toString(got)));
+            }
+        } else if (got <= 0) {
+            if (log) log->appendPlainText("[Warn] Read returned no data");
+        } else {
+            addSegmentAndRefresh(qulonglong(start), qulonglong(got), streamReadLabel_);
+            if (log) {
+                log->appendPlainText(QString("[Loaded] %1 bytes at 0x%2 from %3")
+                                     .arg(QLocale().toString(got))
+                                     .arg(QString::number(start, 16).toUpper())
+                                     .arg(streamReadLabel_));
+            }
+        }
+        if (lblBufSize) {
+            lblBufSize->setText(QString("Size: %1 (0x%2)")
+                                .arg(QLocale().toString(buffer_.size()))
+                                .arg(QString::number(qulonglong(buffer_.size()), 16).toUpper()));
+        }
+    });
+
     // Update the bar as progress arrives
     connect(proc, &ProcessHandling::progress, this, 
-        [this](int pct, const QString &label) {
+        [this](quint64, int pct, const QString &label) {
         if (progReadWrite) {
             if (!progReadWrite->isVisible()) progReadWrite->show();
             if (pct > 0) progReadWrite->setValue(pct);
@@ -539,27 +708,34 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     });
 
     // Disable UI buttons when minipro is running
-    connect(proc, &ProcessHandling::started, this, [this]{
+    connect(proc, &ProcessHandling::started, this, [this](quint64 job){
+        runningJob_ = job;
         disableBusyButtons();
+        if (btnCancel) btnCancel->setEnabled(true);
         QApplication::setOverrideCursor(Qt::BusyCursor);
     });
 
     // When process finishes, ensure progress bar is at 100% and shows "Idle",
     // and that the UI is re-enabled after process completion
     connect(proc, &ProcessHandling::finished, this,
-        [this](int /*exitCode*/, QProcess::ExitStatus /*status*/) {
+        [this](quint64 job, int /*exitCode*/, QProcess::ExitStatus /*status*/) {
+            if (job == pendingWriteJob_ && !pendingWriteTempPath_.isEmpty()) {
+                QFile::remove(pendingWriteTempPath_);
+                pendingWriteTempPath_.clear();
+                pendingWriteJob_ = 0;
+            }
+            // Jobs dropped from the queue end without having started
+            if (job != runningJob_) return;
+            runningJob_ = 0;
             // Always restore UI first
             updateActionEnabling();
+            if (btnCancel) btnCancel->setEnabled(false);
             QApplication::restoreOverrideCursor();
             if (progReadWrite) {
                 progReadWrite->setValue(100);
                 progReadWrite->setFormat(QStringLiteral("Idle"));
                 progReadWrite->setTextVisible(true);
             }
-            if (!pendingWriteTempPath_.isEmpty()) {
-                QFile::remove(pendingWriteTempPath_);
-                pendingWriteTempPath_.clear();
-            }
         });
 
     // Blank check button
@@ -589,11 +765,65 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
         proc->testLogicChip(p, d, optionFlags());
     });
 
+    // Whole programming cycle from the buffer in one go
+    connect(btnProgram, &QPushButton::clicked, this, [this]{
+        if (!proc) return;
+        const QString p = comboProgrammer->currentText().trimmed();
+        const QString d = comboDevice->currentText().trimmed();
+        if (p.isEmpty() || d.isEmpty()) return;
+        if (buffer_.isEmpty()) {
+            if (log) log->appendPlainText("[Error] buffer is empty");
+            return;
+        }
+        const bool verify = !(chkSkipVerify && chkSkipVerify->isChecked());
+        proc->runPipeline(p, d, ProgramPipeline::standard(verify), buffer_.engine(), optionFlags());
+    });
+
+    // Stop the running operation and anything queued behind it
+    connect(btnCancel, &QPushButton::clicked, this, [this]{
+        if (proc) proc->cancel();
+    });
+
+    // D-Bus automation; buffer edits made through it show up like our own
+    automation_ = new AutomationService(&buffer_, proc, this);
+    connect(automation_, &AutomationService::bufferLoaded, this,
+            [this](qint64 offset, qint64 length, const QString &label){
+        addSegmentAndRefresh(qulonglong(offset), qulonglong(length), label);
+        if (log) log->appendPlainText(QString("[D-Bus] Loaded %1 bytes at 0x%2 from %3")
+                                      .arg(QLocale().toString(length))
+                                      .arg(QString::number(offset, 16).toUpper())
+                                      .arg(label));
+        if (lblBufSize) {
+            lblBufSize->setText(QString("Size: %1 (0x%2)")
+                                .arg(QLocale().toString(buffer_.size()))
+                                .arg(QString::number(qulonglong(buffer_.size()), 16).toUpper()));
+        }
+        updateActionEnabling();
+    });
+    connect(automation_, &AutomationService::bufferCleared, this, [this]{
+        bufferSegments.clear();
+        updateLegendTable();
+        if (lblBufSize)  lblBufSize->setText("Size: 0 (0x0)");
+        updateActionEnabling();
+    });
+    QString busError;
+    if (automation_->registerOnSessionBus(&busError)) {
+        if (log) log->appendPlainText("[Info] D-Bus automation available as io.github.jartza.FireMinipro");
+    } else {
+        if (log) log->appendPlainText(QString("[Info] D-Bus automation not available: %1").arg(busError));
+    }
+
     // initial state
     setUiEnabled(true);
     updateActionEnabling();
 }
 
+MainWindow::~MainWindow() {
+    // proc is deleted on its own thread once the loop stops
+    procThread_.quit();
+    procThread_.wait();
+}
+
 bool MainWindow::eventFilter(QObject *obj, QEvent *e) {
     if (obj == comboDevice->lineEdit()) {
         auto *edit = comboDevice->lineEdit();
@@ -631,12 +861,14 @@ void MainWindow::setUiEnabled(bool on) {
 void MainWindow::disableBusyButtons()
 {
     for (QWidget *w : std::vector<QWidget*>{
-        btnRead, btnWrite, btnEraseDevice, btnBlankCheck, btnTestLogic,
+        btnRead, btnWrite, btnEraseDevice, btnBlankCheck, btnTestLogic, btnProgram,
         btnRescan, comboProgrammer, comboDevice, btnLoadBinary, btnLoadAdvanced,
         btnSave, btnClear
     }) {
         if (w) w->setEnabled(false);
     }
+    if (actGang)  actGang->setEnabled(false);
+    if (actBatch) actBatch->setEnabled(false);
 }
 
 void MainWindow::updateActionEnabling() {
@@ -654,6 +886,8 @@ void MainWindow::updateActionEnabling() {
     if (btnLoadAdvanced) btnLoadAdvanced->setEnabled(true);
     if (chkAsciiSwap) chkAsciiSwap->setEnabled(hasBuffer);
     if (btnSave)      btnSave->setEnabled(hasBuffer);
+    if (actGang)      actGang->setEnabled(!(proc && proc->hasChipWork()));
+    if (actBatch)     actBatch->setEnabled(!(proc && proc->hasChipWork()));
 
     // Separate logic ICs from memory devices
     if (currentIsLogic_) {
@@ -662,6 +896,7 @@ void MainWindow::updateActionEnabling() {
         if (btnBlankCheck)  btnBlankCheck->setEnabled(false);
         if (btnRead)        btnRead->setEnabled(false);
         if (btnWrite)       btnWrite->setEnabled(false);
+        if (btnProgram)     btnProgram->setEnabled(false);
         if (btnTestLogic)   btnTestLogic->setEnabled(deviceSelected);
     } else {
         // Memory device: buffer ops + blank/erase; no logic test
@@ -670,9 +905,18 @@ void MainWindow::updateActionEnabling() {
         if (btnTestLogic)   btnTestLogic->setEnabled(false);
         if (btnRead)        btnRead->setEnabled(deviceSelected);
         if (btnWrite)       btnWrite->setEnabled(deviceSelected && hasBuffer);
+        if (btnProgram)     btnProgram->setEnabled(deviceSelected && hasBuffer);
     }
 }
 
+// A streamed read owns the bytes from streamReadStart_ to the end until it
+// finishes, so edits that could move them are refused meanwhile
+bool MainWindow::bufferBusy() {
+    if (streamReadStart_ < 0) return false;
+    if (log) log->appendPlainText("[Busy] a chip read is still filling the buffer");
+    return true;
+}
+
 void MainWindow::applyLogFontForDevice() {
     if (!log) return;
     if (currentIsLogic_) {
@@ -759,32 +1003,113 @@ void MainWindow::clearChipInfo()
 
 void MainWindow::saveBufferToFile() {
     if (buffer_.isEmpty()) { log->appendPlainText("[Info] Buffer is empty"); return; }
+    const QString filters = tr("Binary (*.bin);;Intel HEX (*.hex *.ihx);;"
+                               "S-record (*.s19 *.s28 *.s37 *.srec);;Hex dump (*.txt);;All files (*)");
 #if defined(Q_OS_MACOS)
     const QString path = pickFile(tr("Save image"),
                                   QFileDialog::AcceptSave,
-                                  tr("Binary (*.bin);;All files (*)"));
+                                  filters);
 #else
     const QString path = QFileDialog::getSaveFileName(this,
         tr("Save image"), lastPath_,
-        tr("Binary (*.bin);;All files (*)"));
+        filters);
 #endif
     if (path.isEmpty()) return;
-    QFile f(path);
+
+    // The suffix picks the format, anything else is saved as raw binary
+    RecordExport::Format format;
+    if (RecordExport::formatForPath(path, &format)) {
+        saveBufferAsRecords(path, format);
+        return;
+    }
+
+    // Pieces may still be mapped from the target, so never truncate it in
+    // place: write a new file and rename it over the old one on commit
+    QSaveFile f(path);
     if (!f.open(QIODevice::WriteOnly)) {
         log->appendPlainText(QString("[Error] save: %1").arg(f.errorString()));
         return;
     }
     // Error check the write
-    if (f.write(buffer_) != buffer_.size()) {
+    if (!buffer_.writeTo(&f)) {
         log->appendPlainText("[Error] save: write failed");
-        f.close();
+        f.cancelWriting();
+        return;
+    }
+    if (!f.commit()) {
+        log->appendPlainText(QString("[Error] save: %1").arg(f.errorString()));
         return;
     }
-    f.close();
     log->appendPlainText(QString("[Saved] %1 bytes to %2").arg(buffer_.size()).arg(path));
     lastPath_ = QFileInfo(path).absolutePath();
 }
 
+void MainWindow::saveBufferAsRecords(const QString &path, RecordExport::Format format)
+{
+    const QString name = format == RecordExport::Format::IntelHex ? tr("Intel HEX")
+                       : format == RecordExport::Format::SRecord  ? tr("S-record")
+                                                                  : tr("hex dump");
+    QDialog dlg(this);
+    dlg.setWindowTitle(tr("Save as %1").arg(name));
+    auto *form = new QFormLayout(&dlg);
+    form->addRow(tr("File:"), new QLabel(QFileInfo(path).fileName(), &dlg));
+    auto *comboPer = new QComboBox(&dlg);
+    comboPer->addItems({ "16", "32", "64" });
+    comboPer->setEnabled(format != RecordExport::Format::HexDump);
+    form->addRow(tr("Bytes per record:"), comboPer);
+    auto *chkSegments = new QCheckBox(tr("Only the populated segments"), &dlg);
+    chkSegments->setToolTip(tr("Leave out the padding between loaded files"));
+    chkSegments->setEnabled(!bufferSegments.isEmpty());
+    chkSegments->setChecked(bufferSegments.count() > 1);
+    form->addRow(chkSegments);
+    auto *bb = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dlg);
+    connect(bb, &QDialogButtonBox::accepted, &dlg, &QDialog::accept);
+    connect(bb, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
+    form->addRow(bb);
+    if (dlg.exec() != QDialog::Accepted) return;
+
+    // Segments are sorted and disjoint; touching ones become one range
+    QList<QPair<qulonglong, qulonglong>> ranges;
+    if (chkSegments->isChecked()) {
+        const qulonglong size = qulonglong(buffer_.size());
+        bufferSegments.forEach([&](int, const SegmentIndex::Segment &seg) {
+            const qulonglong end = std::min(seg.end(), size);
+            if (seg.start >= end) return true;
+            if (!ranges.isEmpty() && ranges.last().second == seg.start)
+                ranges.last().second = end;
+            else
+                ranges << qMakePair(seg.start, end);
+            return true;
+        });
+    }
+
+    RecordExport::Options options;
+    options.format = format;
+    options.bytesPerRecord = comboPer->currentText().toInt();
+    options.header = QFileInfo(path).fileName();
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    QElapsedTimer timer;
+    timer.start();
+    QString error;
+    QSaveFile f(path);
+    bool ok = f.open(QIODevice::WriteOnly);
+    if (ok) ok = RecordExport::write(buffer_.engine(), ranges, options, &f, &error);
+    if (ok) ok = f.commit();
+    else f.cancelWriting();
+    QApplication::restoreOverrideCursor();
+
+    if (!ok) {
+        log->appendPlainText(QString("[Error] save: %1").arg(error.isEmpty() ? f.errorString() : error));
+        return;
+    }
+    log->appendPlainText(QString("[Saved] %1 as %2 to %3 (%4 ms)")
+                         .arg(ranges.isEmpty() ? tr("%1 bytes").arg(buffer_.size())
+                                               : tr("%n range(s)", nullptr, int(ranges.size())))
+                         .arg(name, path).arg(timer.elapsed()));
+    lastPath_ = QFileInfo(path).absolutePath();
+}
+
 // Create temp file from buffer, for writing to target
 QString MainWindow::exportBufferToTempFileLocal(const QString& baseName)
 {
@@ -804,7 +1129,7 @@ QString MainWindow::exportBufferToTempFileLocal(const QString& baseName)
         if (log) log->appendPlainText(QString("[Write] open temp failed: %1").arg(f.errorString()));
         return {};
     }
-    if (f.write(buffer_) != buffer_.size()) {
+    if (!buffer_.writeTo(&f)) {
         if (log) log->appendPlainText("[Write] write temp failed.");
         f.close();
         f.remove();
@@ -816,60 +1141,6 @@ QString MainWindow::exportBufferToTempFileLocal(const QString& baseName)
     return path;
 }
 
-
-// parse sizes like "0x1F000", "8192", "32k", "512K", "1M", "256KB", "2MB"
-bool MainWindow::parseSizeLike(const QString &in, qulonglong &out) {
-    QString s = in.trimmed();
-    if (s.isEmpty()) return false;
-
-    qulonglong mul = 1;
-    if (s.endsWith("KB", Qt::CaseInsensitive)) { mul = 1024ULL; s.chop(2); }
-    else if (s.endsWith("MB", Qt::CaseInsensitive)) { mul = 1024ULL*1024ULL; s.chop(2); }
-    else if (!s.isEmpty() && (s.back() == QLatin1Char('k') || s.back() == QLatin1Char('K'))) { mul = 1024ULL; s.chop(1); }
-    else if (!s.isEmpty() && (s.back() == QLatin1Char('m') || s.back() == QLatin1Char('M'))) { mul = 1024ULL*1024ULL; s.chop(1); }
-
-    bool ok = false;
-    qulonglong base = 0;
-    s = s.trimmed();
-    if (s.startsWith("0x", Qt::CaseInsensitive)) {
-        base = s.mid(2).toULongLong(&ok, 16);
-    } else {
-        base = s.toULongLong(&ok, 10);
-    }
-    if (!ok) return false;
-    out = base * mul;
-    return true;
-}
-
-void MainWindow::ensureBufferSize(int newSize, char padByte) {
-    if (newSize <= buffer_.size()) return;
-    const int growBy = newSize - buffer_.size();
-    buffer_.append(QByteArray(growBy, padByte));
-}
-
-void MainWindow::patchBuffer(int offset, const QByteArray &data, char padByte) {
-    if (offset < 0 || data.isEmpty()) return;
-    const int oldSize = buffer_.size();
-    const int end = offset + data.size();
-    ensureBufferSize(end, padByte);
-    const bool grew = buffer_.size() > oldSize;
-
-    std::copy(data.begin(), data.end(), buffer_.begin() + offset);
-
-    if (hexModel) {
-        if (grew) {
-            // Row count changed; reset model so the view reflects new size
-            hexModel->setBufferRef(&buffer_);
-        } else {
-            const int bpr = std::max(1, hexModel->getBytesPerRow());
-            const int firstRow = offset / bpr;
-            const int lastRow  = (end - 1) / bpr;
-            emit hexModel->dataChanged(hexModel->index(firstRow, 0),
-                                       hexModel->index(lastRow, hexModel->columnCount() - 1));
-        }
-    }
-}
-
 void MainWindow::onDevicesScanned(const QStringList &names)
 {
     // Refresh the programmer dropdown
@@ -892,6 +1163,8 @@ void MainWindow::onDevicesListed(const QStringList &names)
 {
     QSignalBlocker blocker(comboDevice);
     comboDevice->clear();
+    deviceSearch_.build(names);
+    showAllDevices();
 
     if (names.isEmpty()) {
         comboDevice->setPlaceholderText("No devices for this programmer");
@@ -900,32 +1173,357 @@ void MainWindow::onDevicesListed(const QStringList &names)
         return;
     }
 
-    QStringList sorted = names;
-    sorted.sort(Qt::CaseInsensitive);
-    comboDevice->addItems(sorted);
+    // Already sorted by ProcessHandling
+    comboDevice->addItems(names);
     comboDevice->setCurrentIndex(-1);
     comboDevice->setEnabled(true);
 
-    if (log) log->appendPlainText(QString("[Info] Loaded %1 devices.").arg(sorted.size()));
+    if (log) log->appendPlainText(QString("[Info] Loaded %1 devices.").arg(names.size()));
+}
+
+// Gang window for the selected device, writing a snapshot of the buffer
+void MainWindow::openGangWindow()
+{
+    const QString d = comboDevice->currentText().trimmed();
+    if (d.isEmpty() || comboDevice->currentIndex() < 0) {
+        if (log) log->appendPlainText("[Error] select a device first");
+        return;
+    }
+    if (buffer_.isEmpty()) {
+        if (log) log->appendPlainText("[Error] buffer is empty");
+        return;
+    }
+    // The lanes run their own minipro, the first one on our programmer
+    if (proc->hasChipWork()) {
+        if (log) log->appendPlainText("[Error] gang: the programmer is busy");
+        return;
+    }
+    QStringList programmers;
+    for (int i = 0; i < comboProgrammer->count(); ++i) programmers << comboProgrammer->itemText(i);
+    const bool verify = !(chkSkipVerify && chkSkipVerify->isChecked());
+
+    // Modal like the batch window: the main window's minipro must not race the lanes
+    auto *gang = new GangWindow(programmers, d, buffer_.engine(), optionFlags(), verify, this);
+    gang->setAttribute(Qt::WA_DeleteOnClose);
+    gang->setModal(true);
+    if (automation_) {
+        automation_->setDeviceLocked(true);
+        connect(gang, &QObject::destroyed, automation_, [a = automation_]{ a->setDeviceLocked(false); });
+    }
+    gang->show();
+}
+
+// Batch window programming chip after chip from a snapshot of the buffer
+void MainWindow::openBatchWindow()
+{
+    const QString p = comboProgrammer->currentText().trimmed();
+    const QString d = comboDevice->currentText().trimmed();
+    if (d.isEmpty() || comboDevice->currentIndex() < 0) {
+        if (log) log->appendPlainText("[Error] select a device first");
+        return;
+    }
+    if (buffer_.isEmpty()) {
+        if (log) log->appendPlainText("[Error] buffer is empty");
+        return;
+    }
+    // The batch runs its own minipro on the same programmer
+    if (proc->hasChipWork()) {
+        if (log) log->appendPlainText("[Error] batch: the programmer is busy");
+        return;
+    }
+    const bool verify = !(chkSkipVerify && chkSkipVerify->isChecked());
+
+    // Modal: the batch runs its own minipro, so the main window must stay idle
+    auto *batch = new BatchWindow(p, d, buffer_.engine(), optionFlags(), verify, this);
+    batch->setAttribute(Qt::WA_DeleteOnClose);
+    batch->setModal(true);
+    if (automation_) {
+        automation_->setDeviceLocked(true);
+        connect(batch, &QObject::destroyed, automation_, [a = automation_]{ a->setDeviceLocked(false); });
+    }
+    batch->show();
+}
+
+void MainWindow::openChecksumWindow()
+{
+    if (!checksumWindow_)
+        checksumWindow_ = new ChecksumWindow(&buffer_, &bufferSegments, segmentModel, hexView, this);
+    checksumWindow_->show();
+    checksumWindow_->raise();
+    checksumWindow_->activateWindow();
+}
+
+void MainWindow::compareWithFile()
+{
+    if (buffer_.isEmpty()) {
+        if (log) log->appendPlainText("[Error] buffer is empty");
+        return;
+    }
+    const QString path = pickFile(tr("Compare with file"), QFileDialog::AcceptOpen,
+                                  tr("All files (*);;Binary (*.bin)"));
+    if (path.isEmpty()) return;
+    QString error;
+    const BufferSource data = BufferSource::mapFile(path, &error);
+    if (!error.isEmpty()) {
+        if (log) log->appendPlainText(QString("[Error] open: %1").arg(error));
+        return;
+    }
+    BufferEngine other;
+    other.append(data);
+    showComparison(other, QFileInfo(path).fileName());
+}
+
+void MainWindow::diffWithFile()
+{
+    openDiffWindow(true);
+}
+
+void MainWindow::diffTwoFiles()
+{
+    openDiffWindow(false);
+}
+
+void MainWindow::openDiffWindow(bool againstBuffer)
+{
+    if (againstBuffer && buffer_.isEmpty()) {
+        if (log) log->appendPlainText("[Error] buffer is empty");
+        return;
+    }
+    const QString filters = tr("All files (*);;Binary (*.bin)");
+    const auto openFile = [&](const QString &title, BufferEngine *data, QString *name) {
+        const QString path = pickFile(title, QFileDialog::AcceptOpen, filters);
+        if (path.isEmpty()) return false;
+        QString error;
+        const BufferSource mapped = BufferSource::mapFile(path, &error);
+        if (!error.isEmpty()) {
+            if (log) log->appendPlainText(QString("[Error] open: %1").arg(error));
+            return false;
+        }
+        data->append(mapped);
+        *name = QFileInfo(path).fileName();
+        return true;
+    };
+
+    BufferEngine left, right;
+    QString leftName, rightName;
+    if (againstBuffer) {
+        // A snapshot of the pieces, so the diff stays put while the buffer is
+        // edited; the window flattens it off the UI thread
+        left = buffer_.engine();
+        leftName = tr("Buffer");
+    } else if (!openFile(tr("Diff: first file"), &left, &leftName)) {
+        return;
+    }
+    if (!openFile(againstBuffer ? tr("Diff with file") : tr("Diff: second file"), &right, &rightName))
+        return;
+
+    auto *diff = new HexDiffWindow(left, leftName, right, rightName, this);
+    diff->setAttribute(Qt::WA_DeleteOnClose);
+    diff->show();
+}
+
+// Read the chip into a side image, compared once the read is complete
+void MainWindow::compareWithChip()
+{
+    if (!proc) return;
+    const QString p = comboProgrammer->currentText().trimmed();
+    const QString d = comboDevice->currentText().trimmed();
+    if (p.isEmpty() || d.isEmpty()) {
+        if (log) log->appendPlainText("[Error] select a device first");
+        return;
+    }
+    if (buffer_.isEmpty()) {
+        if (log) log->appendPlainText("[Error] buffer is empty");
+        return;
+    }
+    if (compareRead_ || streamReadStart_ >= 0) {
+        if (log) log->appendPlainText("[Error] a chip read is already running");
+        return;
+    }
+    compareRead_ = true;
+    compareImage_ = BufferEngine();
+    compareLabel_ = d;
+    readJob_ = proc->readChipImageStreamed(p, d, optionFlags());
+}
+
+void MainWindow::showComparison(const BufferEngine &other, const QString &label)
+{
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    QElapsedTimer timer;
+    timer.start();
+    const BufferCompare::Result result = BufferCompare::compare(buffer_.engine(), other);
+    const qint64 ms = timer.elapsed();
+    QApplication::restoreOverrideCursor();
+
+    compareLabel_ = label;
+    hexView->setMismatches(result.mismatches);
+    compareBar_->show();
+    updateCompareBar();
+
+    if (log) {
+        const DirtyRanges &m = result.mismatches;
+        if (m.isEmpty()) {
+            log->appendPlainText(QString("[Compare] Buffer matches %1 (%2 ms)").arg(label).arg(ms));
+        } else {
+            log->appendPlainText(QString("[Compare] %1 bytes differ from %2 in %3 ranges, first at 0x%4 (%5 ms)")
+                                 .arg(QLocale().toString(m.byteCount()), label)
+                                 .arg(m.rangeCount())
+                                 .arg(QString::number(m.nextFrom(0), 16).toUpper())
+                                 .arg(ms));
+        }
+        if (result.sizeA != result.sizeB) {
+            log->appendPlainText(QString("[Compare] Sizes differ: buffer %1, %2 %3 bytes")
+                                 .arg(QLocale().toString(result.sizeA), label,
+                                      QLocale().toString(result.sizeB)));
+        }
+    }
+    if (!result.mismatches.isEmpty()) hexView->scrollToOffset(result.mismatches.nextFrom(0));
+}
+
+// Overview and counts after the buffer or the marks changed
+void MainWindow::updateCompareBar()
+{
+    if (!compareBar_ || compareBar_->isHidden()) return;
+    const DirtyRanges &m = hexView->mismatches();
+    comparePreview_->setParams(qulonglong(buffer_.size()), 0, 0, 0);
+    compareSummary_->setText(m.isEmpty()
+        ? tr("No differences from %1").arg(compareLabel_)
+        : tr("%1 bytes differ from %2 in %n range(s)", nullptr, m.rangeCount())
+              .arg(QLocale().toString(m.byteCount()), compareLabel_));
+}
+
+void MainWindow::clearCompare()
+{
+    hexView->clearMismatches();
+    compareBar_->hide();
+}
+
+// Completer back to the whole device list
+void MainWindow::showAllDevices()
+{
+    QStringList all;
+    all.reserve(deviceSearch_.count());
+    for (int i = 0; i < deviceSearch_.count(); ++i) all << deviceSearch_.name(i);
+    deviceMatches_->setStringList(all);
+}
+
+// Intel HEX / S-record: ask for an address offset and pad byte, then lay
+// the records into the buffer at their addresses. Returns false for other
+// files so that they load raw.
+bool MainWindow::importRecordFile(const QString &path, const BufferSource &file)
+{
+    static const QStringList recordSuffixes{ "hex", "ihx", "ihex", "s19", "s28", "s37", "srec", "mot" };
+    const QString name = QFileInfo(path).fileName();
+    const bool recordName = recordSuffixes.contains(QFileInfo(path).suffix().toLower());
+    if (!recordName && RecordImport::detect(file) == RecordImport::Format::Unknown) return false;
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    QElapsedTimer timer;
+    timer.start();
+    const RecordImport::Result result = RecordImport::parse(file);
+    const qint64 parseMs = timer.elapsed();
+    QApplication::restoreOverrideCursor();
+
+    if (!result.error.isEmpty()) {
+        // A binary that merely starts like a record loads raw
+        if (!recordName) return false;
+        if (log) {
+            log->appendPlainText(result.errorLine > 0
+                ? QString("[Error] %1 line %2: %3").arg(name).arg(result.errorLine).arg(result.error)
+                : QString("[Error] %1: %2").arg(name, result.error));
+        }
+        return true;
+    }
+
+    // High load addresses (flash mapped at 0x08000000 and such) are moved
+    // down to 0 by default, or the buffer would be mostly padding
+    const auto hex = [](qulonglong v) { return QString::number(v, 16).toUpper(); };
+    QDialog dlg(this);
+    dlg.setWindowTitle(tr("Load %1").arg(RecordImport::formatName(result.format)));
+    auto *form = new QFormLayout(&dlg);
+    form->addRow(tr("File:"), new QLabel(name, &dlg));
+    form->addRow(tr("Records:"), new QLabel(QLocale().toString(result.records), &dlg));
+    form->addRow(tr("Addresses:"), new QLabel(QString("0x%1 - 0x%2").arg(hex(result.lowest))
+                                              .arg(hex(result.highest - 1)), &dlg));
+    auto *editShift = new QLineEdit(result.lowest >= 0x1000000 ? "-0x" + hex(result.lowest) : "0x0", &dlg);
+    editShift->setToolTip(tr("Added to every record address, may be negative"));
+    auto *editPad = new QLineEdit("0xFF", &dlg);
+    editPad->setToolTip(tr("Fills the gaps between records"));
+    form->addRow(tr("Address offset:"), editShift);
+    form->addRow(tr("Pad byte:"), editPad);
+    auto *bb = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dlg);
+    connect(bb, &QDialogButtonBox::accepted, &dlg, &QDialog::accept);
+    connect(bb, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
+    form->addRow(bb);
+    if (dlg.exec() != QDialog::Accepted) return true;
+
+    QString shiftText = editShift->text().trimmed();
+    const bool negative = shiftText.startsWith('-');
+    if (negative) shiftText.remove(0, 1);
+    qulonglong shiftAbs = 0, pad = 0xFF;
+    if (!parseSizeLike(shiftText, shiftAbs)) {
+        if (log) log->appendPlainText("[Error] invalid address offset");
+        return true;
+    }
+    if (!parseSizeLike(editPad->text(), pad) || pad > 0xFF) {
+        if (log) log->appendPlainText("[Error] invalid pad");
+        return true;
+    }
+    const qint64 shift = negative ? -qint64(shiftAbs) : qint64(shiftAbs);
+    if (qint64(result.lowest) + shift < 0) {
+        if (log) log->appendPlainText(QString("[Error] offset moves 0x%1 below zero").arg(hex(result.lowest)));
+        return true;
+    }
+
+    RecordImport::place(buffer_, result, shift, char(pad));
+
+    // One segment per populated range, or one for the lot if it is scattered
+    const auto spans = RecordImport::spans(result);
+    if (spans.size() <= 64) {
+        for (const auto &span : spans)
+            addSegmentAndRefresh(span.first + shift, span.second - span.first, name);
+    } else {
+        addSegmentAndRefresh(result.lowest + shift, result.highest - result.lowest,
+                             tr("%1 (%2 ranges)").arg(name).arg(spans.size()));
+    }
+
+    if (log) {
+        log->appendPlainText(QString("[Loaded] %1 records in %2 ranges at 0x%3 - 0x%4 from %5 (%6 ms)")
+                             .arg(QLocale().toString(result.records))
+                             .arg(spans.size())
+                             .arg(hex(result.lowest + shift))
+                             .arg(hex(result.highest + shift - 1))
+                             .arg(name)
+                             .arg(parseMs));
+    }
+    if (lblBufSize) {
+        lblBufSize->setText(QString("Size: %1 (0x%2)")
+                            .arg(QLocale().toString(buffer_.size()))
+                            .arg(QString::number(qulonglong(buffer_.size()), 16).toUpper()));
+    }
+    updateActionEnabling();
+    return true;
 }
 
 // Load file to buffer at user-specified offset, with optional padding
 void MainWindow::loadFileAppendDialog() {
+    if (bufferBusy()) return;
     const QString path = pickFile(tr("Load binary"), QFileDialog::AcceptOpen,
-                                  tr("All files (*);;Binary (*.bin)"));
+                                  tr("All files (*);;Binary (*.bin);;Intel HEX / S-record (*.hex *.ihx *.s19 *.s28 *.s37 *.srec *.mot)"));
     if (path.isEmpty()) return;
 
-    QFile f(path);
-    if (!f.open(QIODevice::ReadOnly)) {
-        if (log) log->appendPlainText(QString("[Error] open: %1").arg(f.errorString()));
+    // Map instead of reading: pages are pulled in only when viewed or written
+    QString error;
+    const BufferSource data = BufferSource::mapFile(path, &error);
+    if (!error.isEmpty()) {
+        if (log) log->appendPlainText(QString("[Error] open: %1").arg(error));
         return;
     }
-
-    const QByteArray data = f.readAll();
     if (data.isEmpty()) {
         if (log) log->appendPlainText(tr("[Warn] File is empty: %1").arg(QFileInfo(path).fileName()));
         return;
     }
+    if (importRecordFile(path, data)) return;
 
     const qulonglong start = static_cast<qulonglong>(buffer_.size());
     buffer_.append(data);
@@ -933,7 +1531,6 @@ void MainWindow::loadFileAppendDialog() {
 
     addSegmentAndRefresh(start, len, QFileInfo(path).fileName());
 
-    if (hexModel) hexModel->setBufferRef(&buffer_);
     if (lblBufSize) {
         lblBufSize->setText(QString("Size: %1 (0x%2)")
                             .arg(QLocale().toString(buffer_.size()))
@@ -959,17 +1556,18 @@ void MainWindow::loadAtOffsetDialog(QString path, bool deleteOnFinish) {
             QFile::remove(path);
         }
     });
+    if (bufferBusy()) return;
 
     // If preset path is given, skip the file picker dialog
     if (path.isEmpty()) {
 #if defined(Q_OS_MACOS)
         path = pickFile(tr("Pick image"),
                         QFileDialog::AcceptOpen,
-                        tr("All files (*);;Binary (*.bin)"));
+                        tr("All files (*);;Binary (*.bin);;Intel HEX / S-record (*.hex *.ihx *.s19 *.s28 *.s37 *.srec *.mot)"));
 #else
         path = QFileDialog::getOpenFileName(this,
                 tr("Pick image"), lastPath_,
-                tr("All files (*);;Binary (*.bin)"));
+                tr("All files (*);;Binary (*.bin);;Intel HEX / S-record (*.hex *.ihx *.s19 *.s28 *.s37 *.srec *.mot)"));
 #endif
         if (path.isEmpty()) return;
     }
@@ -978,12 +1576,15 @@ void MainWindow::loadAtOffsetDialog(QString path, bool deleteOnFinish) {
         lastPath_ = QFileInfo(path).absolutePath();
 #endif
 
-    QFile f(path);
-    if (!f.open(QIODevice::ReadOnly)) {
-        log->appendPlainText(QString("[Error] open: %1").arg(f.errorString()));
+    // The mapping stays valid after a temp file is removed by cleanupTemp
+    QString error;
+    const BufferSource file = BufferSource::mapFile(path, &error);
+    if (!error.isEmpty()) {
+        log->appendPlainText(QString("[Error] open: %1").arg(error));
         return;
     }
-    const QByteArray file = f.readAll();
+    // Records carry their own addresses; chip dumps are always raw
+    if (!deleteOnFinish && importRecordFile(path, file)) return;
     const qulonglong fileSize = static_cast<qulonglong>(file.size());
 
     // 2) Ask for offset/length/pad now that we know the file size
@@ -1102,18 +1703,7 @@ void MainWindow::loadAtOffsetDialog(QString path, bool deleteOnFinish) {
         const bool prePadNeeded = offOk && (off > static_cast<qulonglong>(buffer_.size()));
         editPad->setEnabled(postPad > 0 || prePadNeeded);
 
-        QVector<QPair<qulonglong, qulonglong>> previewSegments;
-        if (!bufferSegments.isEmpty()) {
-            previewSegments.reserve(bufferSegments.size());
-            for (const auto &seg : std::as_const(bufferSegments)) {
-                if (seg.length == 0) continue;
-                previewSegments.append({seg.start, seg.length});
-            }
-            std::sort(previewSegments.begin(), previewSegments.end(),
-                      [](const QPair<qulonglong, qulonglong> &a,
-                         const QPair<qulonglong, qulonglong> &b) { return a.first < b.first; });
-        }
-        preview->setBufferSegments(std::move(previewSegments));
+        preview->setSegmentIndex(&bufferSegments);
         preview->setParams(static_cast<qulonglong>(buffer_.size()), offOk ? off : 0, filePart, postPad);
         okBtn->setEnabled(offOk && (effLen > 0) && padOk);
     };
@@ -1142,18 +1732,13 @@ void MainWindow::loadAtOffsetDialog(QString path, bool deleteOnFinish) {
 
     const qulonglong bufferSizeBefore = static_cast<qulonglong>(buffer_.size());
 
-    // Build a data block of effLen: file bytes then padding (if requested > file)
-    QByteArray data;
-    data.reserve(static_cast<int>(effLen));
+    // effLen bytes go in: file bytes, then padding (if requested > file)
     const qulonglong take = std::min<qulonglong>(effLen, fileSize);
-    data.append(file.left(static_cast<int>(take)));
-    if (effLen > take) data.append(QByteArray(static_cast<int>(effLen - take), char(pad & 0xFF)));
-
     const qulonglong prePadLen  = (off > bufferSizeBefore) ? (off - bufferSizeBefore) : 0;
     const qulonglong postPadLen = (effLen > take) ? (effLen - take) : 0;
 
     // Patch the buffer with PAD used also for growth between current size and offset
-    patchBuffer(static_cast<int>(off), data, char(pad & 0xFF));
+    buffer_.place(qint64(off), file, qint64(effLen), char(pad & 0xFF));
     QString displayName = QFileInfo(path).fileName();
     if (prePadLen > 0 || postPadLen > 0) {
         QStringList parts;
@@ -1181,133 +1766,72 @@ void MainWindow::loadAtOffsetDialog(QString path, bool deleteOnFinish) {
 
 void MainWindow::updateLegendTable() {
     if (!segmentModel) return;
-
-    QVector<SegmentView::Segment> rows;
-    rows.reserve(bufferSegments.size());
-    for (const auto &s : std::as_const(bufferSegments)) {
-        SegmentView::Segment seg;
-        seg.start  = s.start;
-        seg.length = s.length;
-        seg.label  = s.label;
-        seg.note   = s.note;
-        seg.id     = s.id;
-        rows.append(seg);
-    }
-
-    segmentModel->setSegments(std::move(rows));
-    if (legendTable) legendTable->resizeRowsToContents();
+    segmentModel->refresh();
 }
 
-void MainWindow::onSegmentRowReordered(int from, int to) {
-    if (from == to) return;
-    if (bufferSegments.isEmpty()) return;
-    if (from < 0 || from >= bufferSegments.size()) return;
-
-    BufferSegment moving = bufferSegments.at(from);
-    const qulonglong maxLen = (moving.start < qulonglong(buffer_.size()))
-                            ? std::min<qulonglong>(moving.length,
-                                                   qulonglong(buffer_.size()) - moving.start)
-                            : 0;
-    if (maxLen == 0) return;
+void MainWindow::onSegmentRowReordered(int /*from*/, int to, qulonglong oldStart) {
+    // The model has already moved the row and given it its new start; the
+    // bytes follow
+    if (to < 0 || to >= bufferSegments.count()) return;
+    const SegmentIndex::Segment moved = bufferSegments.at(to);
+    buffer_.move(qint64(oldStart), qint64(moved.length), qint64(moved.start));
 
-    const int segStart = static_cast<int>(moving.start);
-    const int segLen   = static_cast<int>(maxLen);
-    QByteArray segmentData = buffer_.mid(segStart, segLen);
-    if (segmentData.size() != segLen) return;
-
-    buffer_.remove(segStart, segLen);
-    bufferSegments.removeAt(from);
-    const qulonglong removedLen = maxLen;
-    for (int i = from; i < bufferSegments.size(); ++i) {
-        bufferSegments[i].start -= removedLen;
-    }
-
-    int insertIndex = std::clamp(to, 0, static_cast<int>(bufferSegments.size()));
-
-    qulonglong insertStart = (insertIndex < bufferSegments.size())
-                           ? bufferSegments[insertIndex].start
-                           : qulonglong(buffer_.size());
-
-    for (int i = insertIndex; i < bufferSegments.size(); ++i) {
-        bufferSegments[i].start += removedLen;
-    }
-
-    moving.start  = insertStart;
-    moving.length = removedLen;
-    bufferSegments.insert(insertIndex, moving);
-    buffer_.insert(static_cast<int>(insertStart), segmentData);
-
-    updateLegendTable();
-    if (legendTable) legendTable->selectRow(insertIndex);
-    if (legendTable) legendTable->scrollTo(legendTable->model()->index(insertIndex, 0));
-    if (hexModel) hexModel->setBufferRef(&buffer_);
+    if (legendTable) legendTable->selectRow(to);
+    if (legendTable) legendTable->scrollTo(legendTable->model()->index(to, 0));
 }
 
 void MainWindow::onLegendRowDoubleClicked(const QModelIndex &index) {
     if (!index.isValid()) return;
     const int row = index.row();
-    if (row < 0 || row >= bufferSegments.size()) return;
-    if (!hexModel || !tableHex) return;
+    if (row < 0 || row >= bufferSegments.count()) return;
+    if (!hexView) return;
     if (buffer_.isEmpty()) return;
 
-    const int bytesPerRow = std::max(1, hexModel->getBytesPerRow());
-    const auto &segment = bufferSegments.at(row);
-    qulonglong start = segment.start;
-    if (start >= qulonglong(buffer_.size()))
-        start = buffer_.isEmpty() ? 0 : qulonglong(buffer_.size() - 1);
-
-    const int hexRowCount = hexModel->rowCount();
-    const int hexColCount = hexModel->columnCount();
-    if (hexRowCount <= 0 || hexColCount <= 0) return;
-
-    int targetRow = static_cast<int>(start / bytesPerRow);
-    targetRow = std::clamp(targetRow, 0, hexRowCount - 1);
-    int targetColumn = static_cast<int>((start % bytesPerRow) + 1);
-    if (targetColumn >= hexColCount) targetColumn = hexColCount - 1;
-    if (targetColumn < 0) targetColumn = 0;
-
-    const QModelIndex targetIndex = hexModel->index(targetRow, targetColumn);
-    if (!targetIndex.isValid()) return;
-    tableHex->scrollTo(targetIndex, QAbstractItemView::PositionAtCenter);
+    const auto segment = bufferSegments.at(row);
+    hexView->scrollToOffset(qint64(std::min<qulonglong>(segment.start, qulonglong(buffer_.size() - 1))));
 }
 
 void MainWindow::onLegendFilesDropped(int row, const QList<QUrl> &urls) {
-    if (urls.isEmpty()) return;
+    if (urls.isEmpty() || bufferBusy()) return;
 
-    int insertIndex = std::clamp(row, 0, static_cast<int>(bufferSegments.size()));
-    qulonglong insertStart = (insertIndex < bufferSegments.size())
-                           ? bufferSegments[insertIndex].start
+    int insertIndex = std::clamp(row, 0, bufferSegments.count());
+    qulonglong insertStart = (insertIndex < bufferSegments.count())
+                           ? bufferSegments.at(insertIndex).start
                            : qulonglong(buffer_.size());
 
     for (const QUrl &url : urls) {
         if (!url.isLocalFile()) continue;
         const QString path = url.toLocalFile();
-        QFile file(path);
-        if (!file.open(QIODevice::ReadOnly)) {
+        QString error;
+        const BufferSource data = BufferSource::mapFile(path, &error);
+        if (!error.isEmpty()) {
             if (log) log->appendPlainText(tr("[Error] Failed to open dropped file: %1").arg(path));
             continue;
         }
-        QByteArray data = file.readAll();
-        file.close();
         if (data.isEmpty()) {
             if (log) log->appendPlainText(tr("[Warn] Dropped file empty: %1").arg(path));
             continue;
         }
+        // Loaded at their own addresses, not at the drop position; raw files
+        // dropped along with it go to the end
+        if (importRecordFile(path, data)) {
+            insertIndex = bufferSegments.count();
+            insertStart = qulonglong(buffer_.size());
+            continue;
+        }
 
         const qint64 len = data.size();
-        for (int i = insertIndex; i < bufferSegments.size(); ++i) {
-            bufferSegments[i].start += qulonglong(len);
-        }
+        segmentModel->shiftFrom(insertIndex, len);
 
-        buffer_.insert(static_cast<int>(insertStart), data);
+        buffer_.insert(qint64(insertStart), data);
 
-        BufferSegment seg;
+        SegmentIndex::Segment seg;
         seg.start  = insertStart;
         seg.length = qulonglong(len);
         seg.label  = QFileInfo(path).fileName();
         seg.note   = {};
-        seg.id     = nextSegmentId_++;
-        bufferSegments.insert(insertIndex, seg);
+        seg.id     = bufferSegments.allocateId();
+        segmentModel->insertSegment(insertIndex, seg);
 
         if (log) {
             log->appendPlainText(tr("[Dropped] %1 bytes at 0x%2 from %3")
@@ -1320,14 +1844,12 @@ void MainWindow::onLegendFilesDropped(int row, const QList<QUrl> &urls) {
         insertStart += qulonglong(len);
     }
 
-    updateLegendTable();
     if (legendTable && insertIndex > 0) {
         const int selectRow = insertIndex - 1;
         legendTable->selectRow(selectRow);
         legendTable->scrollTo(segmentModel->index(selectRow, 0),
                               QAbstractItemView::PositionAtCenter);
     }
-    if (hexModel) hexModel->setBufferRef(&buffer_);
     if (lblBufSize) {
         lblBufSize->setText(QString("Size: %1 (0x%2)")
                             .arg(QLocale().toString(buffer_.size()))
@@ -1341,9 +1863,9 @@ void MainWindow::onLegendContextMenuRequested(const QPoint &pos) {
     const QModelIndex index = legendTable->indexAt(pos);
     if (!index.isValid()) return;
     const int row = index.row();
-    if (row < 0 || row >= bufferSegments.size()) return;
+    if (row < 0 || row >= bufferSegments.count()) return;
 
-    const auto &seg = bufferSegments.at(row);
+    const auto seg = bufferSegments.at(row);
     QMenu menu(legendTable);
     const QString displayLabel = seg.label.isEmpty() ? tr("Segment") : seg.label;
     QAction *deleteAction = menu.addAction(tr("Delete \"%1\"").arg(displayLabel));
@@ -1361,26 +1883,23 @@ void MainWindow::onLegendContextMenuRequested(const QPoint &pos) {
 }
 
 void MainWindow::deleteSegmentAt(int row) {
-    if (row < 0 || row >= bufferSegments.size()) return;
-    const BufferSegment seg = bufferSegments.at(row);
+    if (row < 0 || row >= bufferSegments.count()) return;
+    if (bufferBusy()) return;
+    const SegmentIndex::Segment seg = bufferSegments.at(row);
     const qulonglong bufferSize = static_cast<qulonglong>(buffer_.size());
     const QString displayName = seg.label.isEmpty() ? tr("segment") : seg.label;
     if (seg.length == 0) {
-        bufferSegments.removeAt(row);
+        segmentModel->removeSegment(row);
         if (log) log->appendPlainText(tr("[Segment] Removed empty %1").arg(displayName));
     } else if (seg.start >= bufferSize) {
-        bufferSegments.removeAt(row);
+        segmentModel->removeSegment(row);
         if (log) log->appendPlainText(tr("[Segment] Removed out-of-range %1").arg(displayName));
     } else {
         const qulonglong available = bufferSize - seg.start;
         const qulonglong effectiveLen = std::min(seg.length, available);
-        const int start = static_cast<int>(seg.start);
-        const int len = static_cast<int>(effectiveLen);
-        if (len > 0) buffer_.remove(start, len);
-        bufferSegments.removeAt(row);
-        for (int i = row; i < bufferSegments.size(); ++i) {
-            bufferSegments[i].start -= effectiveLen;
-        }
+        if (effectiveLen > 0) buffer_.remove(qint64(seg.start), qint64(effectiveLen));
+        segmentModel->removeSegment(row);
+        segmentModel->shiftFrom(row, -qint64(effectiveLen));
         if (log) {
             log->appendPlainText(tr("[Segment] Deleted %1 bytes from 0x%2 (%3)")
                                  .arg(QLocale().toString(effectiveLen))
@@ -1389,17 +1908,15 @@ void MainWindow::deleteSegmentAt(int row) {
         }
     }
 
-    updateLegendTable();
     if (legendTable) {
         if (!bufferSegments.isEmpty()) {
-            const int last = static_cast<int>(bufferSegments.size() - 1);
+            const int last = bufferSegments.count() - 1;
             const int selectRow = std::clamp(row, 0, last);
             legendTable->selectRow(selectRow);
         } else {
             legendTable->clearSelection();
         }
     }
-    if (hexModel) hexModel->setBufferRef(&buffer_);
     if (lblBufSize) {
         lblBufSize->setText(QString("Size: %1 (0x%2)")
                             .arg(QLocale().toString(buffer_.size()))
@@ -1409,8 +1926,9 @@ void MainWindow::deleteSegmentAt(int row) {
 }
 
 void MainWindow::fillSegmentWithValue(int row, quint8 value) {
-    if (row < 0 || row >= bufferSegments.size()) return;
-    auto &segment = bufferSegments[row];
+    if (row < 0 || row >= bufferSegments.count()) return;
+    if (bufferBusy()) return;
+    const auto segment = bufferSegments.at(row);
     const qulonglong bufferSize = static_cast<qulonglong>(buffer_.size());
     if (segment.start >= bufferSize || segment.length == 0) return;
 
@@ -1418,22 +1936,14 @@ void MainWindow::fillSegmentWithValue(int row, quint8 value) {
     const qulonglong effectiveLen = std::min(segment.length, available);
     if (effectiveLen == 0) return;
 
-    const int start = static_cast<int>(segment.start);
-    const int len = static_cast<int>(effectiveLen);
-    const char fillChar = static_cast<char>(value);
-    for (int i = 0; i < len; ++i) {
-        buffer_[start + i] = fillChar;
-    }
+    buffer_.fill(qint64(segment.start), qint64(effectiveLen), static_cast<char>(value));
 
-    segment.label = tr("Fill 0x%1").arg(QString::number(value, 16).toUpper().rightJustified(2, QLatin1Char('0')));
-    segment.note.clear();
+    segmentModel->setLabel(row, tr("Fill 0x%1").arg(QString::number(value, 16).toUpper().rightJustified(2, QLatin1Char('0'))));
 
-    updateLegendTable();
-    if (legendTable && segmentModel) {
+    if (legendTable) {
         legendTable->selectRow(row);
         legendTable->scrollTo(segmentModel->index(row, 0), QAbstractItemView::PositionAtCenter);
     }
-    if (hexModel) hexModel->setBufferRef(&buffer_);
     if (log) {
         log->appendPlainText(tr("[Segment] Filled %1 bytes at 0x%2 with 0x%3")
                              .arg(QLocale().toString(effectiveLen))
@@ -1443,58 +1953,5 @@ void MainWindow::fillSegmentWithValue(int row, quint8 value) {
 }
 
 void MainWindow::addSegmentAndRefresh(qulonglong start, qulonglong length, const QString &label) {
-    const qulonglong nBeg = start;
-    const qulonglong nEnd = start + length; // half-open
-
-    QList<BufferSegment> out;
-    out.reserve(bufferSegments.size() + 1);
-
-    bool anyPartialOverlap = false;
-
-    for (const auto &seg : std::as_const(bufferSegments)) {
-        const qulonglong sBeg = seg.start;
-        const qulonglong sEnd = seg.start + seg.length; // half-open
-
-        // no overlap
-        if (sEnd <= nBeg || nEnd <= sBeg) {
-            out.append(seg);
-            continue;
-        }
-
-        const bool hasLeftRemainder  = (sBeg < nBeg);
-        const bool hasRightRemainder = (nEnd < sEnd);
-        if (hasLeftRemainder || hasRightRemainder) anyPartialOverlap = true;
-
-        if (hasLeftRemainder)
-            out.append(BufferSegment{ sBeg, nBeg - sBeg, seg.label, QStringLiteral(" (partial)") , seg.id });
-
-        // middle overlapped portion is dropped
-
-        if (hasRightRemainder)
-            out.append(BufferSegment{ nEnd, sEnd - nEnd, seg.label, QStringLiteral(" (partial)") , seg.id });
-    }
-
-    const qulonglong thisInsertId = nextSegmentId_++;
-    out.append(BufferSegment{ nBeg, length, label,
-                              anyPartialOverlap ? QStringLiteral(" (overlap)") : QString(),
-                              thisInsertId });
-
-    std::sort(out.begin(), out.end(),
-              [](const BufferSegment &a, const BufferSegment &b){ return a.start < b.start; });
-
-    QList<BufferSegment> coalesced;
-    for (const auto &s : std::as_const(out)) {
-        if (!coalesced.isEmpty()) {
-            auto &back = coalesced.last();
-            const bool sameTag    = (back.label == s.label)
-                                   && (back.note == s.note)
-                                   && (back.id == s.id);
-            const bool contiguous = (back.start + back.length == s.start);
-            if (sameTag && contiguous) { back.length += s.length; continue; }
-        }
-        coalesced.append(s);
-    }
-
-    bufferSegments = std::move(coalesced);
-    updateLegendTable();
+    segmentModel->addLoaded(start, length, label);
 }
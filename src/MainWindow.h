@@ -4,12 +4,17 @@
 #include <QFileDialog>
 #include <QByteArray>
 #include <QStringList>
+#include <QThread>
 #include <QUrl>
 #include "ProcessHandling.h"
+#include "BufferDocument.h"
+#include "SegmentIndex.h"
+#include "DeviceSearchIndex.h"
+#include "RecordExport.h"
 
+class QAction;
 class QComboBox;
 class QPushButton;
-class QTableView;
 class QPlainTextEdit;
 class QCheckBox;
 class QLabel;
@@ -19,12 +24,16 @@ class QProgressBar;
 class SegmentView;
 class QModelIndex;
 class SegmentTableView;
+class QStringListModel;
+class AutomationService;
+class ChecksumWindow;
+class LoadPreviewBar;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
 public:
     explicit MainWindow(QWidget *parent = nullptr);
-    ~MainWindow() override = default;
+    ~MainWindow() override;
 
 private slots:
     void saveBufferToFile();
@@ -32,10 +41,18 @@ private slots:
     void loadFileAppendDialog();
     void onDevicesScanned(const QStringList &names);
     void onDevicesListed(const QStringList &names);
-    void onSegmentRowReordered(int from, int to);
+    void onSegmentRowReordered(int from, int to, qulonglong oldStart);
     void onLegendRowDoubleClicked(const QModelIndex &index);
     void onLegendFilesDropped(int row, const QList<QUrl> &urls);
     void onLegendContextMenuRequested(const QPoint &pos);
+    void openGangWindow();
+    void openBatchWindow();
+    void openChecksumWindow();
+    void compareWithFile();
+    void compareWithChip();
+    void diffWithFile();
+    void diffTwoFiles();
+    void clearCompare();
 
     QString pickFile(const QString &title, QFileDialog::AcceptMode mode,
                      const QString &filters = QString());
@@ -69,47 +86,70 @@ private:
     QPushButton *btnBlankCheck{};
     QPushButton *btnEraseDevice{};
     QPushButton *btnTestLogic{};
+    QPushButton *btnProgram{};
+    QPushButton *btnCancel{};
 
     // Device options
     QCheckBox *chkSkipVerify{};
     QCheckBox *chkIgnoreId{};
     QCheckBox *chkSkipId{};
     QCheckBox *chkNoSizeErr{};
+    QCheckBox *chkPipeData{};
 
     // Views
-    QTableView     *tableHex{};
     QPlainTextEdit *log{};
     QFont logFontDefault_;
     QFont logFontFixed_;
 
-    // Hex view model
-    HexView *hexModel{};
+    // Hex view
+    HexView *hexView{};
 
     // Progress bar
     QProgressBar* progReadWrite{};
 
     // In-memory buffer
-    QByteArray buffer_;
+    BufferDocument buffer_;
     QString    lastPath_;
     QString    pendingWriteTempPath_;
-
-    // Buffer segment legend storage
-    struct BufferSegment {
-        qulonglong start{};
-        qulonglong length{};
-        QString    label;
-        QString    note;
-        qulonglong id{};
-    };
+    quint64    pendingWriteJob_{0};
+    // Chip operation announced by started(), and our streamed read if any
+    quint64    runningJob_{0};
+    quint64    readJob_{0};
+
+    // Streamed read in progress: where it started and what to call it
+    qint64     streamReadStart_{-1};
+    QString    streamReadLabel_;
+
+    // Compare with chip: the read goes here instead of the buffer
+    bool         compareRead_{false};
+    BufferEngine compareImage_;
+    QString      compareLabel_;
+    QWidget        *compareBar_{};
+    LoadPreviewBar *comparePreview_{};
+    QLabel         *compareSummary_{};
 
     // Buffer segment legend
-    QList<BufferSegment> bufferSegments{};
+    SegmentIndex bufferSegments;
     SegmentTableView *legendTable{};
     SegmentView *segmentModel{};
-    qulonglong nextSegmentId_ = 1;
 
-    // Process handling helper
+    // Process handling helper, lives on procThread_
     ProcessHandling *proc{};
+    QThread procThread_;
+
+    // Device name search behind the device combo's completer
+    DeviceSearchIndex deviceSearch_;
+    QStringListModel *deviceMatches_{};
+
+    // D-Bus interface for scripts
+    AutomationService *automation_{};
+
+    // Run their own minipro, so only offered while ours is idle
+    QAction *actGang{};
+    QAction *actBatch{};
+
+    // Non-modal, kept once opened so its cached checksums survive closing
+    ChecksumWindow *checksumWindow_{};
 
     // If selected device is a logic IC
     bool currentIsLogic_ = false;
@@ -126,14 +166,19 @@ private:
     void setUiEnabled(bool on);
     void disableBusyButtons();
     void updateActionEnabling();
+    // True, with a log line, while a streamed read is appending to the buffer
+    bool bufferBusy();
+    void showAllDevices();
     void updateChipInfo(const ProcessHandling::ChipInfo &ci);
     void clearChipInfo();
     QString exportBufferToTempFileLocal(const QString& baseName);
-
-    // parsing / buffer helpers
-    bool parseSizeLike(const QString &in, qulonglong &out);
-    void ensureBufferSize(int newSize, char padByte);
-    void patchBuffer(int offset, const QByteArray &data, char padByte);
+    bool importRecordFile(const QString &path, const BufferSource &file);
+    void showComparison(const BufferEngine &other, const QString &label);
+    void updateCompareBar();
+    // Save dialog chose a record or dump suffix
+    void saveBufferAsRecords(const QString &path, RecordExport::Format format);
+    // Side-by-side diff window; the buffer as it is now, or a second file, on the left
+    void openDiffWindow(bool againstBuffer);
 
 protected:
       bool eventFilter(QObject *obj, QEvent *event) override;
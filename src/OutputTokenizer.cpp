@@ -0,0 +1,272 @@
+#include "OutputTokenizer.h"
+
+#include <array>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Keywords, matched case-insensitively with any whitespace run seen as one
+// space. Order gives the bit number.
+enum Keyword : quint32 {
+    KwError          = 1u << 0,
+    KwWarning        = 1u << 1,
+    KwNotYetComplete = 1u << 2,
+    KwInvalid        = 1u << 3,
+    KwIncorrect      = 1u << 4,
+    KwFailed         = 1u << 5,
+    KwCant           = 1u << 6,
+    KwIsBlank        = 1u << 7,
+    KwSuccess        = 1u << 8,
+    KwReadingCode    = 1u << 9,
+    KwWritingCode    = 1u << 10,
+};
+
+struct KeywordDef {
+    const char *text;
+    quint32     bit;
+};
+
+constexpr KeywordDef kKeywords[] = {
+    { "error",            KwError },
+    { "warning",          KwWarning },
+    { "not yet complete", KwNotYetComplete },
+    { "invalid",          KwInvalid },
+    { "incorrect",        KwIncorrect },
+    { "failed",           KwFailed },
+    { "can't",            KwCant },
+    { "is blank",         KwIsBlank },
+    { "success",          KwSuccess },
+    // "Reading\s*Code..." with and without the space
+    { "reading code...",  KwReadingCode },
+    { "readingcode...",   KwReadingCode },
+    { "writing code...",  KwWritingCode },
+    { "writingcode...",   KwWritingCode },
+};
+
+// Input bytes are folded to a small alphabet: a-z (either case), space,
+// apostrophe, dot, and everything else
+constexpr int kClassSpace = 26;
+constexpr int kClassQuote = 27;
+constexpr int kClassDot   = 28;
+constexpr int kClassOther = 29;
+constexpr int kClasses    = 30;
+
+inline bool isSpace(uchar c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Aho-Corasick automaton over kKeywords, expanded to a full transition table
+// so scanning is one lookup per byte
+struct KeywordMatcher {
+    std::array<quint8, 256> cls{};
+    std::vector<std::array<quint16, kClasses>> next;
+    std::vector<quint32> out;
+
+    KeywordMatcher() {
+        for (int c = 0; c < 256; ++c) {
+            if (c >= 'a' && c <= 'z')      cls[c] = quint8(c - 'a');
+            else if (c >= 'A' && c <= 'Z') cls[c] = quint8(c - 'A');
+            else if (isSpace(uchar(c)))    cls[c] = kClassSpace;
+            else if (c == '\'')            cls[c] = kClassQuote;
+            else if (c == '.')             cls[c] = kClassDot;
+            else                           cls[c] = kClassOther;
+        }
+
+        // Trie; 0 in a transition means "none yet" (the root is never a child)
+        next.push_back({});
+        out.push_back(0);
+        for (const auto &kw : kKeywords) {
+            int s = 0;
+            for (const char *p = kw.text; *p; ++p) {
+                const int a = cls[uchar(*p)];
+                if (!next[s][a]) {
+                    next[s][a] = quint16(next.size());
+                    next.push_back({});
+                    out.push_back(0);
+                }
+                s = next[s][a];
+            }
+            out[s] |= kw.bit;
+        }
+
+        // Failure links, breadth first, folded into the table
+        std::vector<int> fail(next.size(), 0);
+        std::vector<int> queue;
+        for (int a = 0; a < kClasses; ++a)
+            if (next[0][a]) queue.push_back(next[0][a]);
+        for (size_t i = 0; i < queue.size(); ++i) {
+            const int s = queue[i];
+            out[s] |= out[fail[s]];
+            for (int a = 0; a < kClasses; ++a) {
+                const int t = next[s][a];
+                if (t) {
+                    fail[t] = next[fail[s]][a];
+                    queue.push_back(t);
+                } else {
+                    next[s][a] = next[fail[s]][a];
+                }
+            }
+        }
+    }
+};
+
+const KeywordMatcher &matcher() {
+    static const KeywordMatcher m;
+    return m;
+}
+
+inline char lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+} // namespace
+
+void OutputTokenizer::reset() {
+    line_.clear();
+    escPending_.clear();
+    esc_ = Esc::None;
+    matchState_ = 0;
+    keywords_ = 0;
+    lastWasSpace_ = true;
+    digits_ = 0;
+    digitCount_ = 0;
+    digitsThenSpace_ = false;
+    percent_ = -1;
+    percentSeen_ = false;
+}
+
+// One visible byte of the current line
+void OutputTokenizer::put(char c) {
+    const uchar u = uchar(c);
+    const bool space = isSpace(u);
+    if (space && line_.isEmpty() && !keepWhitespace_) return;
+    line_.append(c);
+
+    const KeywordMatcher &m = matcher();
+    if (!(space && lastWasSpace_)) {
+        matchState_ = m.next[matchState_][m.cls[u]];
+        keywords_ |= m.out[matchState_];
+    }
+    lastWasSpace_ = space;
+
+    // First "NNN%" (whitespace allowed before the sign); like \d{1,3}, only
+    // the last three digits of a longer run count
+    if (percentSeen_) return;
+    if (c >= '0' && c <= '9') {
+        if (digitsThenSpace_) {
+            digits_ = 0;
+            digitCount_ = 0;
+            digitsThenSpace_ = false;
+        }
+        digits_ = (digits_ * 10 + (c - '0')) % 1000;
+        ++digitCount_;
+    } else if (space) {
+        if (digitCount_) digitsThenSpace_ = true;
+    } else {
+        if (c == '%' && digitCount_) {
+            percentSeen_ = true;
+            percent_ = digits_ <= 100 ? digits_ : -1;
+        }
+        digits_ = 0;
+        digitCount_ = 0;
+        digitsThenSpace_ = false;
+    }
+}
+
+void OutputTokenizer::feed(const char *data, qsizetype length, const LineFn &fn) {
+    for (qsizetype i = 0; i < length; ++i) {
+        const char c = data[i];
+
+        // ESC [ digits/semicolons letter is dropped; anything else that
+        // started with ESC is kept as text
+        if (esc_ == Esc::Escape) {
+            if (c == '[') {
+                escPending_.append(c);
+                esc_ = Esc::Csi;
+                continue;
+            }
+        } else if (esc_ == Esc::Csi) {
+            if ((c >= '0' && c <= '9') || c == ';') {
+                escPending_.append(c);
+                continue;
+            }
+            if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) {
+                escPending_.clear();
+                esc_ = Esc::None;
+                continue;
+            }
+        }
+        if (esc_ != Esc::None) {
+            for (char p : std::as_const(escPending_)) put(p);
+            escPending_.clear();
+            esc_ = Esc::None;
+        }
+
+        if (c == '\x1b') {
+            escPending_.append(c);
+            esc_ = Esc::Escape;
+        } else if (c == '\n' || c == '\r') {
+            endLine(fn);
+        } else {
+            put(c);
+        }
+    }
+}
+
+void OutputTokenizer::finish(const LineFn &fn) {
+    for (char p : std::as_const(escPending_)) put(p);
+    escPending_.clear();
+    esc_ = Esc::None;
+    endLine(fn);
+}
+
+void OutputTokenizer::endLine(const LineFn &fn) {
+    if (!keepWhitespace_) {
+        qsizetype n = line_.size();
+        while (n > 0 && isSpace(uchar(line_.at(n - 1)))) --n;
+        line_.truncate(n);
+    }
+
+    if (!line_.isEmpty()) {
+        Line out;
+        out.text = line_;
+
+        const quint32 kw = keywords_;
+        const qsizetype n = line_.size();
+        const char *t = line_.constData();
+        const bool endsWithSpaceOk = n >= 3 && t[n - 3] == ' '
+            && lower(t[n - 2]) == 'o' && lower(t[n - 1]) == 'k';
+
+        if (kw & KwError)
+            out.kind = Kind::Error;
+        else if (kw & KwWarning)
+            out.kind = (kw & KwNotYetComplete) ? Kind::Notice : Kind::Warning;
+        else if (kw & (KwInvalid | KwIncorrect | KwFailed | KwCant))
+            out.kind = Kind::Failure;
+        else if ((kw & (KwIsBlank | KwSuccess)) || endsWithSpaceOk)
+            out.kind = Kind::Result;
+
+        if (kw & KwReadingCode)      out.phase = Phase::Reading;
+        else if (kw & KwWritingCode) out.phase = Phase::Writing;
+
+        // A trailing "OK" (after any whitespace) means done
+        qsizetype e = n;
+        while (e > 0 && isSpace(uchar(t[e - 1]))) --e;
+        const bool endsWithOk = e >= 2 && lower(t[e - 2]) == 'o' && lower(t[e - 1]) == 'k';
+        out.percent = endsWithOk ? 100 : percent_;
+
+        fn(out);
+    }
+
+    // Start over, keeping the line's capacity
+    line_.resize(0);
+    matchState_ = 0;
+    keywords_ = 0;
+    lastWasSpace_ = true;
+    digits_ = 0;
+    digitCount_ = 0;
+    digitsThenSpace_ = false;
+    percent_ = -1;
+    percentSeen_ = false;
+}
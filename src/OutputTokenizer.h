@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QByteArray>
+#include <QtGlobal>
+
+#include <functional>
+
+// Streaming tokenizer for minipro's text output.
+//
+// Bytes go in as they arrive from the process; complete lines come out with
+// ANSI CSI sequences removed and already classified. Everything is decided
+// in a single pass over the input: keywords are found with a small
+// precomputed automaton fed as the bytes are scanned, and the progress
+// percentage is picked up on the fly, so no line is searched twice and no
+// regex is involved. A partial line is carried over to the next feed().
+class OutputTokenizer {
+public:
+    // How a line should be logged; checked in this order
+    enum class Kind : quint8 {
+        Plain,    // nothing notable
+        Error,    // "error"
+        Warning,  // "warning"
+        Notice,   // "warning" about something "not yet complete"; not shown
+        Failure,  // "invalid", "incorrect", "failed", "can't"
+        Result,   // "is blank", "success", or ends in " OK"
+    };
+    enum class Phase : quint8 { None, Reading, Writing };
+
+    struct Line {
+        QByteArray text;         // ANSI stripped, trimmed unless keepWhitespace
+        Kind       kind{Kind::Plain};
+        Phase      phase{Phase::None};  // "Reading Code..." / "Writing Code..."
+        int        percent{-1};  // "NN%", 100 for a trailing "OK", else -1
+    };
+    using LineFn = std::function<void(const Line &)>;
+
+    // Logic chip tests print aligned tables; keep their whitespace
+    void setKeepWhitespace(bool on) { keepWhitespace_ = on; }
+
+    // Consume bytes; fn is called for every completed, non-empty line.
+    // CR, LF and CRLF all end a line.
+    void feed(const char *data, qsizetype length, const LineFn &fn);
+    void feed(const QByteArray &data, const LineFn &fn) { feed(data.constData(), data.size(), fn); }
+    // Emit whatever is left as a last line
+    void finish(const LineFn &fn);
+    void reset();
+
+private:
+    void put(char c);
+    void endLine(const LineFn &fn);
+
+    enum class Esc : quint8 { None, Escape, Csi };
+
+    QByteArray line_;           // reused between lines
+    QByteArray escPending_;     // an escape sequence not yet known to be CSI
+    Esc        esc_{Esc::None};
+    bool       keepWhitespace_{false};
+
+    // Per-line scan state
+    quint16 matchState_{};      // keyword automaton state
+    quint32 keywords_{};        // bit per keyword seen
+    bool    lastWasSpace_{true};
+    int     digits_{};          // value of the last (up to 3) digits seen
+    int     digitCount_{};
+    bool    digitsThenSpace_{}; // digits followed only by whitespace so far
+    int     percent_{-1};
+    bool    percentSeen_{};
+};
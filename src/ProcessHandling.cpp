@@ -7,29 +7,107 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QThread>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+// Streamed writes: block size, and how much may sit in QProcess' write
+// buffer before we wait for bytesWritten()
+constexpr qint64 kStdinChunk = 64 * 1024;
+constexpr qint64 kStdinHighWater = 4 * kStdinChunk;
+}
 
 // Constructor
 ProcessHandling::ProcessHandling(QObject *parent)
-    : QObject(parent)
+    : QObject(parent), process_(this)
 {
     connect(&process_, &QProcess::readyReadStandardOutput,
             this, &ProcessHandling::handleStdout);
+    connect(&process_, &QProcess::readyReadStandardError,
+            this, &ProcessHandling::handleStderr);
+    // Jobs with an image feed it as the pipe drains; a no-op otherwise
+    connect(&process_, &QProcess::started, this, [this]{ feedStdin(); });
+    connect(&process_, &QProcess::bytesWritten, this, [this](qint64){ feedStdin(); });
     connect(&process_, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
             this, &ProcessHandling::handleFinished);
     connect(&process_, &QProcess::errorOccurred, this, [this](QProcess::ProcessError e){ 
         // if process was killed, do not log an error
         if (e == QProcess::ProcessError::Crashed) return;
-        emit errorLine(QString("[QProcess error] %1").arg(static_cast<int>(e)));
-        emit finished(-1, QProcess::CrashExit);
+        errorLine(QString("[QProcess error] %1").arg(static_cast<int>(e)));
+        flushOutput();
+        // No finished() will follow, end the job here
+        if (e == QProcess::FailedToStart) handleFinished(-1, QProcess::CrashExit);
     });
 
     mode_ = Mode::Idle;
     stdoutBuffer_.clear();
-    stdoutFragment_.clear();
+}
+
+ProcessHandling::~ProcessHandling() {
+    // Don't report anything back while shutting down
+    process_.disconnect(this);
+    if (process_.state() != QProcess::NotRunning) {
+        process_.kill();
+        process_.waitForFinished(3000);
+    }
+}
+
+// Public calls from another thread are re-posted to ours. Returns true if
+// the call was deferred and the caller should return.
+template <typename Fn>
+bool ProcessHandling::deferToOwnThread(Fn &&fn) {
+    if (QThread::currentThread() == thread()) return false;
+    QMetaObject::invokeMethod(this, std::forward<Fn>(fn), Qt::QueuedConnection);
+    return true;
+}
+
+void ProcessHandling::logLine(const QString &text) {
+    pendingOutput_.append(OutputLine{ OutputLine::Log, text });
+}
+
+void ProcessHandling::errorLine(const QString &text) {
+    pendingOutput_.append(OutputLine{ OutputLine::Error, text });
+}
+
+void ProcessHandling::flushOutput() {
+    if (!pendingOutput_.isEmpty()) emit output(current_.id, std::exchange(pendingOutput_, {}));
+    if (pendingPercent_ >= 0 && !current_.background) {
+        emit progress(current_.id, pendingPercent_, pendingPhase_);
+        pendingPercent_ = -1;
+        pendingPhase_.clear();
+    }
+}
+
+void ProcessHandling::setMinipro(const QString &program, const QStringList &environment) {
+    if (deferToOwnThread([=]{ setMinipro(program, environment); })) return;
+    miniproOverride_ = program;
+    miniproEnvironment_ = environment;
 }
 
 QString ProcessHandling::resolveMiniproPath() {
+    if (!miniproOverride_.isEmpty()) return miniproOverride_;
+    return defaultMiniproPath();
+}
+
+QString ProcessHandling::resolveProgram(const QString &program) {
+    QString bin = program.isEmpty() ? defaultMiniproPath() : program;
+    if (!bin.contains('/')) {
+        const QString found = QStandardPaths::findExecutable(bin);
+        if (!found.isEmpty()) bin = found;
+    }
+    const QFileInfo info(bin);
+    return info.exists() ? info.canonicalFilePath() : bin;
+}
+
+QString ProcessHandling::defaultMiniproPath() {
+    // Explicit override, e.g. a scripted stand-in for testing
+    const QString forced = qEnvironmentVariable("FIREMINIPRO_MINIPRO");
+    if (!forced.isEmpty()) return forced;
+
     QString bin = QStandardPaths::findExecutable(QStringLiteral("minipro"));
     QStringList candidates;
 
@@ -82,6 +160,75 @@ QString ProcessHandling::resolveMiniproPath() {
     return bin;
 }
 
+// Open the device index for the XML minipro uses. Only tried once; a
+// missing or broken database leaves everything on the minipro path.
+bool ProcessHandling::ensureDeviceDatabase() {
+    if (deviceDb_.isOpen()) return true;
+    if (deviceDbTried_) return false;
+    deviceDbTried_ = true;
+
+    // Also sets MINIPRO_HOME for bundled builds
+    const QString dir = DeviceDatabase::locateDataDir(resolveMiniproPath());
+    if (dir.isEmpty()) return false;
+
+    QElapsedTimer timer;
+    timer.start();
+    QString error;
+    if (!deviceDb_.open(dir, &error)) {
+        logLine(QString("[DB] Device index not available (%1), using minipro").arg(error));
+        return false;
+    }
+    if (deviceDb_.wasRebuilt()) {
+        logLine(QString("[DB] Indexed %1 device names from %2 in %3 ms")
+                    .arg(deviceDb_.deviceCount()).arg(dir).arg(timer.elapsed()));
+    }
+    return true;
+}
+
+// Load the result cache and tie it to the minipro binary in use. The
+// binary's path, size and mtime stand in for its version, so nothing has
+// to be run to check it.
+void ProcessHandling::ensureCache() {
+    const QFileInfo bin(resolveMiniproPath());
+    const QString key = bin.exists()
+        ? QString("%1|%2|%3").arg(bin.canonicalFilePath()).arg(bin.size())
+                             .arg(bin.lastModified().toMSecsSinceEpoch())
+        : bin.filePath();
+    if (!cacheLoaded_) {
+        cache_.load();
+        cacheLoaded_ = true;
+    }
+    cache_.setMiniproKey(key);
+}
+
+QJsonObject ProcessHandling::chipInfoToJson(const ChipInfo &ci) {
+    return QJsonObject{
+        { "baseName",    ci.baseName },
+        { "package",     ci.package },
+        { "bytes",       QString::number(ci.bytes) },  // may not fit a double
+        { "wordBits",    ci.wordBits },
+        { "protocol",    ci.protocol },
+        { "readBuf",     ci.readBuf },
+        { "writeBuf",    ci.writeBuf },
+        { "isLogic",     ci.isLogic },
+        { "vectorCount", ci.vectorCount },
+    };
+}
+
+ProcessHandling::ChipInfo ProcessHandling::chipInfoFromJson(const QJsonObject &o) {
+    ChipInfo ci;
+    ci.baseName    = o.value("baseName").toString();
+    ci.package     = o.value("package").toString();
+    ci.bytes       = o.value("bytes").toString().toULongLong();
+    ci.wordBits    = o.value("wordBits").toInt();
+    ci.protocol    = o.value("protocol").toString();
+    ci.readBuf     = o.value("readBuf").toInt();
+    ci.writeBuf    = o.value("writeBuf").toInt();
+    ci.isLogic     = o.value("isLogic").toBool();
+    ci.vectorCount = o.value("vectorCount").toInt();
+    return ci;
+}
+
 // Parse programmer list output from minipro -k
 QStringList ProcessHandling::parseProgrammerList(const QString &text) const {
     QStringList out;
@@ -195,31 +342,215 @@ ProcessHandling::ChipInfo ProcessHandling::parseChipInfo(const QString &text) co
     return ci;
 }
 
-// Start the minipro process and make sure only one instance is running
-void ProcessHandling::startMinipro(Mode mode, const QStringList& args)
-{
-    // If something is still running, stop it (keeps current behavior)
-    if (mode_ != Mode::Idle || process_.state() == QProcess::Running) {
-        process_.kill();
-        process_.waitForFinished(3000);
+bool ProcessHandling::isChipOperation(Mode mode) {
+    switch (mode) {
+    case Mode::Idle:
+    case Mode::Scan:
+    case Mode::DeviceList:
+    case Mode::ChipInfo:
+        return false;
+    default:
+        return true;
+    }
+}
+
+ProcessHandling::Priority ProcessHandling::priorityOf(const Job &job) {
+    if (isChipOperation(job.mode)) return Priority::Device;
+    return job.background ? Priority::Refresh : Priority::Metadata;
+}
+
+// Queue a job, coalescing metadata requests, and start it if nothing runs.
+// The id is handed out on the caller's thread so it can be returned at once.
+quint64 ProcessHandling::submit(Job job) {
+    if (!job.id) {
+        job.id = nextJobId_++;
+        if (isChipOperation(job.mode)) ++chipJobs_;
+    }
+    const quint64 id = job.id;
+    if (deferToOwnThread([this, job]{ submit(job); })) return id;
+
+    const bool running = mode_ != Mode::Idle && !cancelled_;
+
+    if (!isChipOperation(job.mode)) {
+        auto same = [&job](const Job &other) {
+            return other.programmer == job.programmer && other.device == job.device;
+        };
+        if (running && current_.mode == job.mode) {
+            if (same(current_)) {
+                // Already on its way; report it even if unchanged if asked to
+                if (!job.background) current_.background = false;
+                return id;
+            }
+            stopCurrent();  // nobody wants the old answer any more
+        }
+        for (auto it = queue_.begin(); it != queue_.end();) {
+            if (it->mode != job.mode) { ++it; continue; }
+            if (same(*it)) {
+                if (!job.background) it->background = false;
+                return id;
+            }
+            it = queue_.erase(it);
+        }
     }
 
+    // A cache refresh gives way to anything asked for directly
+    if (running && priorityOf(current_) == Priority::Refresh
+        && priorityOf(job) > Priority::Refresh)
+        stopCurrent();
+
+    queue_.append(std::move(job));
+    startNext();
+    return id;
+}
+
+// Start the most important queued job, oldest first within a priority
+void ProcessHandling::startNext() {
+    if (mode_ != Mode::Idle || queue_.isEmpty()) return;
+    int best = 0;
+    for (int i = 1; i < queue_.size(); ++i)
+        if (priorityOf(queue_.at(i)) > priorityOf(queue_.at(best))) best = i;
+    startJob(queue_.takeAt(best));
+}
+
+// Kill the running job. Its result is dropped in handleFinished(), which
+// then starts the next one.
+void ProcessHandling::stopCurrent() {
+    if (mode_ == Mode::Idle || cancelled_) return;
+    cancelled_ = true;
+    process_.kill();
+}
+
+// After a stage ends: log and report it, then start the next stage right
+// away if it went well
+bool ProcessHandling::advancePipeline(int exitCode, bool completed) {
+    PipelineRun &run = *current_.pipeline;
+    const int index = run.results.size();
+
+    ProgramPipeline::StageResult r;
+    r.stage = run.definition.stages.at(index);
+    r.exitCode = exitCode;
+    r.elapsedMs = run.stageTimer.elapsed();
+    r.ok = completed && exitCode == 0;
+    // UV EPROMs and the like: nothing to erase, the blank check decides
+    if (!r.ok && completed && r.stage == ProgramPipeline::Stage::Erase
+        && stdoutBuffer_.contains(QLatin1String("can't be erased"))) {
+        r.ok = r.skipped = true;
+    }
+    run.results << r;
+
+    const QString name = ProgramPipeline::stageName(r.stage);
+    if (r.skipped) logLine(QString("[Pipeline] %1 not supported by this chip, skipped").arg(name));
+    else if (r.ok) logLine(QString("[Pipeline] %1 OK").arg(name));
+    else errorLine(QString("[Pipeline] %1 failed, exit=%2").arg(name).arg(exitCode));
+    flushOutput();
+    emit pipelineStageDone(r, index, run.stages.size());
+
+    if (r.ok && index + 1 < run.stages.size()) {
+        Job next = run.stages.at(index + 1);
+        next.pipeline = current_.pipeline;
+        next.id = current_.id;
+        startJob(std::move(next));
+        return true;
+    }
+
+    const bool ok = r.ok && run.results.size() == run.stages.size();
+    logLine(QString("[Pipeline] %1 in %2 s: %3")
+                .arg(ok ? "Done" : "Stopped")
+                .arg(run.totalTimer.elapsed() / 1000.0, 0, 'f', 1)
+                .arg(ProgramPipeline::summary(run.results)));
+    flushOutput();
+    emit pipelineDone(ok, run.results);
+    return false;
+}
+
+void ProcessHandling::cancel() {
+    if (deferToOwnThread([=]{ cancel(); })) return;
+    const QList<Job> dropped = std::exchange(queue_, {});
+    if (mode_ != Mode::Idle && !cancelled_) logLine("[Cancel] Stopping minipro");
+    stopCurrent();
+    flushOutput();
+    for (const Job &job : dropped) endDropped(job);
+}
+
+void ProcessHandling::cancelJob(quint64 job) {
+    if (deferToOwnThread([=]{ cancelJob(job); })) return;
+    if (mode_ != Mode::Idle && current_.id == job) {
+        if (!cancelled_) logLine("[Cancel] Stopping minipro");
+        stopCurrent();
+        flushOutput();
+        return;
+    }
+    for (int i = 0; i < queue_.size(); ++i) {
+        if (queue_.at(i).id != job) continue;
+        endDropped(queue_.takeAt(i));
+        return;
+    }
+}
+
+// Chip operations that never ran still owe their receivers an end
+void ProcessHandling::endDropped(const Job &job) {
+    if (!isChipOperation(job.mode)) return;
+    if (job.mode == Mode::ReadingStream) emit readStreamFinished(job.id, false, 0);
+    --chipJobs_;
+    emit finished(job.id, -1, QProcess::CrashExit);
+}
+
+// Start the minipro process for a job; only called when nothing runs
+void ProcessHandling::startJob(Job job)
+{
+    current_ = std::move(job);
+    cancelled_ = false;
+
     const QString bin = resolveMiniproPath();
 
     // Log the exact command line we’re about to run
-    emit logLine(QString("[Run] %1 %2").arg(bin, args.join(' ')));
+    logLine(QString("[Run] %1 %2").arg(bin, current_.args.join(' ')));
 
     // Set mode first, then clear any previous buffered output
-    mode_ = mode;
+    mode_ = current_.mode;
     stdoutBuffer_.clear();
-    stdoutFragment_.clear();
+    tokenizer_.reset();
+    // Logic tests print aligned tables, keep their whitespace
+    tokenizer_.setKeepWhitespace(mode_ == Mode::Logic);
+    streamedBytes_ = 0;
+    pendingPercent_ = -1;
+    pendingPhase_.clear();
+
+    // Image to feed over stdin, if any
+    writeOffset_ = 0;
+    stdinClosed_ = (mode_ != Mode::WritingStream && mode_ != Mode::Verifying);
+
+    // Later pipeline stages continue the run the first one announced
+    bool continuing = false;
+    if (current_.pipeline) {
+        PipelineRun &run = *current_.pipeline;
+        continuing = !run.results.isEmpty();
+        if (!continuing) run.totalTimer.start();
+        run.stageTimer.start();
+        const int index = run.results.size();
+        pendingPercent_ = run.definition.overallPercent(index, 0);
+        pendingPhase_ = QString("%1/%2 %3").arg(index + 1).arg(run.stages.size())
+                            .arg(ProgramPipeline::stageName(run.definition.stages.at(index)));
+    }
 
-    // Unified QProcess setup
+    // Unified QProcess setup. Streamed reads keep stdout binary-clean, so
+    // the text minipro prints on stderr is read separately.
     process_.setProgram(bin);
-    process_.setArguments(args);
-    process_.setProcessChannelMode(QProcess::MergedChannels);
+    process_.setArguments(current_.args);
+    if (!miniproEnvironment_.isEmpty()) {
+        QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+        for (const QString &entry : std::as_const(miniproEnvironment_)) {
+            const int eq = entry.indexOf('=');
+            if (eq > 0) env.insert(entry.left(eq), entry.mid(eq + 1));
+        }
+        process_.setProcessEnvironment(env);
+    }
+    process_.setProcessChannelMode(mode_ == Mode::ReadingStream ? QProcess::SeparateChannels
+                                                                : QProcess::MergedChannels);
+    // Announced first: a failed start ends the job from within start()
+    flushOutput();
+    if (isChipOperation(mode_) && !continuing) emit started(current_.id);
     process_.start();
-    emit started();
 }
 
 // Helper to create a unique temp path for reading
@@ -232,58 +563,223 @@ static QString uniqueTempPath(const QString& base = "fireminipro-read")
 }
 
 // Read from chip to a unique temp file, emit readReady() with path when done
-void ProcessHandling::readChipImage(const QString& programmer,
-                                    const QString& device,
-                                    const QStringList& extraFlags)
+quint64 ProcessHandling::readChipImage(const QString& programmer,
+                                       const QString& device,
+                                       const QStringList& extraFlags)
 {
     // Parse device name without @ending, if one exists
     QString deviceName = device.split('@').first().trimmed();
     QString outPath = uniqueTempPath(deviceName);
-    pendingTempPath_ = outPath;
 
     // We might need extraFlags like "-y" for reading
     QStringList args;
     args << "-p" << device << "-r" << outPath;
     args << extraFlags;
 
-    startMinipro(Mode::Reading, args);
+    return submit({ Mode::Reading, args, programmer, device, outPath });
+}
+
+// Read from chip with the image piped to stdout, emit readChunk() as data
+// arrives and readStreamFinished() at the end
+quint64 ProcessHandling::readChipImageStreamed(const QString& programmer,
+                                               const QString& device,
+                                               const QStringList& extraFlags)
+{
+    QStringList args;
+    args << "-p" << device << "-r" << "-";
+    args << extraFlags;
+
+    return submit({ Mode::ReadingStream, args, programmer, device });
 }
 
 // Write from a given file to chip
-void ProcessHandling::writeChipImage(const QString& programmer,
-                                     const QString& device,
-                                     const QString& filePath,
-                                     const QStringList& extraFlags)
+quint64 ProcessHandling::writeChipImage(const QString& programmer,
+                                        const QString& device,
+                                        const QString& filePath,
+                                        const QStringList& extraFlags)
 {
     QStringList args;
     // We might need extraFlags like "-y" for writing
     args << "-p" << device << "-w" << filePath;
     args << extraFlags;
 
-    startMinipro(Mode::Writing, args);
+    return submit({ Mode::Writing, args, programmer, device });
+}
+
+// Write to chip with the image piped to stdin. The data is fed in chunks
+// from feedStdin() as the process drains its input.
+quint64 ProcessHandling::writeChipImageStreamed(const QString& programmer,
+                                                const QString& device,
+                                                const BufferEngine& image,
+                                                const QStringList& extraFlags)
+{
+    QStringList args;
+    args << "-p" << device << "-w" << "-";
+    args << extraFlags;
+
+    // The job's copy is the snapshot, taken here on the caller's thread
+    return submit({ Mode::WritingStream, args, programmer, device, {}, image });
+}
+
+// Run a pipeline: its stages become jobs, queued as one behind the first
+quint64 ProcessHandling::runPipeline(const QString &programmer,
+                                     const QString &device,
+                                     const ProgramPipeline &pipeline,
+                                     const BufferEngine &image,
+                                     const QStringList &extraFlags)
+{
+    if (pipeline.stages.isEmpty()) return 0;
+
+    auto run = std::make_shared<PipelineRun>();
+    run->definition = pipeline;
+    const qsizetype writeAt = pipeline.stages.indexOf(ProgramPipeline::Stage::Write);
+    for (const ProgramPipeline::Stage stage : pipeline.stages) {
+        Job job{ Mode::Generic, { "-p", device }, programmer, device };
+        switch (stage) {
+        case ProgramPipeline::Stage::Erase:
+            job.args << "-E";
+            break;
+        case ProgramPipeline::Stage::BlankCheck:
+            job.args << "-b";
+            break;
+        case ProgramPipeline::Stage::Write:
+            job.mode = Mode::WritingStream;
+            job.args << "-w" << "-";
+            // Leave erasing and verifying to their own stages, but only when
+            // those run before and after the write respectively
+            if (pipeline.stages.indexOf(ProgramPipeline::Stage::Erase) >= 0
+                && pipeline.stages.indexOf(ProgramPipeline::Stage::Erase) < writeAt)
+                job.args << "-e";
+            if (pipeline.stages.lastIndexOf(ProgramPipeline::Stage::Verify) > writeAt)
+                job.args << "-v";
+            job.image = image;
+            break;
+        case ProgramPipeline::Stage::Verify:
+            job.mode = Mode::Verifying;
+            job.args << "-m" << "-";
+            job.image = image;
+            break;
+        }
+        job.args << extraFlags;
+        run->stages << job;
+    }
+
+    // Only the running stage points back at the run
+    Job first = run->stages.first();
+    first.pipeline = run;
+    return submit(std::move(first));
+}
+
+// Queue the next chunks of current_.image while the pipe is below the high-water
+// mark; closes stdin once the whole image is queued (QProcess flushes first).
+void ProcessHandling::feedStdin() {
+    if (stdinClosed_ || process_.state() != QProcess::Running) return;
+    const qint64 total = current_.image.size();
+    while (writeOffset_ < total && process_.bytesToWrite() < kStdinHighWater) {
+        const QByteArray chunk = current_.image.read(writeOffset_, kStdinChunk);
+        if (chunk.isEmpty() || process_.write(chunk) != chunk.size()) {
+            errorLine("[Write error] failed to feed minipro stdin");
+            flushOutput();
+            stdinClosed_ = true;
+            process_.kill();
+            return;
+        }
+        writeOffset_ += chunk.size();
+    }
+    if (writeOffset_ >= total) {
+        stdinClosed_ = true;
+        process_.closeWriteChannel();
+    }
 }
 
 // Scan for connected programmers (minipro -k)
-void ProcessHandling::scanConnectedDevices() {
+void ProcessHandling::scanConnectedDevices(bool useCache) {
+    if (deferToOwnThread([=]{ scanConnectedDevices(useCache); })) return;
+
     const QStringList args{ "-k" };
 
-    startMinipro(Mode::Scan, args);
+    // Show what was connected last time; the scan then only reports changes
+    bool cached = false;
+    if (useCache) {
+        ensureCache();
+        QStringList names;
+        if (cache_.programmers(&names)) {
+            flushOutput();
+            emit devicesScanned(names);
+            cached = true;
+        }
+    }
+
+    submit({ Mode::Scan, args, {}, {}, {}, {}, cached });
 }
 
 // Fetch supported devices for a given programmer (minipro -q <programmer> -l)
 void ProcessHandling::fetchSupportedDevices(const QString &programmer)
 {
+    if (deferToOwnThread([=]{ fetchSupportedDevices(programmer); })) return;
+
+    if (DeviceDatabase::knowsProgrammer(programmer) && ensureDeviceDatabase()) {
+        const QStringList devices = deviceDb_.deviceNames(programmer);
+        if (!devices.isEmpty()) {
+            flushOutput();
+            emit devicesListed(devices);
+            return;
+        }
+    }
+
+    // A list from this minipro is final; one from another is shown while
+    // minipro is asked again
+    ensureCache();
+    QStringList cached;
+    bool fresh = false;
+    const bool hit = cache_.deviceList(programmer, &cached, &fresh);
+    if (hit) {
+        flushOutput();
+        emit devicesListed(cached);
+        if (fresh) return;
+    }
+
     // Supported devices need programmer name: -q <programmer> -l
     const QStringList args{ "-q", programmer, "-l" };
 
-    startMinipro(Mode::DeviceList, args);
+    submit({ Mode::DeviceList, args, programmer, {}, {}, {}, hit });
 }
 
 // Fetch chip info for a given programmer and device (minipro -q <programmer> -d "<dev>")
 void ProcessHandling::fetchChipInfo(const QString &programmer, const QString &device)
 {
-    // Stupid fix for QComboBox emitting signal twice
-    if (mode_ == Mode::ChipInfo) return;
+    if (deferToOwnThread([=]{ fetchChipInfo(programmer, device); })) return;
+
+    if (DeviceDatabase::knowsProgrammer(programmer) && ensureDeviceDatabase()) {
+        DeviceDatabase::Device dev;
+        if (deviceDb_.find(programmer, device, &dev)) {
+            ChipInfo ci;
+            const int at = dev.name.indexOf('@');
+            ci.baseName = at >= 0 ? dev.name.left(at) : dev.name;
+            ci.package  = at >= 0 ? dev.name.mid(at + 1) : QString();
+            ci.bytes    = dev.bytes;
+            ci.wordBits = dev.wordBits;
+            if (dev.protocol >= 0)
+                ci.protocol = QString("0x%1").arg(dev.protocol, 2, 16, QLatin1Char('0'));
+            ci.readBuf     = dev.readBuf;
+            ci.writeBuf    = dev.writeBuf;
+            ci.isLogic     = dev.isLogic;
+            ci.vectorCount = dev.vectorCount;
+            flushOutput();
+            emit chipInfoReady(ci);
+            return;
+        }
+    }
+
+    ensureCache();
+    QJsonObject cached;
+    bool fresh = false;
+    const bool hit = cache_.chipInfo(programmer, device, &cached, &fresh);
+    if (hit) {
+        flushOutput();
+        emit chipInfoReady(chipInfoFromJson(cached));
+        if (fresh) return;
+    }
 
     // Chip info needs programmer and device: -q <programmer> -d <dev>
     QStringList args;
@@ -291,158 +787,122 @@ void ProcessHandling::fetchChipInfo(const QString &programmer, const QString &de
         args << "-q" << programmer;
     args << "-d" << device;
 
-    startMinipro(Mode::ChipInfo, args);
+    submit({ Mode::ChipInfo, args, programmer, device, {}, {}, hit });
 }
 
 // Check if chip is blank: minipro -p <device> -b
-void ProcessHandling::checkIfBlank(const QString &programmer,
-                                   const QString &device,
-                                   const QStringList &extraFlags)
+quint64 ProcessHandling::checkIfBlank(const QString &programmer,
+                                      const QString &device,
+                                      const QStringList &extraFlags)
 {
     QStringList args;
     args << "-p" << device << "-b";
     args << extraFlags;
 
-    startMinipro(Mode::Generic, args);
+    return submit({ Mode::Generic, args, programmer, device });
 }
 
 // Erase chip: minipro -p <device> -E
-void ProcessHandling::eraseChip(const QString &programmer,
-                                const QString &device,
-                                const QStringList &extraFlags)
+quint64 ProcessHandling::eraseChip(const QString &programmer,
+                                   const QString &device,
+                                   const QStringList &extraFlags)
 {
     QStringList args;
     args << "-p" << device << "-E";
     args << extraFlags;
 
-    startMinipro(Mode::Generic, args);
+    return submit({ Mode::Generic, args, programmer, device });
 }
 
 // Test logic chip: minipro -p <device> -T
-void ProcessHandling::testLogicChip(const QString &programmer,
-                                     const QString &device,
-                                     const QStringList &extraFlags)
+quint64 ProcessHandling::testLogicChip(const QString &programmer,
+                                       const QString &device,
+                                       const QStringList &extraFlags)
 {
     QStringList args;
     args << "-p" << device << "-T";
     args << extraFlags;
 
-    startMinipro(Mode::Logic, args);
+    return submit({ Mode::Logic, args, programmer, device });
 }
 
 // Send input to the running process (for prompts).
 // not used yet.
 void ProcessHandling::sendResponse(const QString &input) {
+    if (deferToOwnThread([=]{ sendResponse(input); })) return;
     if (process_.state() == QProcess::Running) {
         QTextStream(&process_).operator<<(input + "\n");
         process_.waitForBytesWritten(100);
     }
 }
 
-// Helpers for parsing progress and stripping ANSI/VT codes
-QString ProcessHandling::stripAnsi(QString s) {
-    static QRegularExpression ansiRe(R"(\x1B\[[0-9;]*[A-Za-z])");
-    return s.remove(ansiRe);
-}
-
-// Extract percentage from a line of text, or -1 if none found,
-// for progress bar updates. Handles "xx%", "xx %", and "… OK" endings.
-// OK is treated as 100%.
-int ProcessHandling::extractPercent(const QString &line) {
-    static const QRegularExpression okTail(
-        R"((?:ms|sec)?\s*ok\s*$|verification\s*ok\s*$)",
-        QRegularExpression::CaseInsensitiveOption);
-    if (okTail.match(line).hasMatch())
-        return 100;
+// Handle one tokenized line of stdout+stderr (merged). Keeps it for the
+// parsers in handleFinished(), logs what is worth showing and records
+// progress for the next flush.
+void ProcessHandling::processOutputLine(const OutputTokenizer::Line &line) {
+    using Kind = OutputTokenizer::Kind;
+    const QString ln = QString::fromLocal8Bit(line.text);
 
-    static QRegularExpression re(R"((\d{1,3})\s*%)");
-    auto m = re.match(line);
-    if (!m.hasMatch()) return -1;
-
-    bool ok = false;
-    int pct = m.captured(1).toInt(&ok);
-    return (ok && pct >= 0 && pct <= 100) ? pct : -1;
-}
+    stdoutBuffer_.append(ln + "\n");
 
-// Detect phase text from a line, e.g. "Reading" or "Writing"
-// for progress bar text updates. Returns empty string if none found.
-QString ProcessHandling::detectPhaseText(const QString &line) {
-    static const QRegularExpression rd(R"(\bReading\s*Code\.\.\.)",
-        QRegularExpression::CaseInsensitiveOption);
-    static const QRegularExpression wr(R"(\bWriting\s*Code\.\.\.)",
-        QRegularExpression::CaseInsensitiveOption);
+    // We want to log only specific output
+    switch (line.kind) {
+    case Kind::Error:
+    case Kind::Failure:
+        errorLine(ln);
+        break;
+    case Kind::Warning:
+    case Kind::Result:
+        logLine(ln);
+        break;
+    case Kind::Notice: // ignore "not yet completed" warnings
+        break;
+    case Kind::Plain:
+        if (mode_ == Mode::Logic) logLine(ln);
+        break;
+    }
 
-    if (rd.match(line).hasMatch()) return QStringLiteral("Reading");
-    if (wr.match(line).hasMatch()) return QStringLiteral("Writing");
-    return {};
+    // Only the latest progress per batch is sent, but a phase name sticks
+    // until it is sent
+    if (line.percent >= 0 && current_.pipeline) {
+        // One bar for the whole pipeline, labelled by stage
+        const PipelineRun &run = *current_.pipeline;
+        pendingPercent_ = run.definition.overallPercent(run.results.size(), line.percent);
+    } else if (line.percent >= 0) {
+        pendingPercent_ = line.percent;
+        if (line.phase == OutputTokenizer::Phase::Reading)
+            pendingPhase_ = QStringLiteral("Reading");
+        else if (line.phase == OutputTokenizer::Phase::Writing)
+            pendingPhase_ = QStringLiteral("Writing");
+    }
 }
 
-// Handle stdout+stderr (merged) from the process, parse progress and log lines.
-// Parses lines for errors/warnings and emits logLine() or errorLine() as needed.
-// Calls extractPercent() and detectPhaseText() to parse progress bar updates.
-void ProcessHandling::processOutputLine(QString ln) {
-    if (ln.isEmpty()) return;
-
-    if (mode_ == Mode::Logic) {
-        ln = stripAnsi(ln);
-    } else {
-        // Remove ANSI sequences for non-logic modes
-        ln = stripAnsi(ln).trimmed();
+// Stdout carries the image in streamed reads, and all text otherwise.
+void ProcessHandling::handleStdout() {
+    if (mode_ == Mode::ReadingStream) {
+        const QByteArray payload = process_.readAllStandardOutput();
+        if (payload.isEmpty()) return;
+        streamedBytes_ += payload.size();
+        emit readChunk(current_.id, payload);
+        return;
     }
+    consumeOutputText(process_.readAllStandardOutput());
+    flushOutput();
+}
 
-    if (ln.isEmpty()) return;
-
-    stdoutBuffer_.append(ln + "\n");
-
-    // We want to log only specific output
-    if (ln.contains("error", Qt::CaseInsensitive)) {
-        emit errorLine(ln);
-    } else if (ln.contains("warning", Qt::CaseInsensitive)) {
-        if (!ln.contains("not yet complete", Qt::CaseInsensitive)) // ignore "not yet completed" warnings
-            emit logLine(ln);
-    } else if (ln.contains("invalid", Qt::CaseInsensitive)) {
-        emit errorLine(ln);
-    } else if (ln.contains("incorrect", Qt::CaseInsensitive)) {
-        emit errorLine(ln);
-    } else if (ln.contains("failed", Qt::CaseInsensitive)) {
-        emit errorLine(ln);
-    } else if (ln.contains("can't", Qt::CaseInsensitive)) {
-        emit errorLine(ln);
-    } else if (ln.contains("is blank", Qt::CaseInsensitive)) {
-        emit logLine(ln);
-    } else if (ln.contains("success", Qt::CaseInsensitive)) {
-        emit logLine(ln);
-    } else if (ln.endsWith(" ok", Qt::CaseInsensitive)) {
-        emit logLine(ln);
-    } else if (mode_ == Mode::Logic) {
-        emit logLine(ln);
-    }
-
-    // Parse possible progress from stdout too
-    const int pct = extractPercent(ln);
-    const QString phase = detectPhaseText(ln);
-    if (pct >= 0 && pct <= 100) {
-        emit progress(pct, phase);
-    }
+// Only connected to anything when channels are separate (streamed reads).
+void ProcessHandling::handleStderr() {
+    consumeOutputText(process_.readAllStandardError());
+    flushOutput();
 }
 
 // Adds ANSI-stripped lines to internal stdoutBuffer_ for later parsing by
-// the handleFinished() slot.
-void ProcessHandling::handleStdout() {
-    const QByteArray raw = process_.readAllStandardOutput();
-    if (raw.isEmpty() && stdoutFragment_.isEmpty()) return;
-
-    QString chunk = QString::fromLocal8Bit(raw);
-    chunk.replace("\r\n", "\n");
-    chunk.replace('\r', '\n');
-    stdoutFragment_.append(chunk);
-
-    int newlineIndex = -1;
-    while ((newlineIndex = stdoutFragment_.indexOf('\n')) != -1) {
-        QString line = stdoutFragment_.left(newlineIndex);
-        stdoutFragment_.remove(0, newlineIndex + 1);
+// the handleFinished() slot. A partial last line waits in the tokenizer.
+void ProcessHandling::consumeOutputText(const QByteArray &raw) {
+    if (raw.isEmpty()) return;
+    tokenizer_.feed(raw, [this](const OutputTokenizer::Line &line) {
         processOutputLine(line);
-    }
+    });
 }
 
 // Process has finished, parse final output based on mode and
@@ -450,16 +910,26 @@ void ProcessHandling::handleStdout() {
 void ProcessHandling::handleFinished(int exitCode, QProcess::ExitStatus status) {
     // Drain any remaining output that might not have triggered readyRead.
     handleStdout();
-    if (!stdoutFragment_.isEmpty()) {
-        processOutputLine(stdoutFragment_);
-        stdoutFragment_.clear();
-    }
+    handleStderr();
+    tokenizer_.finish([this](const OutputTokenizer::Line &line) {
+        processOutputLine(line);
+    });
+    flushOutput();
+
+    // Only a run that completed can refresh the cache. A metadata job that
+    // was superseded reports nothing.
+    const bool cancelled = std::exchange(cancelled_, false);
+    const bool background = current_.background || cancelled;
+    const bool completed = status == QProcess::NormalExit && !cancelled;
+    const bool chipOperation = isChipOperation(mode_);
 
     // Scanning for devices
     if (mode_ == Mode::Scan) {
         const QStringList names = parseProgrammerList(stdoutBuffer_);
         mode_ = Mode::Idle;
-        emit devicesScanned(names);
+        const bool changed = completed && cache_.setProgrammers(names);
+        cache_.save();
+        if (!background || changed) emit devicesScanned(names);
     // Get list of supported devices
     } else if (mode_ == Mode::DeviceList) {
         QStringList devices = stdoutBuffer_.split('\n', Qt::SkipEmptyParts);
@@ -471,42 +941,73 @@ void ProcessHandling::handleFinished(int exitCode, QProcess::ExitStatus status)
             return s.isEmpty();
         }), devices.end());
         devices.removeDuplicates();
+        // Sorted here so the GUI thread only has to fill the combo
+        std::sort(devices.begin(), devices.end(), [](const QString &a, const QString &b) {
+            return a.compare(b, Qt::CaseInsensitive) < 0;
+        });
         mode_ = Mode::Idle;
-        emit devicesListed(devices);
+        const bool changed = completed && exitCode == 0
+                             && cache_.setDeviceList(current_.programmer, devices);
+        cache_.save();
+        if (!background || changed) emit devicesListed(devices);
     // Get single chip info
     } else if (mode_ == Mode::ChipInfo) {
         const ChipInfo ci = parseChipInfo(stdoutBuffer_);
         mode_ = Mode::Idle;
-        emit chipInfoReady(ci);
+        const bool changed = completed && exitCode == 0
+                             && cache_.setChipInfo(current_.programmer, current_.device, chipInfoToJson(ci));
+        cache_.save();
+        if (!background || changed) emit chipInfoReady(ci);
     // Logic chip test
     } else if (mode_ == Mode::Reading) {
         const bool ok = (status == QProcess::NormalExit && exitCode == 0);
-        const QString tempPath = pendingTempPath_;
-        pendingTempPath_.clear();
+        const QString tempPath = current_.tempPath;
         if (ok) {
             mode_ = Mode::Idle;
             emit readReady(tempPath);
         } else {
             if (!tempPath.isEmpty()) QFile::remove(tempPath);
             mode_ = Mode::Idle;
-            emit errorLine(QString("[Read error] exit=%1").arg(exitCode));
+            errorLine(QString("[Read error] exit=%1").arg(exitCode));
         }
+    // Streamed read, data has already been delivered
+    } else if (mode_ == Mode::ReadingStream) {
+        const bool ok = (status == QProcess::NormalExit && exitCode == 0);
+        mode_ = Mode::Idle;
+        if (!ok) errorLine(QString("[Read error] exit=%1").arg(exitCode));
+        flushOutput();
+        emit readStreamFinished(current_.id, ok, streamedBytes_);
+    // Verify against the image fed over stdin
+    } else if (mode_ == Mode::Verifying) {
+        const bool ok = (status == QProcess::NormalExit && exitCode == 0);
+        mode_ = Mode::Idle;
+        if (!ok) errorLine(QString("[Verify error] exit=%1").arg(exitCode));
     // Chip programming
-    } else if (mode_ == Mode::Writing) {
+    } else if (mode_ == Mode::Writing || mode_ == Mode::WritingStream) {
         const bool ok = (status == QProcess::NormalExit && exitCode == 0);
         if (ok) {
             mode_ = Mode::Idle;
             emit writeDone();
         } else {
             mode_ = Mode::Idle;
-            emit errorLine(QString("[Write error] exit=%1").arg(exitCode));
+            errorLine(QString("[Write error] exit=%1").arg(exitCode));
         }
     } else {
         mode_ = Mode::Idle;
     }
 
+    // A pipeline goes on with its next stage unless this one failed
+    flushOutput();
+    if (current_.pipeline && advancePipeline(exitCode, completed)) return;
+
     // All operations eventually end up here, send finished() signal to
-    // release the UI.
+    // release the UI, then move on to whatever is queued.
     stdoutBuffer_.clear();
-    emit finished(exitCode, status);
+    flushOutput();
+    const quint64 id = std::exchange(current_, Job()).id;
+    if (chipOperation) {
+        --chipJobs_;
+        emit finished(id, exitCode, status);
+    }
+    startNext();
 }
@@ -1,39 +1,105 @@
 #pragma once
+#include <QElapsedTimer>
+#include <QList>
 #include <QObject>
 #include <QProcess>
 #include <QStringList>
+#include "BufferEngine.h"
+#include "DeviceCache.h"
+#include "DeviceDatabase.h"
+#include "OutputTokenizer.h"
+#include "ProgramPipeline.h"
 
+#include <atomic>
+#include <memory>
+
+// Runs minipro and turns its output into events.
+//
+// Meant to live on a worker thread: the public calls may be made from any
+// thread and are queued to the object's own thread, where the process is
+// driven and all output parsing happens. Receivers only get parsed results.
+//
+// Calls become jobs run one at a time. Chip operations (read, write, erase,
+// blank check, logic test) go first and are never interrupted by anything
+// but cancel(). Metadata requests (scan, device list, chip info) are
+// coalesced: a repeat of one already waiting or running is dropped, and a
+// newer request of the same kind replaces the older one, killing it if it
+// runs. Only chip operations report started() and finished().
+//
+// Each job gets an id, returned by the call that queued it and carried by
+// every signal it causes, so several receivers can share one instance and
+// pick out their own results. Signals not tied to a job carry 0.
 class ProcessHandling : public QObject {
     Q_OBJECT
 public:
     explicit ProcessHandling(QObject *parent = nullptr);
+    ~ProcessHandling() override;
+    // Run this minipro instead of the one found on the system, with extra
+    // "KEY=value" environment entries; for instances driving one programmer
+    // each. An empty program goes back to the default.
+    void setMinipro(const QString &program, const QStringList &environment = {});
+    // Canonical path of the binary a setMinipro() program runs, looked up in
+    // PATH like QProcess does; an empty program gives the default minipro
+    static QString resolveProgram(const QString &program);
     void sendResponse(const QString &input);
-    // Fire-and-forget scan for connected programmers (minipro -k)
-    void scanConnectedDevices();
-    // Fetch supported devices for a given programmer (minipro -q <programmer> -l)
+    // Fire-and-forget scan for connected programmers (minipro -k). With
+    // useCache, the last known programmers are reported right away and the
+    // scan runs in the background, reporting only if something changed.
+    void scanConnectedDevices(bool useCache = false);
+    // Fetch supported devices for a given programmer (minipro -q <programmer> -l).
+    // Both of these answer from the device index when minipro's XML database
+    // is found, else from the result cache, and only run minipro otherwise
+    // (in the background if a cached answer from another minipro was given).
     void fetchSupportedDevices(const QString &programmer);
     // Fetch information about selected chip (minipro -d "<dev>")
     void fetchChipInfo(const QString &programmer, const QString &device);
     // Read from chip into buffer (minipro -r <file>)
-    void readChipImage(const QString& programmer,
-                   const QString& device,
-                   const QStringList& extraFlags = {});
-    void writeChipImage(const QString& programmer,
-                        const QString& device,
-                        const QString& filePath,
-                        const QStringList& extraFlags = {});
+    quint64 readChipImage(const QString& programmer,
+                          const QString& device,
+                          const QStringList& extraFlags = {});
+    // Read from chip streaming the image over stdout (minipro -r -);
+    // payload arrives through readChunk(), progress text through stderr
+    quint64 readChipImageStreamed(const QString& programmer,
+                                  const QString& device,
+                                  const QStringList& extraFlags = {});
+    quint64 writeChipImage(const QString& programmer,
+                           const QString& device,
+                           const QString& filePath,
+                           const QStringList& extraFlags = {});
+    // Write to chip feeding the image over stdin (minipro -w -). The image
+    // is a snapshot, later edits to the caller's buffer do not affect it.
+    quint64 writeChipImageStreamed(const QString& programmer,
+                                   const QString& device,
+                                   const BufferEngine& image,
+                                   const QStringList& extraFlags = {});
     // Check if chip is blank (minipro -b)
-    void checkIfBlank(const QString &programmer,
+    quint64 checkIfBlank(const QString &programmer,
+                         const QString &device,
+                         const QStringList &extraFlags = {});
+    // Erase chip (minipro -e)
+    quint64 eraseChip(const QString &programmer,
                       const QString &device,
                       const QStringList &extraFlags = {});
-    // Erase chip (minipro -e)
-    void eraseChip(const QString &programmer,
-                   const QString &device,
-                   const QStringList &extraFlags = {});
     // Test logic chip (minipro -T)
-    void testLogicChip(const QString &programmer,
-                       const QString &device,
-                       const QStringList &extraFlags = {});
+    quint64 testLogicChip(const QString &programmer,
+                          const QString &device,
+                          const QStringList &extraFlags = {});
+    // Run the stages of a pipeline back to back as one chip operation,
+    // feeding the image over stdin to write and verify. One started() and
+    // finished() cover the whole run.
+    quint64 runPipeline(const QString &programmer,
+                        const QString &device,
+                        const ProgramPipeline &pipeline,
+                        const BufferEngine &image,
+                        const QStringList &extraFlags = {});
+    // Stop the running job, whatever it is, and drop everything queued.
+    // Dropped chip operations still end with finished().
+    void cancel();
+    // Stop one job: kill it if it runs, drop it if queued; the rest goes on
+    void cancelJob(quint64 job);
+    // Thread-safe: a chip operation is queued or running, i.e. the
+    // programmer is taken until its finished()
+    bool hasChipWork() const { return chipJobs_.load() > 0; }
     
     struct ChipInfo {
         QString baseName;      // e.g. "AM2764A"        (may be empty)
@@ -48,35 +114,59 @@ public:
         int     vectorCount{}; // for logic chips, number of vectors
     };
 
+    // One line worth showing in the log
+    struct OutputLine {
+        enum Kind { Log, Error };
+        Kind    kind{Log};
+        QString text;
+    };
+
 signals:
-    // Normal log output
-    void logLine(const QString &text);
-    // Error log output
-    void errorLine(const QString &text);
-    // Parsed progress %
-    void progress(int percent, const QString& phase);
+    // Log output, batched per read from the process
+    void output(quint64 job, const QList<ProcessHandling::OutputLine> &lines);
+    // Parsed progress %, at most once per batch
+    void progress(quint64 job, int percent, const QString& phase);
     // Emitted when a prompt is detected from the process
     void promptDetected(const QString &promptText);
     // Emitted after scanConnectedDevices() completes
     void devicesScanned(const QStringList &names);
+    // Device list, already sorted case-insensitively
     void devicesListed(const QStringList &names);
     // Emitted when chip info is fetched
     void chipInfoReady(const ChipInfo &ci);
     // Emitted when chip reading is successful
     void readReady(const QString& tempPath);
+    // Emitted for each block of image data during a streamed read
+    void readChunk(quint64 job, const QByteArray &data);
+    // Emitted when a streamed read ends, with the number of bytes delivered;
+    // also, failed, for one that cancel() dropped before it started
+    void readStreamFinished(quint64 job, bool ok, qint64 bytes);
     // Emitted when chip writing is done
     void writeDone();
-    // Emitted when process starts
-    void started();
-    // Emitted when process finishes    
-    void finished(int exitCode, QProcess::ExitStatus status);
+    // Emitted as each pipeline stage ends, and once the pipeline is over
+    void pipelineStageDone(const ProgramPipeline::StageResult &result, int index, int count);
+    void pipelineDone(bool ok, const QList<ProgramPipeline::StageResult> &results);
+    // Emitted when a chip operation starts
+    void started(quint64 job);
+    // Emitted when a chip operation finishes, also if it failed or was cancelled
+    void finished(quint64 job, int exitCode, QProcess::ExitStatus status);
 
 private slots:
     void handleStdout();
+    void handleStderr();
     void handleFinished(int exitCode, QProcess::ExitStatus status);
 
 private:
-    void processOutputLine(QString line);
+    template <typename Fn>
+    bool deferToOwnThread(Fn &&fn);
+
+    void processOutputLine(const OutputTokenizer::Line &line);
+    void consumeOutputText(const QByteArray &raw);
+    void logLine(const QString &text);
+    void errorLine(const QString &text);
+    // Emit pending output and progress; called before any other signal so
+    // receivers see events in order
+    void flushOutput();
 
     // Internal mode to disambiguate generic runs vs scans
     enum class Mode { 
@@ -86,21 +176,85 @@ private:
         DeviceList,
         ChipInfo,
         Reading,
+        ReadingStream,
         Writing,
+        WritingStream,
+        Verifying,
         Logic,
     };
 
+    // Job scheduling, see the class comment. Lowest priority first.
+    enum class Priority { Refresh, Metadata, Device };
+    struct PipelineRun;
+    struct Job {
+        Mode         mode{Mode::Idle};
+        QStringList  args;
+        QString      programmer;
+        QString      device;
+        QString      tempPath;        // Reading: file minipro writes
+        BufferEngine image;           // WritingStream, Verifying: fed over stdin
+        // Refreshes a cached answer: results are only reported when they
+        // differ from what was shown
+        bool         background{false};
+        // Set on the stages of a pipeline, queued as its first stage
+        std::shared_ptr<PipelineRun> pipeline;
+        quint64      id{0};           // shared by all stages of a pipeline
+    };
+    struct PipelineRun {
+        ProgramPipeline definition;
+        QList<Job>      stages;   // one job per stage, pipeline unset
+        QList<ProgramPipeline::StageResult> results;
+        QElapsedTimer   stageTimer;
+        QElapsedTimer   totalTimer;
+    };
+    static bool isChipOperation(Mode mode);
+    static Priority priorityOf(const Job &job);
+    // May be called from any thread; gives the job its id
+    quint64 submit(Job job);
+    void startNext();
+    void startJob(Job job);
+    void stopCurrent();
+    // End a chip operation taken off the queue before it ran
+    void endDropped(const Job &job);
+    // Record the stage that just ended; true if the next one was started
+    bool advancePipeline(int exitCode, bool completed);
+
+    Job        current_;
+    QList<Job> queue_;
+    bool       cancelled_{false};  // current_ was killed, drop its result
+    std::atomic<quint64> nextJobId_{1};
+    // Chip operations submitted and not yet finished()
+    std::atomic<int> chipJobs_{0};
+
     Mode    mode_{Mode::Idle};
     QString stdoutBuffer_;
-    QString stdoutFragment_;
-    QString pendingTempPath_;
+    OutputTokenizer tokenizer_;
+    qint64  streamedBytes_{};
+    qint64  writeOffset_{};
+    bool    stdinClosed_{true};
+    QList<OutputLine> pendingOutput_;
+    int     pendingPercent_{-1};
+    QString pendingPhase_;
+
+    void feedStdin();
+
+    // Index of minipro's XML database, opened on first use
+    DeviceDatabase deviceDb_;
+    bool    deviceDbTried_{false};
+    bool    ensureDeviceDatabase();
+
+    // Results of earlier runs, loaded on first use
+    DeviceCache cache_;
+    bool    cacheLoaded_{false};
+    void    ensureCache();
+    static QJsonObject chipInfoToJson(const ChipInfo &ci);
+    static ChipInfo chipInfoFromJson(const QJsonObject &o);
 
+    QString miniproOverride_;
+    QStringList miniproEnvironment_;
     QString resolveMiniproPath();
-    void startMinipro(Mode mode, const QStringList& args);
+    static QString defaultMiniproPath();
     QStringList parseProgrammerList(const QString &text) const;
     ChipInfo parseChipInfo(const QString &text) const;
-    static QString stripAnsi(QString s);
-    static int extractPercent(const QString &line);
-    static QString detectPhaseText(const QString &line);
-    QProcess process_;
+    QProcess process_; // child of this, so it follows moveToThread()
 };
@@ -0,0 +1,58 @@
+#include "ProgramPipeline.h"
+
+#include <QStringList>
+
+#include <algorithm>
+
+ProgramPipeline ProgramPipeline::standard(bool verify) {
+    ProgramPipeline p;
+    p.stages << Stage::Erase << Stage::BlankCheck << Stage::Write;
+    if (verify) p.stages << Stage::Verify;
+    return p;
+}
+
+QString ProgramPipeline::stageName(Stage stage) {
+    switch (stage) {
+    case Stage::Erase:      return QStringLiteral("Erase");
+    case Stage::BlankCheck: return QStringLiteral("Blank check");
+    case Stage::Write:      return QStringLiteral("Write");
+    case Stage::Verify:     return QStringLiteral("Verify");
+    }
+    return {};
+}
+
+// Blank check and verify both read the whole chip; writing is slower still,
+// erase is a single command on chips that support it
+int ProgramPipeline::stageWeight(Stage stage) {
+    switch (stage) {
+    case Stage::Erase:      return 1;
+    case Stage::BlankCheck: return 2;
+    case Stage::Write:      return 5;
+    case Stage::Verify:     return 2;
+    }
+    return 1;
+}
+
+int ProgramPipeline::overallPercent(int index, int stagePercent) const {
+    int total = 0;
+    int done = 0;
+    for (int i = 0; i < stages.size(); ++i) {
+        const int w = stageWeight(stages.at(i));
+        total += w;
+        if (i < index) done += w * 100;
+        else if (i == index) done += w * std::clamp(stagePercent, 0, 100);
+    }
+    return total > 0 ? done / total : 0;
+}
+
+QString ProgramPipeline::summary(const QList<StageResult> &results) {
+    QStringList parts;
+    for (const StageResult &r : results) {
+        QString part = QString("%1 %2 s").arg(stageName(r.stage))
+                                         .arg(r.elapsedMs / 1000.0, 0, 'f', 1);
+        if (r.skipped) part += QStringLiteral(" (skipped)");
+        else if (!r.ok) part += QStringLiteral(" (failed)");
+        parts << part;
+    }
+    return parts.join(QStringLiteral(", "));
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+
+// Stages of programming a chip, run by ProcessHandling as one job.
+//
+// The stages go back to back without waiting on the UI, stop at the first
+// failure, and report one progress figure for the whole run: each stage
+// counts for a share of the bar according to its weight.
+struct ProgramPipeline {
+    enum class Stage { Erase, BlankCheck, Write, Verify };
+
+    struct StageResult {
+        Stage  stage{Stage::Erase};
+        bool   ok{false};
+        bool   skipped{false};   // chip can't do it (UV EPROM erase)
+        int    exitCode{-1};
+        qint64 elapsedMs{0};
+    };
+
+    QList<Stage> stages;
+
+    // Erase, blank check, write, and verify unless skipped
+    static ProgramPipeline standard(bool verify = true);
+
+    static QString stageName(Stage stage);
+    // Rough relative duration of a stage
+    static int stageWeight(Stage stage);
+
+    bool contains(Stage stage) const { return stages.contains(stage); }
+    // Percent of the whole pipeline with stage `index` at `stagePercent`
+    int overallPercent(int index, int stagePercent) const;
+    // "Erase 0.4 s, Blank check 2.1 s, ..." for the log
+    static QString summary(const QList<StageResult> &results);
+};
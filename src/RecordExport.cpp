@@ -0,0 +1,313 @@
+#include "RecordExport.h"
+
+#include "BufferEngine.h"
+
+#include <QFileInfo>
+#include <QIODevice>
+#include <QObject>
+#include <QThread>
+
+#include <algorithm>
+#include <array>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Format = RecordExport::Format;
+
+// Two hex digits per byte value, upper case
+const std::array<std::array<char, 2>, 256> &pairTable() {
+    static const std::array<std::array<char, 2>, 256> table = [] {
+        std::array<std::array<char, 2>, 256> t{};
+        const char *digits = "0123456789ABCDEF";
+        for (int i = 0; i < 256; ++i) t[i] = { digits[i >> 4], digits[i & 15] };
+        return t;
+    }();
+    return table;
+}
+
+const std::array<std::array<char, 2>, 256> &lowerPairTable() {
+    static const std::array<std::array<char, 2>, 256> table = [] {
+        std::array<std::array<char, 2>, 256> t{};
+        const char *digits = "0123456789abcdef";
+        for (int i = 0; i < 256; ++i) t[i] = { digits[i >> 4], digits[i & 15] };
+        return t;
+    }();
+    return table;
+}
+
+// Appends into a buffer sized up front
+struct Writer {
+    char *p;
+    quint8 sum{0};
+
+    void byte(uchar b, const std::array<std::array<char, 2>, 256> &t) {
+        p[0] = t[b][0];
+        p[1] = t[b][1];
+        p += 2;
+        sum = quint8(sum + b);
+    }
+    void put(uchar b) { byte(b, pairTable()); }
+    void put16(quint32 v) { put(uchar(v >> 8)); put(uchar(v)); }
+    void put24(quint32 v) { put(uchar(v >> 16)); put16(v); }
+    void put32(quint32 v) { put(uchar(v >> 24)); put24(v); }
+    void put(const uchar *b, int n) {
+        const auto &t = pairTable();
+        for (int i = 0; i < n; ++i) byte(b[i], t);
+    }
+    void text(const char *s) { while (*s) *p++ = *s++; }
+};
+
+// One piece of the output, formatted on its own
+struct Block {
+    qulonglong start{};
+    qulonglong end{};
+    quint32    upperIn{0};      // Intel HEX: upper address in effect before this block
+    QByteArray text;
+    qint64     records{0};
+    QString    error;
+};
+
+void intelRecord(Writer &w, int count, quint32 addr16, uchar type, const uchar *data) {
+    *w.p++ = ':';
+    w.sum = 0;
+    w.put(uchar(count));
+    w.put16(addr16);
+    w.put(type);
+    w.put(data, count);
+    w.put(uchar(-w.sum));
+    *w.p++ = '\n';
+}
+
+void srecRecord(Writer &w, char type, int addrBytes, quint32 address, const uchar *data, int count) {
+    *w.p++ = 'S';
+    *w.p++ = type;
+    w.sum = 0;
+    w.put(uchar(addrBytes + count + 1));
+    switch (addrBytes) {
+    case 2: w.put16(address); break;
+    case 3: w.put24(address); break;
+    default: w.put32(address); break;
+    }
+    w.put(data, count);
+    w.put(uchar(~w.sum));
+    *w.p++ = '\n';
+}
+
+int srecAddressBytes(qulonglong highest) {
+    if (highest <= 0xFFFF) return 2;
+    if (highest <= 0xFFFFFF) return 3;
+    return 4;
+}
+
+// Offsets as hexdump prints them: at least eight digits
+void hexdumpOffset(Writer &w, qulonglong offset) {
+    int digits = 8;
+    while (digits < 16 && (offset >> (digits * 4)) != 0) ++digits;
+    const auto &t = lowerPairTable();
+    if (digits & 1) {
+        *w.p++ = "0123456789abcdef"[(offset >> ((digits - 1) * 4)) & 15];
+        --digits;
+    }
+    for (int i = digits - 2; i >= 0; i -= 2) {
+        const uchar b = uchar(offset >> (i * 4));
+        *w.p++ = t[b][0];
+        *w.p++ = t[b][1];
+    }
+}
+
+void hexdumpLine(Writer &w, qulonglong offset, const uchar *data, int count) {
+    const auto &t = lowerPairTable();
+    hexdumpOffset(w, offset);
+    *w.p++ = ' ';
+    for (int i = 0; i < 16; ++i) {
+        *w.p++ = ' ';
+        if (i == 8) *w.p++ = ' ';
+        if (i < count) {
+            *w.p++ = t[data[i]][0];
+            *w.p++ = t[data[i]][1];
+        } else {
+            *w.p++ = ' ';
+            *w.p++ = ' ';
+        }
+    }
+    w.text("  |");
+    for (int i = 0; i < count; ++i)
+        *w.p++ = (data[i] >= 0x20 && data[i] < 0x7F) ? char(data[i]) : '.';
+    w.text("|\n");
+}
+
+void format(const BufferEngine &image, const RecordExport::Options &options,
+            int addrBytes, Block &block) {
+    const qint64 length = qint64(block.end - block.start);
+    std::vector<uchar> data(size_t(length));
+    if (image.read(qint64(block.start), reinterpret_cast<char *>(data.data()), length) != length) {
+        block.error = QObject::tr("could not read the buffer at 0x%1").arg(block.start, 0, 16);
+        return;
+    }
+
+    const int per = options.format == Format::HexDump ? 16 : options.bytesPerRecord;
+    // Records start on multiples of 'per', so a short first record can occur
+    const qint64 lines = (length + per - 1) / per + 2 + (length >> 16) + 2;
+    block.text.resize(length * 4 + lines * 48 + 128);
+    Writer w{ block.text.data() };
+
+    quint32 upper = block.upperIn;
+    qulonglong addr = block.start;
+    const uchar *src = data.data();
+    while (addr < block.end) {
+        qulonglong stop = std::min(block.end, (addr / per + 1) * per);
+        if (options.format == Format::IntelHex) {
+            stop = std::min(stop, (addr | 0xFFFF) + 1);     // never across 64 KiB
+            const quint32 hi = quint32(addr >> 16);
+            if (hi != upper) {
+                const uchar base[2] = { uchar(hi >> 8), uchar(hi) };
+                intelRecord(w, 2, 0, 0x04, base);
+                upper = hi;
+            }
+        }
+        const int count = int(stop - addr);
+        switch (options.format) {
+        case Format::IntelHex:
+            intelRecord(w, count, quint32(addr & 0xFFFF), 0x00, src);
+            break;
+        case Format::SRecord:
+            srecRecord(w, char('0' + addrBytes - 1), addrBytes, quint32(addr), src, count);
+            break;
+        case Format::HexDump:
+            hexdumpLine(w, addr, src, count);
+            break;
+        }
+        ++block.records;
+        src += count;
+        addr = stop;
+    }
+    block.text.resize(w.p - block.text.constData());
+}
+
+bool writeAll(QIODevice *out, const QByteArray &text, QString *error) {
+    if (out->write(text) == text.size()) return true;
+    if (error) *error = out->errorString();
+    return false;
+}
+
+} // namespace
+
+bool RecordExport::formatForPath(const QString &path, Format *format) {
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "hex" || suffix == "ihx" || suffix == "ihex") {
+        *format = Format::IntelHex;
+    } else if (suffix == "srec" || suffix == "s19" || suffix == "s28"
+               || suffix == "s37" || suffix == "mot") {
+        *format = Format::SRecord;
+    } else if (suffix == "txt" || suffix == "dump") {
+        *format = Format::HexDump;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool RecordExport::write(const BufferEngine &image,
+                         QList<QPair<qulonglong, qulonglong>> ranges,
+                         const Options &options,
+                         QIODevice *out,
+                         QString *error) {
+    if (ranges.isEmpty()) ranges << qMakePair(qulonglong(0), qulonglong(image.size()));
+    // An S3 record's byte count also covers its address and checksum
+    const int maxPer = options.format == Format::SRecord ? 250 : 255;
+    if (options.bytesPerRecord < 1 || options.bytesPerRecord > maxPer) {
+        if (error) *error = QObject::tr("bytes per record must be 1..%1").arg(maxPer);
+        return false;
+    }
+    for (const auto &range : std::as_const(ranges)) {
+        if (range.first > range.second || range.second > qulonglong(image.size())) {
+            if (error) *error = QObject::tr("range outside the buffer");
+            return false;
+        }
+    }
+    const qulonglong highest = ranges.last().second;
+    if (options.format != Format::HexDump && highest > 0x100000000ULL) {
+        if (error) *error = QObject::tr("addresses above 4 GiB don't fit in %1")
+                                .arg(options.format == Format::IntelHex ? "Intel HEX" : "S-records");
+        return false;
+    }
+
+    // Blocks are a whole number of records and of 64 KiB pages, cut at
+    // absolute addresses so the output doesn't depend on the thread count
+    const int per = options.format == Format::HexDump ? 16 : options.bytesPerRecord;
+    const qulonglong blockSize = qulonglong(per) << 16;
+    std::vector<Block> blocks;
+    quint32 upper = 0;
+    for (const auto &range : std::as_const(ranges)) {
+        for (qulonglong pos = range.first; pos < range.second;) {
+            const qulonglong stop = std::min(range.second, (pos / blockSize + 1) * blockSize);
+            Block b;
+            b.start = pos;
+            b.end = stop;
+            b.upperIn = upper;
+            upper = quint32((stop - 1) >> 16);
+            blocks.push_back(std::move(b));
+            pos = stop;
+        }
+    }
+
+    const int addrBytes = highest ? srecAddressBytes(highest - 1) : 2;
+    if (options.format == Format::SRecord) {
+        const QByteArray header = options.header.toUtf8().left(252);
+        QByteArray text(header.size() * 2 + 16, '\0');
+        Writer w{ text.data() };
+        srecRecord(w, '0', 2, 0, reinterpret_cast<const uchar *>(header.constData()), int(header.size()));
+        text.resize(w.p - text.constData());
+        if (!writeAll(out, text, error)) return false;
+    }
+
+    // A wave of blocks per round keeps the formatted text that is waiting
+    // to be written to a few MiB per thread
+    const size_t threads = size_t(std::max(1, QThread::idealThreadCount()));
+    qint64 records = 0;
+    for (size_t first = 0; first < blocks.size(); first += threads) {
+        const size_t last = std::min(blocks.size(), first + threads);
+        std::vector<std::thread> workers;
+        for (size_t i = first + 1; i < last; ++i)
+            workers.emplace_back([&image, &options, addrBytes, &block = blocks[i]]{
+                format(image, options, addrBytes, block);
+            });
+        format(image, options, addrBytes, blocks[first]);
+        for (auto &w : workers) w.join();
+
+        for (size_t i = first; i < last; ++i) {
+            Block &b = blocks[i];
+            if (!b.error.isEmpty()) {
+                if (error) *error = b.error;
+                return false;
+            }
+            if (!writeAll(out, b.text, error)) return false;
+            records += b.records;
+            b.text = QByteArray();
+        }
+    }
+
+    QByteArray tail(64, '\0');
+    Writer w{ tail.data() };
+    switch (options.format) {
+    case Format::IntelHex:
+        w.text(":00000001FF\n");
+        break;
+    case Format::SRecord:
+        if (records <= 0xFFFF)
+            srecRecord(w, '5', 2, quint32(records), nullptr, 0);
+        else if (records <= 0xFFFFFF)
+            srecRecord(w, '6', 3, quint32(records), nullptr, 0);
+        srecRecord(w, char('0' + 11 - addrBytes), addrBytes, 0, nullptr, 0);
+        break;
+    case Format::HexDump:
+        hexdumpOffset(w, highest);
+        *w.p++ = '\n';
+        break;
+    }
+    tail.resize(w.p - tail.constData());
+    return writeAll(out, tail, error);
+}
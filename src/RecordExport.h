@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QtGlobal>
+
+class BufferEngine;
+class QIODevice;
+
+// Writes the buffer, or chosen ranges of it, as Intel HEX, Motorola
+// S-records or a hexdump -C style listing.
+//
+// Ranges are cut into blocks that are formatted side by side, a few per
+// core at a time, and written out in order. Bytes become text through a
+// 256-entry table of digit pairs written straight into the output block, so
+// the cost per byte is a table load and a two byte store.
+class RecordExport {
+public:
+    enum class Format { IntelHex, SRecord, HexDump };
+
+    struct Options {
+        Format format{Format::IntelHex};
+        int    bytesPerRecord{16};      // data bytes per line, 1..255 (S-records 1..250, hex dump 16)
+        QString header;                 // S-record S0 text
+    };
+
+    // By file name suffix; false for anything that is not one of ours
+    static bool formatForPath(const QString &path, Format *format);
+
+    // [start, end) ranges, sorted and disjoint; empty means the whole image
+    static bool write(const BufferEngine &image,
+                      QList<QPair<qulonglong, qulonglong>> ranges,
+                      const Options &options,
+                      QIODevice *out,
+                      QString *error);
+};
@@ -0,0 +1,294 @@
+#include "RecordImport.h"
+
+#include "BufferDocument.h"
+
+#include <QObject>
+#include <QThread>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr qint64 kMinChunk = 1 << 20;   // not worth a thread below this
+
+// Length of a UTF-8 byte order mark at the start, if any
+qint64 bomSize(const char *data, qint64 size) {
+    return size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0 ? 3 : 0;
+}
+
+// Hex digit value, 0xFF for anything else
+const std::array<quint8, 256> &hexTable() {
+    static const std::array<quint8, 256> table = [] {
+        std::array<quint8, 256> t{};
+        t.fill(0xFF);
+        for (int c = '0'; c <= '9'; ++c) t[c] = quint8(c - '0');
+        for (int c = 'A'; c <= 'F'; ++c) t[c] = quint8(c - 'A' + 10);
+        for (int c = 'a'; c <= 'f'; ++c) t[c] = quint8(c - 'a' + 10);
+        return t;
+    }();
+    return table;
+}
+
+// count bytes from 2*count hex digits; false on a non-digit
+bool decode(const char *in, int count, uchar *out) {
+    const auto &t = hexTable();
+    quint8 bad = 0;
+    for (int i = 0; i < count; ++i) {
+        const quint8 hi = t[uchar(in[2 * i])];
+        const quint8 lo = t[uchar(in[2 * i + 1])];
+        bad |= (hi | lo) & 0xF0;
+        out[i] = uchar((hi << 4) | lo);
+    }
+    return bad == 0;
+}
+
+quint32 sum(const uchar *b, int n) {
+    quint32 s = 0;
+    for (int i = 0; i < n; ++i) s += b[i];
+    return s;
+}
+
+// Decoded bytes of one chunk and where they go
+struct Piece {
+    qulonglong address{};    // absolute, or relative to the inherited base
+    qint64     offset{};     // into the chunk's payload
+    qint64     length{};
+    bool       inherited{};  // Intel HEX data before the chunk's first base record
+};
+
+struct Chunk {
+    const char *begin{};
+    const char *end{};
+
+    QByteArray         payload;
+    std::vector<Piece> pieces;
+    qint64             records{0};
+    qint64             lines{0};
+    bool               sawBase{false};
+    qulonglong         base{0};         // in effect at the end, if sawBase
+    bool               sawEnd{false};   // Intel HEX end of file record
+    QString            error;
+    qint64             errorLine{0};    // within the chunk, 1-based
+
+    void add(qulonglong address, bool inherited, const uchar *data, int n) {
+        ++records;
+        if (n == 0) return;
+        const qint64 offset = payload.size();
+        payload.append(reinterpret_cast<const char *>(data), n);
+        if (!pieces.empty()) {
+            Piece &last = pieces.back();
+            if (last.inherited == inherited && last.address + qulonglong(last.length) == address
+                && last.offset + last.length == offset) {
+                last.length += n;
+                return;
+            }
+        }
+        pieces.push_back({ address, offset, n, inherited });
+    }
+
+    bool fail(const QString &message) {
+        error = message;
+        errorLine = lines + 1;
+        return false;
+    }
+
+    // ":LLAAAATTDD..CC"
+    bool intelLine(const char *p, qint64 n) {
+        uchar b[5 + 255 + 1];
+        if (n < 11 || p[0] != ':' || (n - 1) % 2 != 0)
+            return fail(QObject::tr("not an Intel HEX record"));
+        const int count = int((n - 1) / 2);
+        if (count > int(sizeof b) || !decode(p + 1, count, b))
+            return fail(QObject::tr("bad hex digit"));
+        if (count != 5 + b[0])
+            return fail(QObject::tr("record length does not match its byte count"));
+        if ((sum(b, count) & 0xFF) != 0)
+            return fail(QObject::tr("checksum mismatch"));
+
+        const quint32 addr16 = (quint32(b[1]) << 8) | b[2];
+        const uchar *data = b + 4;
+        switch (b[3]) {
+        case 0x00:
+            add(sawBase ? base + addr16 : addr16, !sawBase, data, b[0]);
+            break;
+        case 0x01:
+            sawEnd = true;
+            break;
+        case 0x02:  // extended segment address
+        case 0x04:  // extended linear address
+            if (b[0] != 2) return fail(QObject::tr("bad address record"));
+            base = ((quint32(data[0]) << 8) | data[1]);
+            base <<= (b[3] == 0x02 ? 4 : 16);
+            sawBase = true;
+            break;
+        case 0x03:  // start addresses, nothing to load
+        case 0x05:
+            break;
+        default:
+            return fail(QObject::tr("unknown record type %1").arg(b[3]));
+        }
+        return true;
+    }
+
+    // "STCCAA..DD..SS"
+    bool srecLine(const char *p, qint64 n) {
+        uchar b[255 + 1];
+        if (n < 4 || p[0] != 'S' || n % 2 != 0)
+            return fail(QObject::tr("not an S-record"));
+        const int count = int((n - 2) / 2);
+        if (count > int(sizeof b) || !decode(p + 2, count, b))
+            return fail(QObject::tr("bad hex digit"));
+        if (count != 1 + b[0])
+            return fail(QObject::tr("record length does not match its byte count"));
+        if ((sum(b, count) & 0xFF) != 0xFF)
+            return fail(QObject::tr("checksum mismatch"));
+
+        int addrBytes = 0;
+        switch (p[1]) {
+        case '1': addrBytes = 2; break;
+        case '2': addrBytes = 3; break;
+        case '3': addrBytes = 4; break;
+        case '0': case '5': case '6': case '7': case '8': case '9':
+            return true;    // header, count and start address records
+        default:
+            return fail(QObject::tr("unknown record type S%1").arg(QChar(p[1])));
+        }
+        if (b[0] < addrBytes + 1) return fail(QObject::tr("record too short"));
+        qulonglong address = 0;
+        for (int i = 0; i < addrBytes; ++i) address = (address << 8) | b[1 + i];
+        add(address, false, b + 1 + addrBytes, b[0] - addrBytes - 1);
+        return true;
+    }
+
+    void parse(RecordImport::Format format) {
+        payload.reserve(int(std::min<qint64>((end - begin) / 2, 1 << 30)));
+        const char *p = begin;
+        while (p < end && !sawEnd) {
+            const char *nl = static_cast<const char *>(std::memchr(p, '\n', size_t(end - p)));
+            const char *lineEnd = nl ? nl : end;
+            const char *q = lineEnd;
+            while (q > p && (q[-1] == '\r' || q[-1] == ' ' || q[-1] == '\t')) --q;
+            const char *s = p;
+            while (s < q && (*s == ' ' || *s == '\t')) ++s;
+            if (s < q) {
+                const bool ok = format == RecordImport::Format::IntelHex ? intelLine(s, q - s)
+                                                                         : srecLine(s, q - s);
+                if (!ok) return;
+            }
+            ++lines;
+            p = nl ? nl + 1 : end;
+        }
+    }
+};
+
+} // namespace
+
+RecordImport::Format RecordImport::detect(const BufferSource &file) {
+    const char *p = file.constData();
+    const char *end = p + file.size();
+    p += bomSize(p, end - p);
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) ++p;
+    if (p < end && *p == ':') return Format::IntelHex;
+    if (end - p >= 2 && p[0] == 'S' && p[1] >= '0' && p[1] <= '9') return Format::SRecord;
+    return Format::Unknown;
+}
+
+QString RecordImport::formatName(Format format) {
+    switch (format) {
+    case Format::IntelHex: return QObject::tr("Intel HEX");
+    case Format::SRecord:  return QObject::tr("S-record");
+    case Format::Unknown:  break;
+    }
+    return QObject::tr("unknown");
+}
+
+RecordImport::Result RecordImport::parse(const BufferSource &file) {
+    Result result;
+    result.format = detect(file);
+    if (result.format == Format::Unknown) {
+        result.error = QObject::tr("not an Intel HEX or S-record file");
+        return result;
+    }
+
+    // Chunks end right after a line end
+    const char *data = file.constData();
+    const qint64 size = file.size();
+    const int threads = std::max(1, QThread::idealThreadCount());
+    const qint64 target = std::max(kMinChunk, (size + threads - 1) / threads);
+    std::vector<Chunk> chunks;
+    // The first chunk starts past a byte order mark, as detect() does
+    for (qint64 pos = bomSize(data, size); pos < size;) {
+        qint64 stop = std::min(size, pos + target);
+        if (stop < size) {
+            const void *nl = std::memchr(data + stop, '\n', size_t(size - stop));
+            stop = nl ? static_cast<const char *>(nl) - data + 1 : size;
+        }
+        Chunk c;
+        c.begin = data + pos;
+        c.end = data + stop;
+        chunks.push_back(std::move(c));
+        pos = stop;
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < chunks.size(); ++i)
+        workers.emplace_back([&chunks, i, format = result.format]{ chunks[i].parse(format); });
+    if (!chunks.empty()) chunks[0].parse(result.format);
+    for (auto &w : workers) w.join();
+
+    // In file order: carry the Intel HEX base over, stop at the end record
+    qulonglong base = 0;
+    qint64 lineBase = 0;
+    bool first = true;
+    for (const Chunk &c : chunks) {
+        if (!c.error.isEmpty()) {
+            result.error = c.error;
+            result.errorLine = lineBase + c.errorLine;
+            result.runs.clear();
+            return result;
+        }
+        const BufferSource payload(c.payload);
+        for (const Piece &piece : c.pieces) {
+            const qulonglong address = piece.inherited ? base + piece.address : piece.address;
+            result.runs << Run{ address, payload.mid(piece.offset, piece.length) };
+            const qulonglong end = address + qulonglong(piece.length);
+            result.lowest  = first ? address : std::min(result.lowest, address);
+            result.highest = first ? end : std::max(result.highest, end);
+            first = false;
+        }
+        result.records += c.records;
+        if (c.sawBase) base = c.base;
+        lineBase += c.lines;
+        if (c.sawEnd) break;
+    }
+    if (result.runs.isEmpty()) result.error = QObject::tr("no data records");
+    return result;
+}
+
+QList<QPair<qulonglong, qulonglong>> RecordImport::spans(const Result &result) {
+    QList<QPair<qulonglong, qulonglong>> all;
+    all.reserve(result.runs.size());
+    for (const Run &run : result.runs) all << qMakePair(run.address, run.address + qulonglong(run.data.size()));
+    std::sort(all.begin(), all.end());
+
+    QList<QPair<qulonglong, qulonglong>> merged;
+    for (const auto &span : std::as_const(all)) {
+        if (!merged.isEmpty() && span.first <= merged.last().second)
+            merged.last().second = std::max(merged.last().second, span.second);
+        else
+            merged << span;
+    }
+    return merged;
+}
+
+void RecordImport::place(BufferDocument &buffer, const Result &result, qint64 shift, char padByte) {
+    if (result.runs.isEmpty()) return;
+    const qint64 lowest = qint64(result.lowest) + shift;
+    buffer.place(lowest, BufferSource(), qint64(result.highest - result.lowest), padByte);
+    for (const Run &run : result.runs)
+        buffer.overwrite(qint64(run.address) + shift, run.data);
+}
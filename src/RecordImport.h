@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QtGlobal>
+
+#include "BufferEngine.h"
+
+class BufferDocument;
+
+// Intel HEX and Motorola S-record files turned into runs of bytes at the
+// addresses their records give.
+//
+// The file is cut at line ends into one chunk per core and the chunks are
+// decoded side by side: hex digits and checksums go through lookup tables,
+// and consecutive records are merged into runs as they are decoded. Intel
+// HEX data before a chunk's first extended address record takes its base
+// from the chunks before it, which is resolved once all chunks are done.
+// Runs point into the decoded chunks, nothing is copied afterwards.
+class RecordImport {
+public:
+    enum class Format { Unknown, IntelHex, SRecord };
+
+    struct Run {
+        qulonglong   address{};
+        BufferSource data;
+    };
+
+    struct Result {
+        Format     format{Format::Unknown};
+        QList<Run> runs;            // in file order; later runs win on overlap
+        qint64     records{0};      // data records
+        qulonglong lowest{0};       // address range covered by the runs
+        qulonglong highest{0};      // one past the last byte
+        QString    error;           // empty on success
+        qint64     errorLine{0};    // 1-based, if error is set
+    };
+
+    // By the first record character; Unknown for anything else
+    static Format detect(const BufferSource &file);
+    static QString formatName(Format format);
+
+    static Result parse(const BufferSource &file);
+
+    // Address ranges the runs cover, sorted, touching ones merged; [start, end)
+    static QList<QPair<qulonglong, qulonglong>> spans(const Result &result);
+
+    // Lay the result into the buffer at address + shift: the whole span
+    // from the lowest to the highest address is filled with padByte first,
+    // then the runs are written over it
+    static void place(BufferDocument &buffer, const Result &result, qint64 shift, char padByte);
+};
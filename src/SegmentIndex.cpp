@@ -0,0 +1,327 @@
+#include "SegmentIndex.h"
+
+#include <QVector>
+
+#include <algorithm>
+
+struct SegmentIndex::Node {
+    Segment segment;       // start already includes every shift above this node
+    quint32 priority{};
+    int     size{};        // rows in this subtree
+    qint64  pendingShift{}; // not yet applied to the children
+    NodePtr left;
+    NodePtr right;
+};
+
+SegmentIndex::SegmentIndex() = default;
+SegmentIndex::SegmentIndex(SegmentIndex &&other) noexcept = default;
+SegmentIndex &SegmentIndex::operator=(SegmentIndex &&other) noexcept = default;
+SegmentIndex::~SegmentIndex() = default;
+
+SegmentIndex::SegmentIndex(const SegmentIndex &other)
+    : root_(clone(other.root_.get())), seed_(other.seed_), nextId_(other.nextId_) {}
+
+SegmentIndex &SegmentIndex::operator=(const SegmentIndex &other) {
+    if (this != &other) {
+        root_ = clone(other.root_.get());
+        seed_ = other.seed_;
+        nextId_ = other.nextId_;
+    }
+    return *this;
+}
+
+SegmentIndex::NodePtr SegmentIndex::clone(const Node *n) {
+    if (!n) return {};
+    auto c = std::make_unique<Node>();
+    c->segment      = n->segment;
+    c->priority     = n->priority;
+    c->size         = n->size;
+    c->pendingShift = n->pendingShift;
+    c->left         = clone(n->left.get());
+    c->right        = clone(n->right.get());
+    return c;
+}
+
+SegmentIndex::NodePtr SegmentIndex::makeNode(Segment segment) {
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    auto n = std::make_unique<Node>();
+    n->segment = std::move(segment);
+    n->priority = seed_;
+    update(n.get());
+    return n;
+}
+
+int SegmentIndex::sizeOf(const Node *n) {
+    return n ? n->size : 0;
+}
+
+void SegmentIndex::update(Node *n) {
+    if (n) n->size = 1 + sizeOf(n->left.get()) + sizeOf(n->right.get());
+}
+
+void SegmentIndex::push(Node *n) {
+    if (!n || n->pendingShift == 0) return;
+    for (Node *c : {n->left.get(), n->right.get()}) {
+        if (!c) continue;
+        c->segment.start += qulonglong(n->pendingShift);
+        c->pendingShift += n->pendingShift;
+    }
+    n->pendingShift = 0;
+}
+
+SegmentIndex::NodePtr SegmentIndex::merge(NodePtr a, NodePtr b) {
+    if (!a) return b;
+    if (!b) return a;
+    if (a->priority > b->priority) {
+        push(a.get());
+        a->right = merge(std::move(a->right), std::move(b));
+        update(a.get());
+        return a;
+    }
+    push(b.get());
+    b->left = merge(std::move(a), std::move(b->left));
+    update(b.get());
+    return b;
+}
+
+// First k rows go to the returned tree, the rest to rightOut
+SegmentIndex::NodePtr SegmentIndex::split(NodePtr t, int k, NodePtr &rightOut) {
+    if (!t) { rightOut.reset(); return {}; }
+    push(t.get());
+    if (k <= sizeOf(t->left.get())) {
+        NodePtr r;
+        NodePtr l = split(std::move(t->left), k, r);
+        t->left = std::move(r);
+        update(t.get());
+        rightOut = std::move(t);
+        return l;
+    }
+    NodePtr r;
+    t->right = split(std::move(t->right), k - sizeOf(t->left.get()) - 1, r);
+    update(t.get());
+    rightOut = std::move(r);
+    return t;
+}
+
+int SegmentIndex::count() const {
+    return sizeOf(root_.get());
+}
+
+void SegmentIndex::clear() {
+    root_.reset();
+}
+
+SegmentIndex::Segment SegmentIndex::at(int row) const {
+    const Node *n = root_.get();
+    qint64 shift = 0; // pending shifts of the ancestors walked so far
+    while (n) {
+        const int leftSize = sizeOf(n->left.get());
+        if (row == leftSize) {
+            Segment s = n->segment;
+            s.start += qulonglong(shift);
+            return s;
+        }
+        shift += n->pendingShift;
+        if (row < leftSize) {
+            n = n->left.get();
+        } else {
+            row -= leftSize + 1;
+            n = n->right.get();
+        }
+    }
+    return {};
+}
+
+void SegmentIndex::setLabel(int row, const QString &label, const QString &note) {
+    Node *n = root_.get();
+    while (n) {
+        const int leftSize = sizeOf(n->left.get());
+        if (row == leftSize) {
+            n->segment.label = label;
+            n->segment.note = note;
+            return;
+        }
+        if (row < leftSize) {
+            n = n->left.get();
+        } else {
+            row -= leftSize + 1;
+            n = n->right.get();
+        }
+    }
+}
+
+int SegmentIndex::firstEndingAfter(qulonglong addr) const {
+    const Node *n = root_.get();
+    qint64 shift = 0;
+    int base = 0;
+    int result = count();
+    while (n) {
+        const qulonglong start = n->segment.start + qulonglong(shift);
+        const int leftSize = sizeOf(n->left.get());
+        shift += n->pendingShift;
+        if (start + n->segment.length > addr) {
+            result = base + leftSize;
+            n = n->left.get();
+        } else {
+            base += leftSize + 1;
+            n = n->right.get();
+        }
+    }
+    return result;
+}
+
+int SegmentIndex::firstStartingAt(qulonglong addr) const {
+    const Node *n = root_.get();
+    qint64 shift = 0;
+    int base = 0;
+    int result = count();
+    while (n) {
+        const qulonglong start = n->segment.start + qulonglong(shift);
+        const int leftSize = sizeOf(n->left.get());
+        shift += n->pendingShift;
+        if (start >= addr) {
+            result = base + leftSize;
+            n = n->left.get();
+        } else {
+            base += leftSize + 1;
+            n = n->right.get();
+        }
+    }
+    return result;
+}
+
+int SegmentIndex::rowAt(qulonglong addr) const {
+    const int row = firstEndingAfter(addr);
+    if (row >= count()) return -1;
+    return at(row).start <= addr ? row : -1;
+}
+
+std::pair<int, int> SegmentIndex::overlapping(qulonglong beg, qulonglong end) const {
+    if (end <= beg) return {0, 0};
+    const int first = firstEndingAfter(beg);
+    const int last = firstStartingAt(end);
+    return first < last ? std::make_pair(first, last) : std::make_pair(first, first);
+}
+
+int SegmentIndex::addLoaded(qulonglong start, qulonglong length, const QString &label) {
+    const qulonglong nBeg = start;
+    const qulonglong nEnd = start + length; // half-open
+
+    const auto [first, last] = overlapping(nBeg, nEnd);
+
+    // Carve out the overlapped rows; only their remainders come back
+    NodePtr rest;
+    NodePtr head = split(std::move(root_), first, rest);
+    NodePtr tail;
+    NodePtr hit = split(std::move(rest), last - first, tail);
+
+    QVector<Segment> replaced;
+    replaced.reserve(3);
+    bool anyPartialOverlap = false;
+    if (hit) {
+        std::function<void(Node *)> collect = [&](Node *n) {
+            if (!n) return;
+            push(n);
+            collect(n->left.get());
+            const Segment &seg = n->segment;
+            const bool hasLeftRemainder  = (seg.start < nBeg);
+            const bool hasRightRemainder = (nEnd < seg.end());
+            if (hasLeftRemainder || hasRightRemainder) anyPartialOverlap = true;
+            if (hasLeftRemainder)
+                replaced.append(Segment{ seg.start, nBeg - seg.start, seg.label,
+                                         QStringLiteral(" (partial)"), seg.id });
+            if (hasRightRemainder)
+                replaced.append(Segment{ nEnd, seg.end() - nEnd, seg.label,
+                                         QStringLiteral(" (partial)"), seg.id });
+            collect(n->right.get());
+        };
+        collect(hit.get());
+        hit.reset();
+    }
+
+    Segment added{ nBeg, length, label,
+                   anyPartialOverlap ? QStringLiteral(" (overlap)") : QString(),
+                   allocateId() };
+
+    // A left remainder sorts before the new segment, a right one after it
+    NodePtr middle;
+    int row = first;
+    for (Segment &seg : replaced) {
+        if (seg.start < nBeg) ++row;
+    }
+    for (Segment &seg : replaced) {
+        if (seg.start < nBeg) middle = merge(std::move(middle), makeNode(std::move(seg)));
+    }
+    middle = merge(std::move(middle), makeNode(std::move(added)));
+    for (Segment &seg : replaced) {
+        if (seg.start >= nEnd) middle = merge(std::move(middle), makeNode(std::move(seg)));
+    }
+
+    root_ = merge(merge(std::move(head), std::move(middle)), std::move(tail));
+    return row;
+}
+
+void SegmentIndex::insertAt(int row, Segment segment) {
+    row = std::clamp(row, 0, count());
+    NodePtr tail;
+    NodePtr head = split(std::move(root_), row, tail);
+    root_ = merge(merge(std::move(head), makeNode(std::move(segment))), std::move(tail));
+}
+
+SegmentIndex::Segment SegmentIndex::takeAt(int row) {
+    if (row < 0 || row >= count()) return {};
+    NodePtr rest;
+    NodePtr head = split(std::move(root_), row, rest);
+    NodePtr tail;
+    NodePtr one = split(std::move(rest), 1, tail);
+    Segment out = std::move(one->segment);
+    root_ = merge(std::move(head), std::move(tail));
+    return out;
+}
+
+void SegmentIndex::shiftFrom(int row, qint64 delta) {
+    if (delta == 0 || row >= count()) return;
+    row = std::max(row, 0);
+    NodePtr tail;
+    NodePtr head = split(std::move(root_), row, tail);
+    if (tail) {
+        tail->segment.start += qulonglong(delta);
+        tail->pendingShift += delta;
+    }
+    root_ = merge(std::move(head), std::move(tail));
+}
+
+void SegmentIndex::forEach(const std::function<bool(int row, const Segment &)> &fn, int from) const {
+    // Iterative in-order walk carrying the shift of the ancestors on the stack
+    struct Frame { const Node *node; qint64 shift; int base; };
+    QVector<Frame> stack;
+    const Node *n = root_.get();
+    qint64 shift = 0;
+    int base = 0;
+    while (n || !stack.isEmpty()) {
+        while (n) {
+            const int leftSize = sizeOf(n->left.get());
+            if (base + leftSize < from) {
+                // Whole left subtree and this node are before 'from'
+                base += leftSize + 1;
+                shift += n->pendingShift;
+                n = n->right.get();
+                continue;
+            }
+            stack.append({n, shift, base});
+            shift += n->pendingShift;
+            n = n->left.get();
+        }
+        if (stack.isEmpty()) break;
+        const Frame f = stack.takeLast();
+        const int row = f.base + sizeOf(f.node->left.get());
+        Segment s = f.node->segment;
+        s.start += qulonglong(f.shift);
+        if (!fn(row, s)) return;
+        n = f.node->right.get();
+        shift = f.shift + f.node->pendingShift;
+        base = row + 1;
+    }
+}
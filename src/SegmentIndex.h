@@ -0,0 +1,83 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+#include <functional>
+#include <memory>
+#include <utility>
+
+// Ordered store of the buffer segment legend.
+//
+// Segments are disjoint and kept sorted by start address in a treap keyed by
+// row position. Each node carries a pending start shift for its subtree, so
+// moving every following segment after an insert or delete is O(log n)
+// instead of a loop. Point and overlap queries descend the tree.
+class SegmentIndex {
+public:
+    struct Segment {
+        qulonglong start{};
+        qulonglong length{};
+        QString    label;
+        QString    note;
+        qulonglong id{};
+
+        qulonglong end() const { return start + length; } // half-open
+    };
+
+    SegmentIndex();
+    SegmentIndex(const SegmentIndex &other);
+    SegmentIndex(SegmentIndex &&other) noexcept;
+    SegmentIndex &operator=(const SegmentIndex &other);
+    SegmentIndex &operator=(SegmentIndex &&other) noexcept;
+    ~SegmentIndex();
+
+    int  count() const;
+    bool isEmpty() const { return count() == 0; }
+    void clear();
+
+    // Row access, O(log n)
+    Segment at(int row) const;
+    void    setLabel(int row, const QString &label, const QString &note = {});
+
+    // Row of the segment containing addr, or -1
+    int rowAt(qulonglong addr) const;
+    // First row whose end is past addr (count() if none)
+    int firstEndingAfter(qulonglong addr) const;
+    // First row starting at or after addr (count() if none)
+    int firstStartingAt(qulonglong addr) const;
+    // Rows [first, last) overlapping [beg, end)
+    std::pair<int, int> overlapping(qulonglong beg, qulonglong end) const;
+
+    // Record a load of [start, start+length). Overlapped segments are cut
+    // back to their non-overlapped remainders (noted as partial) and the new
+    // segment is noted as overlap if it cut into something. Returns its row.
+    int addLoaded(qulonglong start, qulonglong length, const QString &label);
+
+    // Structural edits; these do not shift anything by themselves
+    void    insertAt(int row, Segment segment);
+    Segment takeAt(int row);
+    // Add delta to the start of every row >= row
+    void    shiftFrom(int row, qint64 delta);
+
+    qulonglong allocateId() { return nextId_++; }
+
+    // In-order visit from row 'from'; callback returns false to stop
+    void forEach(const std::function<bool(int row, const Segment &)> &fn, int from = 0) const;
+
+private:
+    struct Node;
+    using NodePtr = std::unique_ptr<Node>;
+
+    NodePtr makeNode(Segment segment);
+    static NodePtr clone(const Node *n);
+    static void update(Node *n);
+    static void push(Node *n);
+    static int sizeOf(const Node *n);
+    static NodePtr merge(NodePtr a, NodePtr b);
+    static NodePtr split(NodePtr t, int k, NodePtr &rightOut);
+
+    NodePtr    root_;
+    quint32    seed_{0x2545F491u};
+    qulonglong nextId_{1};
+};
@@ -1,10 +1,12 @@
 #include "SegmentView.h"
 
+#include "BufferDocument.h"
+
 #include <QDataStream>
 #include <QMimeData>
 #include <QIODevice>
 
-#include <utility>
+#include <algorithm>
 
 namespace {
 constexpr auto kMimeType = "application/x-fireminipro-segment-row";
@@ -14,8 +16,8 @@ SegmentView::SegmentView(QObject *parent)
     : QAbstractTableModel(parent) {}
 
 int SegmentView::rowCount(const QModelIndex &parent) const {
-    if (parent.isValid()) return 0;
-    return rows_.size();
+    if (parent.isValid() || !index_) return 0;
+    return index_->count();
 }
 
 int SegmentView::columnCount(const QModelIndex &parent) const {
@@ -24,13 +26,12 @@ int SegmentView::columnCount(const QModelIndex &parent) const {
 }
 
 QVariant SegmentView::data(const QModelIndex &index, int role) const {
-    if (!index.isValid()) return {};
-    if (index.row() < 0 || index.row() >= rows_.size()) return {};
-
-    const auto &segment = rows_.at(index.row());
+    if (!index.isValid() || !index_) return {};
+    if (index.row() < 0 || index.row() >= index_->count()) return {};
 
     switch (role) {
-    case Qt::DisplayRole:
+    case Qt::DisplayRole: {
+        const Segment segment = index_->at(index.row());
         switch (index.column()) {
         case 0: return formatStart(segment.start);
         case 1: return formatEnd(segment.start, segment.length);
@@ -38,6 +39,7 @@ QVariant SegmentView::data(const QModelIndex &index, int role) const {
         case 3: return formatLabel(segment);
         default: return {};
         }
+    }
     case Qt::TextAlignmentRole:
         if (index.column() < 3) return int(Qt::AlignRight | Qt::AlignVCenter);
         return int(Qt::AlignLeft | Qt::AlignVCenter);
@@ -61,7 +63,7 @@ QVariant SegmentView::headerData(int section, Qt::Orientation orientation, int r
 
 Qt::ItemFlags SegmentView::flags(const QModelIndex &index) const {
     auto f = QAbstractTableModel::flags(index);
-    if (index.isValid())
+    if (index.isValid() && reorderEnabled_)
         f |= Qt::ItemIsDragEnabled | Qt::ItemIsDropEnabled;
     else
         f |= Qt::ItemIsDropEnabled;
@@ -75,7 +77,7 @@ QStringList SegmentView::mimeTypes() const {
 QMimeData *SegmentView::mimeData(const QModelIndexList &indexes) const {
     if (indexes.isEmpty()) return nullptr;
     const int row = indexes.first().row();
-    if (row < 0 || row >= rows_.size()) return nullptr;
+    if (row < 0 || row >= rowCount()) return nullptr;
 
     auto *mime = new QMimeData;
     QByteArray encoded;
@@ -95,15 +97,16 @@ bool SegmentView::dropMimeData(const QMimeData *data, Qt::DropAction action, int
     QDataStream stream(&encoded, QIODevice::ReadOnly);
     int sourceRow = -1;
     stream >> sourceRow;
-    if (sourceRow < 0 || sourceRow >= rows_.size()) return false;
+    const int rows = rowCount();
+    if (sourceRow < 0 || sourceRow >= rows) return false;
 
     int destinationRow = row;
     if (destinationRow == -1) {
-        destinationRow = parent.isValid() ? parent.row() : rows_.size();
+        destinationRow = parent.isValid() ? parent.row() : rows;
     }
 
     if (destinationRow > sourceRow) {
-        if (destinationRow < rows_.size())
+        if (destinationRow < rows)
             destinationRow -= 1;
     }
     if (destinationRow == sourceRow) return false;
@@ -122,42 +125,63 @@ Qt::DropActions SegmentView::supportedDragActions() const {
 bool SegmentView::moveRows(const QModelIndex &sourceParent, int sourceRow, int count,
                            const QModelIndex &destinationParent, int destinationRow) {
     if (sourceParent.isValid() || destinationParent.isValid()) return false;
+    if (!index_ || !doc_ || !reorderEnabled_) return false;
     if (count <= 0 || count > 1) return false;
-    if (sourceRow < 0 || sourceRow + count > rows_.size()) return false;
-    if (destinationRow < 0 || destinationRow > rows_.size()) return false;
+    const int rows = rowCount();
+    if (sourceRow < 0 || sourceRow + count > rows) return false;
+    if (destinationRow < 0 || destinationRow > rows) return false;
     if (destinationRow >= sourceRow && destinationRow <= sourceRow + count) return false;
 
-    if (!beginMoveRows(QModelIndex(), sourceRow, sourceRow + count - 1,
-                       QModelIndex(), destinationRow)) {
-        return false;
-    }
-
-    QVector<Segment> moved;
-    moved.reserve(count);
-    for (int i = 0; i < count; ++i) moved.append(rows_.at(sourceRow + i));
-    for (int i = 0; i < count; ++i) rows_.removeAt(sourceRow);
+    // Only the part of the segment inside the buffer moves
+    const qulonglong size = qulonglong(doc_->size());
+    Segment moving = index_->at(sourceRow);
+    if (moving.start >= size) return false;
+    const qulonglong oldStart = moving.start;
+    const qulonglong length = std::min(moving.length, size - moving.start);
 
     int insertRow = destinationRow;
     if (destinationRow > sourceRow) insertRow -= count;
-    for (int i = 0; i < count; ++i) rows_.insert(insertRow + i, moved.at(i));
 
+    if (!beginMoveRows(QModelIndex(), sourceRow, sourceRow + count - 1,
+                       QModelIndex(), destinationRow)) {
+        return false;
+    }
+    // Close the gap it leaves, then open one where it goes; the target start
+    // is measured in the buffer with the segment taken out
+    index_->takeAt(sourceRow);
+    index_->shiftFrom(sourceRow, -qint64(length));
+    const qulonglong insertStart = insertRow < index_->count()
+                                 ? index_->at(insertRow).start
+                                 : size - length;
+    index_->shiftFrom(insertRow, qint64(length));
+    moving.start  = insertStart;
+    moving.length = length;
+    index_->insertAt(insertRow, moving);
     endMoveRows();
-    emit rowReordered(sourceRow, insertRow);
+
+    // Rows between the old and new position changed address
+    segmentsChanged(std::min(sourceRow, insertRow), std::max(sourceRow, insertRow));
+    emit rowReordered(sourceRow, insertRow, oldStart);
     return true;
 }
 
-void SegmentView::setSegments(QVector<Segment> segments) {
+void SegmentView::setIndex(SegmentIndex *index) {
     beginResetModel();
-    rows_ = std::move(segments);
+    index_ = index;
     endResetModel();
 }
 
-void SegmentView::clear() {
-    setSegments({});
+void SegmentView::refresh() {
+    beginResetModel();
+    endResetModel();
 }
 
-QVector<SegmentView::Segment> SegmentView::segments() const {
-    return rows_;
+void SegmentView::segmentsChanged(int first, int last) {
+    const int rows = rowCount();
+    if (rows == 0) return;
+    first = std::clamp(first, 0, rows - 1);
+    last  = std::clamp(last, first, rows - 1);
+    emit dataChanged(index(first, 0), index(last, columnCount() - 1));
 }
 
 QString SegmentView::formatStart(qulonglong value) {
@@ -180,3 +204,47 @@ QString SegmentView::formatLabel(const Segment &segment) {
     if (!segment.note.isEmpty()) label += segment.note;
     return label;
 }
+
+int SegmentView::addLoaded(qulonglong start, qulonglong length, const QString &label) {
+    if (!index_) return -1;
+    const auto [first, last] = index_->overlapping(start, start + length);
+    if (first == last) {
+        // Nothing overlapped, it is a plain insert at its sorted position
+        beginInsertRows(QModelIndex(), first, first);
+        const int row = index_->addLoaded(start, length, label);
+        endInsertRows();
+        return row;
+    }
+    // Overlapped rows are cut into remainders; rare enough to just reset
+    beginResetModel();
+    const int row = index_->addLoaded(start, length, label);
+    endResetModel();
+    return row;
+}
+
+void SegmentView::insertSegment(int row, const Segment &segment) {
+    if (!index_) return;
+    row = std::clamp(row, 0, index_->count());
+    beginInsertRows(QModelIndex(), row, row);
+    index_->insertAt(row, segment);
+    endInsertRows();
+}
+
+void SegmentView::removeSegment(int row) {
+    if (!index_ || row < 0 || row >= index_->count()) return;
+    beginRemoveRows(QModelIndex(), row, row);
+    index_->takeAt(row);
+    endRemoveRows();
+}
+
+void SegmentView::shiftFrom(int row, qint64 delta) {
+    if (!index_ || delta == 0 || row >= index_->count()) return;
+    index_->shiftFrom(row, delta);
+    segmentsChanged(row, index_->count() - 1);
+}
+
+void SegmentView::setLabel(int row, const QString &label, const QString &note) {
+    if (!index_ || row < 0 || row >= index_->count()) return;
+    index_->setLabel(row, label, note);
+    segmentsChanged(row, row);
+}
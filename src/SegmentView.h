@@ -1,18 +1,14 @@
 #pragma once
 
 #include <QAbstractTableModel>
-#include <QVector>
+#include "SegmentIndex.h"
+
+class BufferDocument;
 
 class SegmentView : public QAbstractTableModel {
     Q_OBJECT
 public:
-    struct Segment {
-        qulonglong start{};
-        qulonglong length{};
-        QString    label;
-        QString    note;
-        qulonglong id{};
-    };
+    using Segment = SegmentIndex::Segment;
 
     explicit SegmentView(QObject *parent = nullptr);
 
@@ -31,15 +27,34 @@ public:
     bool moveRows(const QModelIndex &sourceParent, int sourceRow, int count,
                   const QModelIndex &destinationParent, int destinationRow) override;
 
-    void setSegments(QVector<Segment> segments);
-    void clear();
-    QVector<Segment> segments() const;
+    // Rows are read straight from the index (not owned)
+    void setIndex(SegmentIndex *index);
+    // Buffer the rows describe, bounds the bytes a dragged row takes along
+    void setDocument(const BufferDocument *doc) { doc_ = doc; }
+    // Rows can't be dragged while off, e.g. while a read fills the buffer
+    void setReorderEnabled(bool on) { reorderEnabled_ = on; }
+    // Index changed structurally; re-query everything
+    void refresh();
+    // Addresses or labels of rows [first, last] changed
+    void segmentsChanged(int first, int last);
+
+    // Index edits with the matching row notifications
+    int  addLoaded(qulonglong start, qulonglong length, const QString &label);
+    void insertSegment(int row, const Segment &segment);
+    void removeSegment(int row);
+    void shiftFrom(int row, qint64 delta);
+    void setLabel(int row, const QString &label, const QString &note = {});
 
 signals:
-    void rowReordered(int from, int to);
+    // Emitted after a drag moved a row. The index already has it at 'to'
+    // with its new start; the receiver moves its bytes, which began at
+    // oldStart, to match.
+    void rowReordered(int from, int to, qulonglong oldStart);
 
 private:
-    QVector<Segment> rows_;
+    SegmentIndex *index_{};
+    const BufferDocument *doc_{};
+    bool reorderEnabled_{true};
 
     static QString formatStart(qulonglong value);
     static QString formatEnd(qulonglong start, qulonglong length);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QString>
+
+// Sizes and offsets as typed by the user: decimal, or hex with 0x, with an
+// optional K/KB or M/MB suffix (binary units). Used by the load dialog and
+// by headless job files.
+inline bool parseSizeLike(const QString &in, qulonglong &out) {
+    QString s = in.trimmed();
+    if (s.isEmpty()) return false;
+
+    qulonglong mul = 1;
+    if (s.endsWith("KB", Qt::CaseInsensitive)) { mul = 1024ULL; s.chop(2); }
+    else if (s.endsWith("MB", Qt::CaseInsensitive)) { mul = 1024ULL*1024ULL; s.chop(2); }
+    else if (!s.isEmpty() && (s.back() == QLatin1Char('k') || s.back() == QLatin1Char('K'))) { mul = 1024ULL; s.chop(1); }
+    else if (!s.isEmpty() && (s.back() == QLatin1Char('m') || s.back() == QLatin1Char('M'))) { mul = 1024ULL*1024ULL; s.chop(1); }
+
+    bool ok = false;
+    qulonglong base = 0;
+    s = s.trimmed();
+    if (s.startsWith("0x", Qt::CaseInsensitive)) {
+        base = s.mid(2).toULongLong(&ok, 16);
+    } else {
+        base = s.toULongLong(&ok, 10);
+    }
+    if (!ok) return false;
+    out = base * mul;
+    return true;
+}
@@ -0,0 +1,127 @@
+#include "UnitOverlay.h"
+
+#include "BufferEngine.h"
+#include "Checksum.h"
+
+#include <QObject>
+#include <QStringList>
+
+#include <algorithm>
+
+namespace {
+
+QByteArray integerBytes(quint64 value, int length, bool bigEndian) {
+    QByteArray out(length, '\0');
+    for (int i = 0; i < length; ++i) {
+        out[bigEndian ? length - 1 - i : i] = char(value & 0xFF);
+        value >>= 8;
+    }
+    return out;
+}
+
+// Fill the X/x positions from the right, one hex digit each
+QString hexText(const QString &pattern, quint64 value) {
+    QString out = pattern;
+    for (qsizetype i = out.size() - 1; i >= 0; --i) {
+        const QChar c = out.at(i);
+        if (c != 'X' && c != 'x') continue;
+        const int nibble = int(value & 0xF);
+        value >>= 4;
+        const QChar digit = QChar(nibble < 10 ? '0' + nibble : (c == 'X' ? 'A' : 'a') + nibble - 10);
+        out[i] = digit;
+    }
+    return out;
+}
+
+QString hex(qint64 v) {
+    return "0x" + QString::number(v, 16).toUpper();
+}
+
+} // namespace
+
+QString UnitOverlay::generatorName(Generator generator) {
+    switch (generator) {
+    case Generator::Counter: return QObject::tr("Counter");
+    case Generator::HexText: return QObject::tr("Hex text");
+    case Generator::Crc32:   return QObject::tr("CRC-32");
+    }
+    return QString();
+}
+
+QString UnitOverlay::validate(qint64 imageSize) const {
+    for (int i = 0; i < fields.size(); ++i) {
+        const Field &f = fields.at(i);
+        const QString where = QObject::tr("Field %1 (%2 at %3)")
+                                  .arg(i + 1).arg(generatorName(f.generator), hex(f.offset));
+        if (f.length <= 0 || f.offset < 0 || f.offset + f.length > imageSize)
+            return QObject::tr("%1 does not fit the %2 byte image.").arg(where).arg(imageSize);
+
+        switch (f.generator) {
+        case Generator::Counter:
+            if (f.length > 8) return QObject::tr("%1: a counter is at most 8 bytes.").arg(where);
+            break;
+        case Generator::HexText:
+            if (f.pattern.size() != f.length
+                || std::any_of(f.pattern.cbegin(), f.pattern.cend(), [](QChar c) { return c.unicode() > 0x7F; }))
+                return QObject::tr("%1: the pattern must be %2 ASCII characters.").arg(where).arg(f.length);
+            if (!f.pattern.contains('X', Qt::CaseInsensitive))
+                return QObject::tr("%1: the pattern has no X for the digits.").arg(where);
+            break;
+        case Generator::Crc32:
+            if (f.length != 4) return QObject::tr("%1: a CRC-32 takes 4 bytes.").arg(where);
+            if (f.rangeFrom < 0 || f.rangeLength <= 0 || f.rangeFrom + f.rangeLength > imageSize)
+                return QObject::tr("%1: the checksummed range is outside the image.").arg(where);
+            // A checksum over itself would change with every write
+            if (f.offset < f.rangeFrom + f.rangeLength && f.rangeFrom < f.offset + f.length)
+                return QObject::tr("%1 lies inside the range it checksums.").arg(where);
+            break;
+        }
+
+        for (int j = 0; j < i; ++j) {
+            const Field &g = fields.at(j);
+            if (f.offset < g.offset + g.length && g.offset < f.offset + f.length)
+                return QObject::tr("%1 overlaps field %2.").arg(where).arg(j + 1);
+        }
+    }
+    return QString();
+}
+
+QList<UnitOverlay::Value> UnitOverlay::apply(BufferEngine &image, quint64 index) const {
+    QList<Value> values(fields.size());
+
+    // Checksums last, so they cover the other fields of this unit
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 0; i < fields.size(); ++i) {
+            const Field &f = fields.at(i);
+            if ((f.generator == Generator::Crc32) != (pass == 1)) continue;
+
+            Value &v = values[i];
+            v.offset = f.offset;
+            const quint64 counter = f.start + f.step * index;
+            switch (f.generator) {
+            case Generator::Counter:
+                v.bytes = integerBytes(counter, f.length, f.bigEndian);
+                v.text  = "0x" + QString::number(counter, 16).toUpper();
+                break;
+            case Generator::HexText:
+                v.text  = hexText(f.pattern, counter);
+                v.bytes = v.text.toLatin1();
+                break;
+            case Generator::Crc32: {
+                const quint32 crc = Checksum::crc32(image, f.rangeFrom, f.rangeLength);
+                v.bytes = integerBytes(crc, 4, f.bigEndian);
+                v.text  = "0x" + QString("%1").arg(crc, 8, 16, QChar('0')).toUpper();
+                break;
+            }
+            }
+            image.overwrite(f.offset, BufferSource(v.bytes));
+        }
+    }
+    return values;
+}
+
+QString UnitOverlay::describe(const QList<Value> &values) {
+    QStringList parts;
+    for (const Value &v : values) parts << QString("@%1 = %2").arg(hex(v.offset), v.text);
+    return parts.join(", ");
+}
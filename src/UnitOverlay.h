@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+
+class BufferEngine;
+
+// Data that differs from chip to chip in a batch: serial numbers, MAC
+// addresses, a checksum over the result.
+//
+// Each field writes `length` bytes at `offset` of the unit's image. The
+// base image is never touched: apply() overwrites the fields on a copy of
+// the piece table, which shares all payload with the base, so a unit costs
+// a few new pieces plus reading the ranges its checksums cover.
+class UnitOverlay {
+public:
+    enum class Generator {
+        Counter,    // binary integer, start + step * unit
+        HexText,    // ASCII pattern, each X/x takes one hex digit of the counter
+        Crc32,      // CRC-32 of a range of the unit's image, after the other fields
+    };
+
+    struct Field {
+        qint64    offset{0};
+        int       length{0};
+        Generator generator{Generator::Counter};
+        bool      bigEndian{false};     // Counter and Crc32
+        quint64   start{0};             // Counter and HexText
+        quint64   step{1};
+        QString   pattern;              // HexText, e.g. "SN-XXXXXXXX"
+        qint64    rangeFrom{0};         // Crc32, [rangeFrom, rangeFrom + rangeLength)
+        qint64    rangeLength{0};
+    };
+
+    // What one field put into one unit, for the log
+    struct Value {
+        qint64     offset{0};
+        QByteArray bytes;
+        QString    text;
+    };
+
+    QList<Field> fields;
+
+    bool isEmpty() const { return fields.isEmpty(); }
+
+    // Empty if every field fits an image of `imageSize` bytes
+    QString validate(qint64 imageSize) const;
+
+    // Writes the fields for unit `index` (0 for the first) into `image`
+    QList<Value> apply(BufferEngine &image, quint64 index) const;
+
+    static QString generatorName(Generator generator);
+    // "@0x1000 = SN-0000002A, @0x7FFC = 0x1C291CA3"
+    static QString describe(const QList<Value> &values);
+};
@@ -1,4 +1,6 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QCoreApplication>
 #include <QObject>
 #include <QProcess>
 #include <QStringList>
@@ -14,9 +16,46 @@
 #include <QGridLayout>
 #include <QVBoxLayout>
 #include <QSplitter>
+#include <QTimer>
+#include "HeadlessRunner.h"
 #include "MainWindow.h"
 
+// Decided before any application object exists, as the GUI one needs a display
+static bool headlessRequested(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--batch") == 0 || qstrncmp(argv[i], "--batch=", 8) == 0)
+            return true;
+    }
+    return false;
+}
+
+static int runHeadless(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("Firebay refurb");
+    QCoreApplication::setApplicationName("fireminipro");
+    QCoreApplication::setApplicationVersion(FIREMINIPRO_VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs a job file without the GUI and prints the result as JSON.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    const QCommandLineOption batchOpt("batch", "Job file to run.", "job.json");
+    const QCommandLineOption outputOpt({ "o", "output" }, "Write the result to <file> instead of stdout.", "file");
+    const QCommandLineOption verboseOpt({ "v", "verbose" }, "Print minipro's output to stderr.");
+    parser.addOptions({ batchOpt, outputOpt, verboseOpt });
+    parser.process(app);
+
+    HeadlessRunner runner;
+    runner.setOutputPath(parser.value(outputOpt));
+    runner.setVerbose(parser.isSet(verboseOpt));
+    QObject::connect(&runner, &HeadlessRunner::done, &app, &QCoreApplication::exit, Qt::QueuedConnection);
+    QTimer::singleShot(0, &runner, [&]{ runner.run(parser.value(batchOpt)); });
+    return app.exec();
+}
+
 int main(int argc, char *argv[]) {
+    if (headlessRequested(argc, argv)) return runHeadless(argc, argv);
+
     QApplication app(argc, argv);
     QCoreApplication::setOrganizationName("Firebay refurb");
     QCoreApplication::setApplicationName("fireminipro");